@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+
+/**
+ * Over-aligned heap storage
+ * Before C++17, new and std::allocator only promise alignof(std::max_align_t), so an
+ * alignas(64) type on the heap can start anywhere on a cache line. This allocator
+ * over-allocates, rounds the pointer up to alignof(T) and keeps the original pointer
+ * just below the block for deallocate(). Use it for containers of alignas(64) types.
+ */
+template<class T>
+struct AlignedAllocator {
+    typedef T value_type;
+
+    AlignedAllocator() {}
+    template<class U> AlignedAllocator(AlignedAllocator<U> const&) {}
+
+    T* allocate(size_t n) {
+        if(n > (SIZE_MAX - sizeof(void*) - alignof(T)) / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+
+        void* raw = ::operator new(n * sizeof(T) + sizeof(void*) + alignof(T) - 1);
+        uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void*) + alignof(T) - 1) & ~static_cast<uintptr_t>(alignof(T) - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T* p, size_t) {
+        ::operator delete(reinterpret_cast<void**>(p)[-1]);
+    }
+};
+
+template<class T, class U>
+bool operator==(AlignedAllocator<T> const&, AlignedAllocator<U> const&) { return true; }
+
+template<class T, class U>
+bool operator!=(AlignedAllocator<T> const&, AlignedAllocator<U> const&) { return false; }
@@ -0,0 +1,85 @@
+#include <aot.hpp>
+#include <cstring>
+#include <vector>
+
+static std::vector<AotProgram const*>& Programs() {
+    static std::vector<AotProgram const*> programs; // Filled during static initialization, so it can't be a plain global
+    return programs;
+}
+
+AotRegistration::AotRegistration(AotProgram const& program) {
+    Programs().push_back(&program);
+}
+
+AotProgram const* AotEngine::Find(Chip8 const& chip8) {
+    for(AotProgram const* program : Programs()) {
+        if(program->image_size > MAX_ROM_SIZE || chip8.MemorySize() != MEMORY_SIZE) { // Blocks are compiled for 4 KB, never run them on a ROM bigger than that
+            continue;
+        }
+
+        bool match = true;
+        for(size_t i = 0; i < program->image_size && match; i++) {
+            match = chip8.memory[PROGRAM_ADDRESS + i] == program->image[i];
+        }
+        if(match) {
+            return program;
+        }
+    }
+
+    return nullptr;
+}
+
+AotEngine::AotEngine(AotProgram const& program, Chip8 const& chip8) : program(program) {
+    for(size_t i = 0; i < program.block_count; i++) {
+        AotBlock const& block = program.blocks[i];
+        memset(covered + block.address, 1, block.end - block.address);
+    }
+
+    Validate(chip8, 0, MEMORY_SIZE);
+}
+
+void AotEngine::Validate(Chip8 const& chip8, unsigned int first, unsigned int last) {
+    bool touched = false;
+    for(unsigned int address = first; address < last && !touched; address++) {
+        touched = covered[address];
+    }
+    if(!touched) { // Data, not code: the common case for Fx33/Fx55
+        return;
+    }
+
+    for(size_t i = 0; i < program.block_count; i++) {
+        AotBlock const& block = program.blocks[i];
+        if(block.end <= first || block.address >= last) {
+            continue;
+        }
+
+        bool intact = !memcmp(chip8.memory.Data() + block.address, program.image + (block.address - PROGRAM_ADDRESS), block.end - block.address);
+        entry[block.address] = intact ? &block : nullptr;
+    }
+}
+
+uint64_t AotEngine::Run(Chip8& chip8, uint64_t instructions) {
+    uint64_t start = chip8.instruction_count;
+    uint64_t end = start + instructions;
+    AotMachine machine(chip8);
+
+    while(chip8.instruction_count < end) {
+        if(chip8.code_write_first < chip8.code_write_last) { // Memory got written, stop using any block it changed
+            Validate(chip8, chip8.code_write_first, chip8.code_write_last);
+            chip8.code_write_first = 0xFFFF;
+            chip8.code_write_last = 0;
+        }
+
+        AotBlock const* block = chip8.pc < MEMORY_SIZE ? entry[chip8.pc] : nullptr;
+
+        if(block && block->length <= end - chip8.instruction_count) {
+            chip8.instruction_count += block->length; // Counted up front, like the interpreter, so idle loop skipping sees the right count
+            block->run(machine);
+            continue;
+        }
+
+        chip8.Interpret(1); // Not compiled (or no longer valid), or the block doesn't fit in what's left of the batch
+    }
+
+    return chip8.instruction_count - start;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * Ahead-of-time recompiled ROMs
+ * chip8_aot (src/aot_compiler.hpp) walks a ROM's control flow and writes C++ with one
+ * function per basic block. Compiled into a program, each file registers an AotProgram,
+ * and Engine::Aot picks the one whose image matches the loaded ROM.
+ * Blocks only run while the RAM under them still holds the bytes they were compiled
+ * from. Anything else (computed Bnnn targets the walk never saw, self-modified code, a
+ * block that doesn't fit in what's left of a Run() batch) goes through the interpreter.
+ * Only ROMs up to MAX_ROM_SIZE are compiled, a bigger XO-CHIP ROM never matches and runs
+ * on the interpreter.
+ */
+
+// What a generated block sees of the machine. The simple opcodes are written out inline
+// against these fields, everything else calls the interpreter's own handler.
+struct AotMachine {
+    explicit AotMachine(Chip8& chip8)
+    : chip8(chip8), V(chip8.registers), I(chip8.index), pc(chip8.pc), dt(chip8.delay_timer), st(chip8.sound_timer), keypad(chip8.keypad) {
+    }
+
+    Chip8& chip8;
+    uint8_t* V;
+    uint16_t& I;
+    uint16_t& pc;
+    uint8_t& dt;
+    uint8_t& st;
+    uint16_t& keypad;
+
+    // Control flow, exactly as the interpreter does it
+    void Jump(uint16_t target, uint16_t jump_pc) { pc = target; chip8.SkipIdleLoop(jump_pc); } // 1nnn, idle loops included
+    void Call(uint16_t target, uint16_t return_pc) { chip8.stack[chip8.sp & (STACK_LEVELS - 1u)] = return_pc; chip8.sp++; pc = target; } // 2nnn
+    void Return() { chip8.sp--; pc = chip8.stack[chip8.sp & (STACK_LEVELS - 1u)]; } // 00EE
+
+    // Handlers, called with the PC already past the instruction
+    void Op(void (Chip8::*handler)(Chip8::Instruction const&), uint8_t x, uint8_t y, uint8_t n, uint8_t kk) {
+        Chip8::Instruction op{};
+        op.x = x;
+        op.y = y;
+        op.n = n;
+        op.kk = kk;
+        (chip8.*handler)(op);
+    }
+    void Clear() { Op(&Chip8::OP_00E0, 0, 0, 0, 0); }
+    void Random(uint8_t x, uint8_t kk) { Op(&Chip8::OP_Cxkk, x, 0, 0, kk); }
+    void Draw(uint8_t x, uint8_t y, uint8_t n) { Op(&Chip8::OP_Dxyn, x, y, n, 0); }
+    void WaitKey(uint8_t x) { Op(&Chip8::OP_Fx0A, x, 0, 0, 0); }
+    void Font(uint8_t x) { Op(&Chip8::OP_Fx29, x, 0, 0, 0); }
+    void Bcd(uint8_t x) { Op(&Chip8::OP_Fx33, x, 0, 0, 0); }
+    void Store(uint8_t x) { Op(&Chip8::OP_Fx55, x, 0, 0, 0); }
+    void Load(uint8_t x) { Op(&Chip8::OP_Fx65, x, 0, 0, 0); }
+    void Extended(uint16_t opcode) { Chip8::Instruction op = chip8.Decode(opcode); (chip8.*op.handler)(op); } // SUPER-CHIP/XO-CHIP opcodes
+    uint16_t Skip(uint16_t next) const { return chip8.OpcodeAt(next) == 0xF000 ? next + 4 : next + 2; } // Where a taken skip over next lands
+};
+
+struct AotBlock {
+    uint16_t address; // First guest instruction
+    uint16_t end; // One past its last guest byte
+    uint8_t length; // Guest instructions, all of which always run
+    void (*run)(AotMachine& m);
+};
+
+struct AotProgram {
+    char const* name; // ROM it was generated from
+    uint8_t const* image; // Its bytes, loaded at PROGRAM_ADDRESS
+    size_t image_size;
+    AotBlock const* blocks; // Sorted by address
+    size_t block_count;
+};
+
+// A generated file's static instance of this adds its program to the list Engine::Aot searches
+struct AotRegistration {
+    explicit AotRegistration(AotProgram const& program);
+};
+
+class AotEngine {
+    public:
+        explicit AotEngine(AotProgram const& program, Chip8 const& chip8);
+
+        static AotProgram const* Find(Chip8 const& chip8); // The compiled program for the ROM chip8 has loaded, nullptr if there's none
+        uint64_t Run(Chip8& chip8, uint64_t instructions); // Same contract as Chip8::Run()
+
+    private:
+        AotProgram const& program;
+        AotBlock const* entry[MEMORY_SIZE]{}; // Block starting at each address, nullptr if none or RAM no longer matches it
+        uint8_t covered[MEMORY_SIZE]{}; // Set for every byte some block was compiled from
+
+        void Validate(Chip8 const& chip8, unsigned int first, unsigned int last); // Recheck the blocks overlapping [first, last)
+};
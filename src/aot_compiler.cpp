@@ -0,0 +1,299 @@
+#include <aot_compiler.hpp>
+#include <mapped_file.hpp>
+#include <cstdio>
+#include <set>
+
+// What an opcode does to the walk, decoded the way Chip8::Decode() picks handlers
+static bool IsSkip(uint16_t opcode) {
+    switch(opcode >> 12) {
+        case 0x3: case 0x4: case 0x9: return true;
+        case 0x5: return (opcode & 0xF) != 0x2 && (opcode & 0xF) != 0x3; // Not 5xy2/5xy3
+        case 0xE: return (opcode & 0xF) == 0x1 || (opcode & 0xF) == 0xE; // ExA1, Ex9E
+        default: return false;
+    }
+}
+
+static bool EndsBlock(uint16_t opcode) {
+    switch(opcode >> 12) {
+        case 0x0: return opcode == 0x00FD || ((opcode & 0xF) == 0xE && !IsExtendedOpcode(opcode)); // 00EE (only the last nibble is decoded), EXIT
+        case 0x1: case 0x2: case 0xB: return true;
+        case 0x5: return (opcode & 0xF) == 0x2 || IsSkip(opcode); // 5xy2 writes memory
+        case 0xF: return opcode == 0xF000 || (opcode & 0xFF) == 0x0A || (opcode & 0xFF) == 0x33 || (opcode & 0xFF) == 0x55; // Long LD I, waits, or writes memory that might be code
+        default: return IsSkip(opcode);
+    }
+}
+
+static std::string Hex(unsigned int value, int digits) {
+    char text[16];
+    std::snprintf(text, sizeof(text), "0x%0*X", digits, value);
+    return text;
+}
+
+static std::string Reg(unsigned int x) {
+    char text[4];
+    std::snprintf(text, sizeof(text), "v%X", x);
+    return text;
+}
+
+bool AotCompiler::Load(const char* filename) {
+    MappedFile file;
+
+    if(!file.Open(filename) || file.Size() == 0 || file.Size() > MAX_ROM_SIZE) {
+        return false;
+    }
+
+    Load(file.Data(), file.Size());
+    return true;
+}
+
+void AotCompiler::Load(uint8_t const* rom, size_t size) {
+    image.assign(rom, rom + size);
+    blocks.clear();
+    computed_jumps = 0;
+    Walk();
+}
+
+uint16_t AotCompiler::OpcodeAt(unsigned int address) const {
+    return image[address - PROGRAM_ADDRESS] << 8 | image[address + 1 - PROGRAM_ADDRESS];
+}
+
+void AotCompiler::Walk() {
+    std::vector<unsigned int> work{PROGRAM_ADDRESS};
+    std::set<unsigned int> computed;
+
+    while(!work.empty()) {
+        unsigned int address = work.back();
+        work.pop_back();
+
+        if(!InImage(address) || blocks.count(address)) { // Off the end of the ROM (or into the interpreter area) is left to the interpreter
+            continue;
+        }
+
+        std::vector<uint16_t>& opcodes = blocks[address];
+        unsigned int guest = address;
+        while(opcodes.size() < MAX_BLOCK_LENGTH && InImage(guest)) {
+            opcodes.push_back(OpcodeAt(guest));
+            guest += 2;
+            if(EndsBlock(opcodes.back())) {
+                break;
+            }
+        }
+
+        // Where the block can go next
+        uint16_t last = opcodes.back();
+        unsigned int at = guest - 2;
+
+        if(!EndsBlock(last)) { // Ran into the length limit or the end of the ROM
+            work.push_back(guest);
+        }
+        else if(IsSkip(last)) {
+            work.push_back(at + 2);
+            work.push_back(at + 4);
+            if(InImage(at + 2) && OpcodeAt(at + 2) == 0xF000) { // Skipping F000 nnnn lands past its address word
+                work.push_back(at + 6);
+            }
+        }
+        else switch(last >> 12) {
+            case 0x1: work.push_back(last & 0x0FFF); break;
+            case 0x2: work.push_back(last & 0x0FFF); work.push_back(at + 2); break; // The RET comes back to the next instruction
+            case 0xB: computed.insert(at); break;
+            case 0x5: work.push_back(at + 2); break; // 5xy2
+            case 0xF: work.push_back(last == 0xF000 ? at + 4 : at + 2); break; // F000 nnnn, Fx0A, Fx33, Fx55
+            default: break; // 00EE: every return address is already queued by its CALL. 00FD never leaves
+        }
+    }
+
+    computed_jumps = computed.size();
+}
+
+size_t AotCompiler::Instructions() const {
+    std::set<unsigned int> addresses;
+    for(auto const& block : blocks) {
+        for(size_t i = 0; i < block.second.size(); i++) addresses.insert(block.first + 2 * i);
+    }
+    return addresses.size();
+}
+
+void AotCompiler::Write(std::ostream& out, std::string const& name) const {
+    out << "// Generated by chip8_aot from " << name << ", regenerate it rather than editing\n"
+        << "// " << blocks.size() << " blocks, " << Instructions() << " instructions, " << computed_jumps << " computed jumps left to the interpreter\n"
+        << "#include <aot.hpp>\n"
+        << "\n"
+        << "namespace {\n"
+        << "\n"
+        << "const uint8_t image[" << image.size() << "] = {";
+
+    for(size_t i = 0; i < image.size(); i++) {
+        out << (i % 16 ? " " : "\n    ") << Hex(image[i], 2) << ",";
+    }
+    out << "\n};\n";
+
+    for(auto const& block : blocks) {
+        WriteBlock(out, block.first, block.second);
+    }
+
+    out << "\n"
+        << "const AotBlock blocks[] = {\n";
+    for(auto const& block : blocks) {
+        out << "    {" << Hex(block.first, 3) << ", " << Hex(block.first + 2 * block.second.size(), 3) << ", "
+            << block.second.size() << ", &Block_" << Hex(block.first, 3).substr(2) << "},\n";
+    }
+    out << "};\n"
+        << "\n"
+        << "const AotProgram program = {\"" << name << "\", image, sizeof(image), blocks, sizeof(blocks) / sizeof(blocks[0])};\n"
+        << "AotRegistration registration(program);\n"
+        << "\n"
+        << "}\n";
+}
+
+void AotCompiler::WriteBlock(std::ostream& out, uint16_t address, std::vector<uint16_t> const& opcodes) const {
+    // Which registers the inline code reads and writes, helpers go through memory
+    bool used[16]{};
+    bool written[16]{};
+    bool uses_i = false;
+    bool writes_i = false;
+
+    for(uint16_t opcode : opcodes) {
+        unsigned int x = (opcode >> 8) & 0xF;
+        unsigned int y = (opcode >> 4) & 0xF;
+        unsigned int n = opcode & 0xF;
+        unsigned int kk = opcode & 0xFF;
+
+        switch(opcode >> 12) {
+            case 0x3: case 0x4: used[x] = true; break;
+            case 0x5: case 0x9: used[x] = used[y] = true; break;
+            case 0x6: case 0x7: used[x] = written[x] = true; break;
+            case 0x8:
+                if(n <= 0x3) {
+                    used[x] = used[y] = written[x] = true;
+                }
+                else if(n <= 0x7 || n == 0xE) {
+                    used[x] = used[y] = used[0xF] = written[x] = written[0xF] = true;
+                }
+                break;
+            case 0xA: uses_i = writes_i = true; break;
+            case 0xB: used[0] = true; break;
+            case 0xE: used[x] = true; break;
+            case 0xF:
+                if(kk == 0x07) used[x] = written[x] = true;
+                else if(kk == 0x15 || kk == 0x18) used[x] = true;
+                else if(kk == 0x1E) used[x] = uses_i = writes_i = true;
+                break;
+        }
+    }
+
+    auto store = [&](char const* indent) {
+        for(unsigned int r = 0; r < 16; r++) {
+            if(written[r]) out << indent << "m.V[" << Hex(r, 1) << "] = " << Reg(r) << ";\n";
+        }
+        if(writes_i) out << indent << "m.I = i;\n";
+    };
+    auto reload = [&]() {
+        for(unsigned int r = 0; r < 16; r++) {
+            if(used[r]) out << "    " << Reg(r) << " = m.V[" << Hex(r, 1) << "];\n";
+        }
+        if(uses_i) out << "    i = m.I;\n";
+    };
+
+    out << "\n"
+        << "void Block_" << Hex(address, 3).substr(2) << "(AotMachine& m) {\n";
+
+    for(unsigned int r = 0; r < 16; r++) {
+        if(used[r]) out << "    uint8_t " << Reg(r) << " = m.V[" << Hex(r, 1) << "];\n";
+    }
+    if(uses_i) out << "    uint16_t i = m.I;\n";
+
+    for(size_t index = 0; index < opcodes.size(); index++) {
+        uint16_t opcode = opcodes[index];
+        unsigned int at = address + 2 * index;
+        unsigned int x = (opcode >> 8) & 0xF;
+        unsigned int y = (opcode >> 4) & 0xF;
+        unsigned int n = opcode & 0xF;
+        unsigned int kk = opcode & 0xFF;
+        unsigned int nnn = opcode & 0xFFF;
+        std::string vx = Reg(x);
+        std::string vy = Reg(y);
+
+        out << "    // " << Hex(at, 3) << ": " << Hex(opcode, 4).substr(2) << "\n";
+
+        // Handlers: everything the inline code keeps in locals goes back first, and is picked up again after
+        auto helper = [&](std::string const& call) {
+            store("    ");
+            out << "    m.pc = " << Hex(at + 2, 3) << ";\n"
+                << "    m." << call << ";\n";
+            reload();
+        };
+
+        if(IsExtendedOpcode(opcode)) {
+            helper("Extended(" + Hex(opcode, 4) + ")");
+            continue;
+        }
+
+        switch(opcode >> 12) {
+            case 0x0:
+                if(n == 0x0) helper("Clear()");
+                else if(n == 0xE) { store("    "); out << "    m.Return();\n"; }
+                break;
+            case 0x1: store("    "); out << "    m.Jump(" << Hex(nnn, 3) << ", " << Hex(at, 3) << ");\n"; break;
+            case 0x2: store("    "); out << "    m.Call(" << Hex(nnn, 3) << ", " << Hex(at + 2, 3) << ");\n"; break;
+            case 0x6: out << "    " << vx << " = " << Hex(kk, 2) << ";\n"; break;
+            case 0x7: out << "    " << vx << " += " << Hex(kk, 2) << ";\n"; break;
+            case 0x8:
+                switch(n) {
+                    case 0x0: out << "    " << vx << " = " << vy << ";\n"; break;
+                    case 0x1: out << "    " << vx << " |= " << vy << ";\n"; break;
+                    case 0x2: out << "    " << vx << " &= " << vy << ";\n"; break;
+                    case 0x3: out << "    " << vx << " ^= " << vy << ";\n"; break;
+                    // Same statement order as the handlers, so VF as an operand comes out the same
+                    case 0x4: out << "    { unsigned int sum = " << vx << " + " << vy << "; vF = sum > 255u; " << vx << " = sum & 0xFFu; }\n"; break;
+                    case 0x5: out << "    vF = " << vx << " > " << vy << "; " << vx << " -= " << vy << ";\n"; break;
+                    case 0x6: out << "    vF = " << vx << " & 0x1u; " << vx << " >>= 1;\n"; break;
+                    case 0x7: out << "    vF = " << vy << " > " << vx << "; " << vx << " = " << vy << " - " << vx << ";\n"; break;
+                    case 0xE: out << "    vF = (" << vx << " & 0x80u) >> 7u; " << vx << " <<= 1;\n"; break;
+                }
+                break;
+            case 0xA: out << "    i = " << Hex(nnn, 3) << ";\n"; break;
+            case 0xB: store("    "); out << "    m.pc = v0 + " << Hex(nnn, 3) << ";\n"; break;
+            case 0xC: helper("Random(" + Hex(x, 1) + ", " + Hex(kk, 2) + ")"); break;
+            case 0xD: helper("Draw(" + Hex(x, 1) + ", " + Hex(y, 1) + ", " + std::to_string(n) + ")"); break;
+            case 0xF:
+                switch(kk) {
+                    case 0x07: out << "    " << vx << " = m.dt;\n"; break;
+                    case 0x0A: helper("WaitKey(" + Hex(x, 1) + ")"); break; // Leaves the PC on itself while no key is down
+                    case 0x15: out << "    m.dt = " << vx << ";\n"; break;
+                    case 0x18: out << "    m.st = " << vx << ";\n"; break;
+                    case 0x1E: out << "    i = i + " << vx << ";\n"; break;
+                    case 0x29: helper("Font(" + Hex(x, 1) + ")"); break;
+                    case 0x33: helper("Bcd(" + Hex(x, 1) + ")"); break;
+                    case 0x55: helper("Store(" + Hex(x, 1) + ")"); break;
+                    case 0x65: helper("Load(" + Hex(x, 1) + ")"); break;
+                }
+                break;
+            default: { // Skips
+                std::string taken;
+                switch(opcode >> 12) {
+                    case 0x3: taken = vx + " == " + Hex(kk, 2); break;
+                    case 0x4: taken = vx + " != " + Hex(kk, 2); break;
+                    case 0x5: taken = vx + " == " + vy; break;
+                    case 0x9: taken = vx + " != " + vy; break;
+                    case 0xE:
+                        if(n == 0xE) taken = vx + " < KEY_COUNT && (m.keypad >> " + vx + ") & 1u";
+                        else if(n == 0x1) taken = vx + " >= KEY_COUNT || !((m.keypad >> " + vx + ") & 1u)";
+                        break;
+                }
+                if(!taken.empty()) {
+                    store("    ");
+                    out << "    m.pc = " << taken << " ? m.Skip(" << Hex(at + 2, 3) << ") : " << Hex(at + 2, 3) << ";\n";
+                }
+                break;
+            }
+        }
+    }
+
+    uint16_t last = opcodes.back();
+    if(!EndsBlock(last)) { // Falls through to the next block (Fx0A/Fx33/Fx55/F000/5xy2/00FD already set the PC in their handler call)
+        store("    ");
+        out << "    m.pc = " << Hex(address + 2 * opcodes.size(), 3) << ";\n";
+    }
+    out << "}\n";
+}
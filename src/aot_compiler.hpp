@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+/**
+ * Ahead-of-time recompiler
+ * Walks a ROM's control flow from PROGRAM_ADDRESS: both ways out of every skip, into every
+ * CALL and back to the instruction after it, along every JP. Each address the walk reaches
+ * starts a basic block, which runs until the next instruction that changes the PC or writes
+ * memory (like the JIT's blocks). The blocks are written out as C++ for AotEngine (aot.hpp):
+ * the V registers a block uses are locals, the simple opcodes are inline, and Dxyn, Cxkk,
+ * 00E0, Fx0A, Fx29, Fx33, Fx55 and Fx65 call the interpreter's handlers.
+ * Bnnn targets depend on V0, so the walk can't follow them; AotEngine interprets whatever
+ * code it finds there until it lands on a compiled block again.
+ */
+class AotCompiler {
+    public:
+        static const unsigned int MAX_BLOCK_LENGTH = 64; // Guest instructions per block
+
+        bool Load(const char* filename); // Map a ROM and find its blocks, false if it's missing, empty or too big
+        void Load(uint8_t const* rom, size_t size); // The same for a ROM already in memory (size <= MAX_ROM_SIZE)
+        void Write(std::ostream& out, std::string const& name) const; // Emit the C++ source, name is what the program is registered as
+
+        size_t Blocks() const { return blocks.size(); }
+        size_t Instructions() const; // Guest instructions covered, counting overlapping blocks once
+        size_t ComputedJumps() const { return computed_jumps; } // Bnnn sites the walk couldn't follow
+
+    private:
+        std::vector<uint8_t> image; // The ROM, loaded at PROGRAM_ADDRESS
+        std::map<uint16_t, std::vector<uint16_t>> blocks; // Start address -> opcodes
+        size_t computed_jumps{};
+
+        uint16_t OpcodeAt(unsigned int address) const;
+        bool InImage(unsigned int address) const { return address >= PROGRAM_ADDRESS && address + 2 <= PROGRAM_ADDRESS + image.size(); } // A whole instruction is there
+        void Walk();
+        void WriteBlock(std::ostream& out, uint16_t address, std::vector<uint16_t> const& opcodes) const;
+};
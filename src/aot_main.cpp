@@ -0,0 +1,64 @@
+#include <aot_compiler.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static void Usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--name <name>] <ROM> <output.cpp>\n";
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+    const char* ROM_filename = nullptr;
+    const char* output_filename = nullptr;
+    std::string name;
+
+    for(int i = 1; i < argc; i++) {
+        if(!std::strcmp(argv[i], "--name") && i + 1 < argc) {
+            name = argv[++i];
+        }
+        else if(!ROM_filename) {
+            ROM_filename = argv[i];
+        }
+        else if(!output_filename) {
+            output_filename = argv[i];
+        }
+        else {
+            Usage(argv[0]);
+        }
+    }
+
+    if(!output_filename) {
+        Usage(argv[0]);
+    }
+    if(name.empty()) { // The ROM's file name
+        name = ROM_filename;
+        name = name.substr(name.find_last_of('/') + 1);
+    }
+    if(name.find_first_of("\"\\") != std::string::npos) { // It goes into a string literal
+        std::cerr << "Program name can't contain quotes or backslashes: " << name << "\n";
+        return EXIT_FAILURE;
+    }
+
+    AotCompiler compiler;
+    if(!compiler.Load(ROM_filename)) {
+        std::cerr << "Could not load ROM: " << ROM_filename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::ofstream output(output_filename);
+    compiler.Write(output, name);
+    output.close();
+
+    if(!output) {
+        std::cerr << "Could not write " << output_filename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << name << ": " << compiler.Blocks() << " blocks, " << compiler.Instructions() << " instructions, "
+              << compiler.ComputedJumps() << " computed jumps left to the interpreter\n";
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+#include <beeper.hpp>
+#include <algorithm>
+#include <cmath>
+
+constexpr double Beeper::MAX_ADJUST;
+
+Beeper::Beeper(Ring& ring) : ring(ring) {
+    uint8_t square[PATTERN_SIZE];
+    std::fill(square, square + PATTERN_SIZE, 0xF0); // 4 bits high, 4 low: 500 Hz at the default pitch
+    SetPattern(square, 64);
+}
+
+void Beeper::SetPattern(uint8_t const* pattern, uint8_t pitch) {
+    std::copy(pattern, pattern + PATTERN_SIZE, this->pattern);
+    step = 4000.0 * std::pow(2.0, (pitch - 64) / 48.0) / SAMPLE_RATE;
+}
+
+void Beeper::RunSlice(bool on) {
+    if(ring.Size() == 0) { // Starting up, or the callback ran dry: put the cushion back in silence, the rate control only makes small corrections
+        int16_t silence[TARGET_LATENCY]{};
+        ring.Push(silence, TARGET_LATENCY);
+    }
+
+    // Nudge the slice length by how far the queue is from where we want it
+    double error = (static_cast<double>(TARGET_LATENCY) - static_cast<double>(ring.Size())) / TARGET_LATENCY;
+    error = std::max(-1.0, std::min(1.0, error));
+
+    owed += SAMPLE_RATE / 60.0 / SLICES * (1.0 + MAX_ADJUST * error);
+    unsigned int count = static_cast<unsigned int>(owed);
+    owed -= count;
+
+    int16_t samples[SAMPLE_RATE / 60 / SLICES * 2];
+    count = std::min<unsigned int>(count, sizeof(samples) / sizeof(samples[0]));
+    count = std::min<unsigned int>(count, MAX_QUEUED - std::min<size_t>(ring.Size(), MAX_QUEUED));
+
+    for(unsigned int i = 0; i < count; i++) {
+        if(on) {
+            unsigned int bit = static_cast<unsigned int>(phase);
+            samples[i] = (pattern[bit >> 3] >> (7 - (bit & 7))) & 1 ? AMPLITUDE : -AMPLITUDE;
+            phase = std::fmod(phase + step, PATTERN_SIZE * 8.0);
+        }
+        else {
+            samples[i] = 0;
+        }
+    }
+
+    ring.Push(samples, count);
+}
+
+void Beeper::Drain(Ring& ring, int16_t* out, unsigned int count) {
+    size_t popped = ring.Pop(out, count);
+    std::fill(out + popped, out + count, 0); // Underrun: silence rather than a repeat
+}
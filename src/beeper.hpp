@@ -0,0 +1,44 @@
+#pragma once
+
+#include <spsc_ring.hpp>
+#include <cstdint>
+
+
+/**
+ * Beeper
+ * Turns the sound timer into audio samples on the emulation thread, SLICES pushes per 60 Hz
+ * frame, so the ring never holds much more than a slice on top of TARGET_LATENCY. The samples
+ * go through a lock-free ring to the audio callback.
+ * The sound is an XO-CHIP-style 128-bit pattern played at 4000 * 2^((pitch - 64) / 48) bits
+ * per second, so SetPattern() can drive XO-CHIP ROMs; plain CHIP-8 ROMs get the default
+ * pattern, a square wave at 500 Hz.
+ * Dynamic rate control: the emulation and the sound card run off different clocks, so each
+ * slice makes slightly more or fewer than SAMPLE_RATE / 60 / SLICES samples (at most 0.5%, too little
+ * to hear) to steer the ring's fill level toward TARGET_LATENCY, instead of under- or overrunning now and then.
+ */
+class Beeper {
+    public:
+        static const unsigned int SAMPLE_RATE = 48000;
+        static const unsigned int SLICES = 4; // Pushes per 60 Hz frame, 200 samples (4.2 ms) each
+        static const unsigned int TARGET_LATENCY = 240; // Samples still queued when a slice is pushed: the ring swings between 5 and 9.2 ms (440 samples)
+        static const unsigned int MAX_QUEUED = 460; // Never more than this in the ring (9.6 ms), slices pushed in a burst after a stall are cut short
+        static const unsigned int DEVICE_BUFFER = 128; // Samples per audio callback (2.7 ms)
+        static const unsigned int PATTERN_SIZE = 16; // Bytes in a pattern (128 1-bit samples)
+        typedef SpscRing<int16_t, 1024> Ring; // Room for a few slices on top of the target
+
+        explicit Beeper(Ring& ring);
+
+        void SetPattern(uint8_t const* pattern, uint8_t pitch); // XO-CHIP audio pattern buffer and pitch register
+        void RunSlice(bool on); // Synthesize 1/SLICES of a 60 Hz frame (silence if !on) and push it to the ring
+        static void Drain(Ring& ring, int16_t* out, unsigned int count); // Audio callback side: pop count samples, silence for any that aren't there
+
+    private:
+        static const int16_t AMPLITUDE = 6000; // A beep, not a blast
+        static constexpr double MAX_ADJUST = 0.005; // Most the rate control speeds up or slows down a frame
+
+        Ring& ring;
+        uint8_t pattern[PATTERN_SIZE];
+        double step{}; // Pattern bits per output sample
+        double phase{}; // Position in the pattern, in bits
+        double owed{}; // Fractional sample carried to the next slice
+};
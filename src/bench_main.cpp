@@ -0,0 +1,333 @@
+#include <chip_8.hpp>
+#include <headless.hpp>
+#include <thread_pool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#endif
+
+/**
+ * Benchmark suite
+ * Microbenchmarks run small hand-assembled programs that repeat one instruction
+ * (plus a jump back), so the time per instruction is the cost of that opcode.
+ * The corpus run plays every ROM in a directory headless, in parallel, for a fixed
+ * number of frames. Results are written as JSON with one result per line, and
+ * --compare checks them against an earlier run: a changed video hash is a behavior
+ * change, and anything more than --threshold percent slower is a slowdown.
+ */
+
+static void Usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--roms <dir>] [--frames N] [--ipf N] [--threads N] [--out <file>] [--compare <results>] [--threshold <percent>] [--skip-micro]\n";
+    std::exit(EXIT_FAILURE);
+}
+
+struct MicroResult {
+    std::string name;
+    double ns_per_instruction;
+};
+
+struct RomResult {
+    std::string rom;
+    HeadlessReport report;
+};
+
+// A program that repeats one instruction, preceded by some setup and followed by a jump back to the repeats
+static std::vector<uint8_t> Program(std::vector<uint16_t> const& setup, uint16_t repeated, unsigned int repeats) {
+    std::vector<uint16_t> words(setup);
+    uint16_t loop = PROGRAM_ADDRESS + 2 * setup.size();
+
+    words.insert(words.end(), repeats, repeated);
+    words.push_back(0x1000 | loop);
+
+    std::vector<uint8_t> rom;
+    for(uint16_t word : words) {
+        rom.push_back(word >> 8);
+        rom.push_back(word & 0xFF);
+    }
+    return rom;
+}
+
+// Best of a few timed batches, in nanoseconds per instruction
+static double Time(std::vector<uint8_t> const& rom, bool cycle) {
+    const uint64_t BATCH = 1u << 20;
+    const unsigned int REPEATS = 5;
+
+    Chip8 chip8(1);
+    chip8.LoadROM(rom.data(), rom.size());
+    chip8.Run(BATCH / 8); // Warm up the decode cache
+
+    double best = 1e30;
+    for(unsigned int repeat = 0; repeat < REPEATS; repeat++) {
+        auto start = std::chrono::steady_clock::now();
+
+        if(cycle) {
+            for(uint64_t i = 0; i < BATCH; i++) chip8.Cycle();
+        }
+        else {
+            chip8.Run(BATCH);
+        }
+
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, ns / BATCH);
+    }
+
+    return best;
+}
+
+static std::vector<MicroResult> RunMicro() {
+    std::vector<MicroResult> results;
+
+    // Dispatch: ADD V0, 1 can't be fused, so every instruction is one trip through the loop
+    std::vector<uint8_t> add = Program({}, 0x7001, 64);
+    results.push_back({"dispatch_cycle", Time(add, true)});
+    results.push_back({"dispatch_run", Time(add, false)});
+
+    // DRW V0, V1, n with the sprite read from the program itself, at a few heights and positions
+    struct Draw { char const* name; uint8_t x; uint8_t y; uint8_t height; };
+    static const Draw draws[] = {
+        {"draw_h1_aligned", 0, 0, 1},
+        {"draw_h5_aligned", 8, 4, 5},
+        {"draw_h15_aligned", 16, 8, 15},
+        {"draw_h5_unaligned", 3, 4, 5},
+        {"draw_h15_unaligned", 37, 8, 15},
+        {"draw_h15_clipped_right", 60, 8, 15},
+        {"draw_h15_clipped_bottom", 20, 28, 15},
+    };
+    for(Draw const& draw : draws) {
+        std::vector<uint8_t> rom = Program({static_cast<uint16_t>(0x6000 | draw.x), static_cast<uint16_t>(0x6100 | draw.y), 0xA200}, 0xD010 | draw.height, 32);
+        results.push_back({draw.name, Time(rom, false)});
+    }
+
+    results.push_back({"cls", Time(Program({}, 0x00E0, 64), false)});
+
+    // Memory ops, all aimed well past the code so they don't invalidate it
+    results.push_back({"bcd_fx33", Time(Program({0x60FF, 0xA800}, 0xF033, 32), false)});
+    results.push_back({"store_fx55_v0_vf", Time(Program({0xA800}, 0xFF55, 32), false)});
+    results.push_back({"load_fx65_v0_vf", Time(Program({0xA800}, 0xFF65, 32), false)});
+
+    return results;
+}
+
+static std::vector<std::string> ListROMs(std::string const& directory) {
+    std::vector<std::string> roms;
+
+#if !defined(_WIN32)
+    DIR* dir = opendir(directory.c_str());
+    if(!dir) {
+        return roms;
+    }
+
+    while(dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if(name.size() > 4 && (name.compare(name.size() - 4, 4, ".ch8") == 0 || name.compare(name.size() - 4, 4, ".c8") == 0)) {
+            roms.push_back(name);
+        }
+    }
+    closedir(dir);
+#endif
+
+    std::sort(roms.begin(), roms.end());
+    return roms;
+}
+
+static std::vector<RomResult> RunCorpus(std::string const& directory, std::vector<std::string> const& roms, HeadlessConfig const& config, unsigned int threads) {
+    std::vector<RomResult> results(roms.size());
+    ThreadPool pool(threads);
+
+    pool.ParallelFor(roms.size(), 1, [&](size_t first, size_t last) {
+        for(size_t i = first; i < last; i++) {
+            Chip8 chip8(1); // Fixed seed, so the video hash only changes when behavior does
+            results[i].rom = roms[i];
+
+            if(chip8.LoadROM((directory + "/" + roms[i]).c_str())) {
+                results[i].report = RunHeadless(chip8, config, nullptr);
+            }
+        }
+    });
+
+    return results;
+}
+
+// Pull "key": value out of one of our own result lines
+static bool Field(std::string const& line, char const* key, std::string& value) {
+    std::string pattern = std::string("\"") + key + "\": ";
+    size_t start = line.find(pattern);
+    if(start == std::string::npos) {
+        return false;
+    }
+
+    start += pattern.size();
+    if(line[start] == '"') {
+        size_t end = line.find('"', start + 1);
+        value = line.substr(start + 1, end - start - 1);
+    }
+    else {
+        value = line.substr(start, line.find_first_of(",}", start) - start);
+    }
+    return true;
+}
+
+// Compare against an earlier run, returns the number of regressions
+static unsigned int Compare(const char* filename, std::vector<MicroResult> const& micro, std::vector<RomResult> const& roms, double threshold) {
+    std::ifstream file(filename);
+    if(!file.is_open()) {
+        std::cerr << "Could not open results to compare against: " << filename << "\n";
+        return 1;
+    }
+
+    std::map<std::string, double> old_ns; // Microbenchmark -> ns per instruction
+    std::map<std::string, std::pair<double, std::string>> old_roms; // ROM -> instructions/sec, video hash
+
+    std::string line;
+    while(std::getline(file, line)) {
+        std::string name, value, hash;
+
+        if(Field(line, "name", name) && Field(line, "ns_per_instruction", value)) {
+            old_ns[name] = std::strtod(value.c_str(), nullptr);
+        }
+        else if(Field(line, "rom", name) && Field(line, "instructions_per_s", value) && Field(line, "video_hash", hash)) {
+            old_roms[name] = std::make_pair(std::strtod(value.c_str(), nullptr), hash);
+        }
+    }
+
+    unsigned int regressions = 0;
+    double limit = 1.0 + threshold / 100.0;
+
+    for(MicroResult const& result : micro) {
+        auto old = old_ns.find(result.name);
+        if(old != old_ns.end() && result.ns_per_instruction > old->second * limit) {
+            std::fprintf(stderr, "SLOWER  %-28s %.2f -> %.2f ns/instruction\n", result.name.c_str(), old->second, result.ns_per_instruction);
+            regressions++;
+        }
+    }
+
+    for(RomResult const& result : roms) {
+        auto old = old_roms.find(result.rom);
+        if(old == old_roms.end()) {
+            continue;
+        }
+
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(result.report.video_hash));
+        double ips = result.report.wall_seconds > 0 ? (result.report.instructions - result.report.skipped) / result.report.wall_seconds : 0.0;
+
+        if(old->second.second != hash) {
+            std::fprintf(stderr, "CHANGED %-28s video hash %s -> %s\n", result.rom.c_str(), old->second.second.c_str(), hash);
+            regressions++;
+        }
+        if(ips * limit < old->second.first) {
+            std::fprintf(stderr, "SLOWER  %-28s %.0f -> %.0f instructions/s\n", result.rom.c_str(), old->second.first, ips);
+            regressions++;
+        }
+    }
+
+    return regressions;
+}
+
+int main(int argc, char* argv[]) {
+    std::string roms_directory = "roms";
+    HeadlessConfig config;
+    config.max_frames = 60000; // Long enough for instructions/sec to settle, still only milliseconds per ROM
+    unsigned int threads = 0;
+    const char* out_filename = nullptr;
+    const char* compare_filename = nullptr;
+    double threshold = 10.0;
+    bool micro = true;
+
+    for(int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if(!std::strcmp(argv[i], "--roms") && has_value) {
+            roms_directory = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--frames") && has_value) {
+            config.max_frames = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--ipf") && has_value) {
+            config.instructions_per_frame = std::stoul(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--threads") && has_value) {
+            threads = std::stoul(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--out") && has_value) {
+            out_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--compare") && has_value) {
+            compare_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--threshold") && has_value) {
+            threshold = std::stod(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--skip-micro")) {
+            micro = false;
+        }
+        else {
+            Usage(argv[0]);
+        }
+    }
+
+    if(config.max_frames == 0 || config.instructions_per_frame == 0) {
+        Usage(argv[0]);
+    }
+
+    std::vector<MicroResult> micro_results;
+    if(micro) {
+        micro_results = RunMicro();
+    }
+
+    std::vector<std::string> roms = ListROMs(roms_directory);
+    if(roms.empty()) {
+        std::cerr << "No ROMs (*.ch8, *.c8) found in " << roms_directory << "\n";
+    }
+    std::vector<RomResult> rom_results = RunCorpus(roms_directory, roms, config, threads);
+
+    // One result per line, so the file diffs well and --compare can read it back without a JSON parser
+    std::string json = "{\n  \"benchmarks\": [\n";
+    for(size_t i = 0; i < micro_results.size(); i++) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"ns_per_instruction\": %.3f}%s\n", micro_results[i].name.c_str(),
+                      micro_results[i].ns_per_instruction, i + 1 < micro_results.size() ? "," : "");
+        json += line;
+    }
+    json += "  ],\n  \"roms\": [\n";
+    for(size_t i = 0; i < rom_results.size(); i++) {
+        HeadlessReport const& report = rom_results[i].report;
+        double ips = report.wall_seconds > 0 ? (report.instructions - report.skipped) / report.wall_seconds : 0.0; // Only what actually ran
+
+        char line[512];
+        std::snprintf(line, sizeof(line), "    {\"rom\": \"%s\", \"frames\": %llu, \"instructions\": %llu, \"skipped_instructions\": %llu, \"wall_time_s\": %.6f, \"instructions_per_s\": %.0f, \"video_hash\": \"%016llx\"}%s\n",
+                      rom_results[i].rom.c_str(), static_cast<unsigned long long>(report.frames), static_cast<unsigned long long>(report.instructions),
+                      static_cast<unsigned long long>(report.skipped), report.wall_seconds, ips, static_cast<unsigned long long>(report.video_hash), i + 1 < rom_results.size() ? "," : "");
+        json += line;
+    }
+    json += "  ]\n}\n";
+
+    if(out_filename) {
+        std::ofstream out(out_filename);
+        if(!(out << json)) {
+            std::cerr << "Could not write results: " << out_filename << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+    else {
+        std::fputs(json.c_str(), stdout);
+    }
+
+    if(compare_filename) {
+        unsigned int regressions = Compare(compare_filename, micro_results, rom_results, threshold);
+        std::fprintf(stderr, "%u regression%s against %s\n", regressions, regressions == 1 ? "" : "s", compare_filename);
+        return regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,12 +1,23 @@
-#include <fstream>
+#include <algorithm>
 #include <chrono>
 #include <random>
 #include <cstring>
 #include <chip_8.hpp>
+#include <aot.hpp>
+#include <jit_x64.hpp>
+#include <mapped_file.hpp>
+#ifdef CHIP8_PROFILE
+#include <profiler.hpp>
+#endif
+#ifdef CHIP8_TRACE
+#include <tracer.hpp>
+#endif
 
 const unsigned int FONTSET_SIZE = 80; // 16 chars * 5 bytes = 80 byte array
-const unsigned int START_ADDRESS = 0x200; // Starting address for all CHIP-8 ROMS
+const unsigned int START_ADDRESS = PROGRAM_ADDRESS; // Starting address for all CHIP-8 ROMS
 const unsigned int FONTSET_ADDRESS = 0x50; // Address of the fontset (within the reserved CHIP-8 memory)
+const unsigned int BIGFONT_SIZE = 160; // 16 chars * 10 bytes
+const unsigned int BIGFONT_ADDRESS = FONTSET_ADDRESS + FONTSET_SIZE; // SUPER-CHIP's big digits, right after the small ones
 
 /**
  * Each number/letter is represented by a series of five
@@ -39,93 +50,388 @@ uint8_t fontset[FONTSET_SIZE] = {
         0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
-Chip8::Chip8() 
-: rand_gen(std::chrono::system_clock::now().time_since_epoch().count()){
+// The same digits 8 pixels wide and 10 tall, for Fx30 (all 16, like XO-CHIP, not just SUPER-CHIP's 0-9)
+uint8_t bigfont[BIGFONT_SIZE] = {
+        0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+        0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+        0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+        0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+        0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+        0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+        0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+        0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+        0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+Chip8::Chip8()
+: Chip8(std::chrono::system_clock::now().time_since_epoch().count()) {
+}
+
+Chip8::Chip8(unsigned int seed)
+: rand_gen(seed) {
     pc = START_ADDRESS; // Initialize the PC
     randByte = std::uniform_int_distribution<uint8_t>(0, 255U); // Initialize the RNG
 
     // Load the fontset into memory
-    for(int i = 0; i < FONTSET_SIZE; i++) {
+    for(unsigned int i = 0; i < FONTSET_SIZE; i++) {
         memory[FONTSET_ADDRESS + i] = fontset[i];
     }
+    memcpy(memory.Data() + BIGFONT_ADDRESS, bigfont, BIGFONT_SIZE);
+}
+
+Memory& Memory::operator=(Memory&& other) {
+    memcpy(classic, other.classic, sizeof(classic));
+    xo = std::move(other.xo);
+    bytes = xo ? xo.get() : classic;
+    mask = other.mask;
+    return *this;
+}
+
+void Memory::Extend() {
+    if(xo) {
+        return;
+    }
+
+    xo.reset(new uint8_t[XO_MEMORY_SIZE]());
+    memcpy(xo.get(), classic, sizeof(classic));
+    bytes = xo.get();
+    mask = XO_MEMORY_SIZE - 1u;
+}
+
+void Memory::Shrink() {
+    if(!xo) {
+        return;
+    }
+
+    memcpy(classic, xo.get(), sizeof(classic));
+    xo.reset();
+    bytes = classic;
+    mask = MEMORY_SIZE - 1u;
+}
+
+Chip8::Chip8(Chip8&&) = default;
+Chip8& Chip8::operator=(Chip8&&) = default;
+Chip8::~Chip8() = default;
+
+bool Chip8::SetEngine(Engine engine) {
+    if(engine == Engine::Interpreter) {
+        jit.reset();
+        aot.reset();
+        return true;
+    }
+
+    if(InterpreterOnly()) {
+        return false;
+    }
 
-    // Set up function pointer table
-    table[0x0] = &Chip8::Table0; // Redirect to Table0
-    table[0x1] = &Chip8::OP_1nnn;
-    table[0x2] = &Chip8::OP_2nnn;
-    table[0x3] = &Chip8::OP_3xkk;
-    table[0x4] = &Chip8::OP_4xkk;
-    table[0x5] = &Chip8::OP_5xy0;
-    table[0x6] = &Chip8::OP_6xkk;
-    table[0x7] = &Chip8::OP_7xkk;
-    table[0x8] = &Chip8::Table8; // Redirect to Table8
-    table[0x9] = &Chip8::OP_9xy0;
-    table[0xA] = &Chip8::OP_Annn;
-    table[0xB] = &Chip8::OP_Bnnn;
-    table[0xC] = &Chip8::OP_Cxkk;
-    table[0xD] = &Chip8::OP_Dxyn;
-    table[0xE] = &Chip8::TableE; // Redirect to TableE
-    table[0xF] = &Chip8::TableF; // Redirect to TableF
-
-    table0[0x0] = &Chip8::OP_00E0;
-    table0[0xE] = &Chip8::OP_00EE;
-
-    table8[0x0] = &Chip8::OP_8xy0;
-    table8[0x1] = &Chip8::OP_8xy1;
-    table8[0x2] = &Chip8::OP_8xy2;
-    table8[0x3] = &Chip8::OP_8xy3;
-    table8[0x4] = &Chip8::OP_8xy4;
-    table8[0x5] = &Chip8::OP_8xy5;
-    table8[0x6] = &Chip8::OP_8xy6;
-    table8[0x7] = &Chip8::OP_8xy7;
-    table8[0xE] = &Chip8::OP_8xyE;
-
-    tableE[0x1] = &Chip8::OP_ExA1;
-    tableE[0xE] = &Chip8::OP_Ex9E;
-
-    tableF[0x07] = &Chip8::OP_Fx07;
-    tableF[0x0A] = &Chip8::OP_Fx0A;
-    tableF[0x15] = &Chip8::OP_Fx15;
-    tableF[0x18] = &Chip8::OP_Fx18;
-    tableF[0x1E] = &Chip8::OP_Fx1E;
-    tableF[0x29] = &Chip8::OP_Fx29;
-    tableF[0x33] = &Chip8::OP_Fx33;
-    tableF[0x55] = &Chip8::OP_Fx55;
-    tableF[0x65] = &Chip8::OP_Fx65;
-}
-
-void Chip8::LoadROM(const char* filename) {
-    // Open the ROM as a stream of binary, and move the file pointer to the very end
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-
-    if(file.is_open()) {
-        // Get the size of the file and allocate a buffer to hold the contents
-        std::streampos size = file.tellg(); // Where are we currently (i.e. size of the file)
-        char* rom_buffer = new char[size]; // Allocate an appropriately sized buffer
-
-
-        // Go back to the beginning of the file and fill the buffer
-        file.seekg(0, std::ios::beg); // Go back to the beginning
-        file.read(rom_buffer, size); // Read the ROM into the buffer
-        file.close(); // Clean up the stream
-
-        // Now load the ROM's contents into the CHIP-8 memory, starting at 0x200
-        for(long i = 0; i < size; ++i) {
-            memory[START_ADDRESS + i] = rom_buffer[i];
+    if(engine == Engine::Aot) {
+        AotProgram const* program = AotEngine::Find(*this);
+        if(!program) { // This ROM wasn't compiled in
+            return false;
         }
+        jit.reset();
+        aot.reset(new AotEngine(*program, *this));
+        code_write_first = 0xFFFF; // The engine just checked all of RAM
+        code_write_last = 0;
+        return true;
+    }
 
-        // Free the buffer
-        delete[] rom_buffer;
+    if(!jit) {
+        std::unique_ptr<JitX64> recompiler(new JitX64());
+        if(!recompiler->Available()) { // Not x86-64, or the host won't give us executable memory
+            return false;
+        }
+        jit = std::move(recompiler);
     }
+    aot.reset();
+
+    return true;
 }
 
-void Chip8::Cycle() { // Define the CPU cycle loop! (Fetch, Decode, Execute)
-	opcode = (memory[pc] << 8u) | memory[pc + 1];  // Fetch
+bool Chip8::InterpreterOnly() {
+#if defined(CHIP8_PROFILE) || defined(CHIP8_TRACE)
+    return true; // The profiler and tracer only see instructions the interpreter runs
+#else
+    return false;
+#endif
+}
+
+bool Chip8::LoadROM(const char* filename) {
+    // Map the ROM instead of reading it through a stream into a temporary buffer
+    MappedFile file;
+
+    if(!file.Open(filename) || file.Size() == 0) {
+        return false;
+    }
+
+    return LoadROM(file.Data(), file.Size());
+}
+
+bool Chip8::LoadROM(uint8_t const* data, size_t size) {
+    static const uint8_t zeros[XO_MEMORY_SIZE]{};
+
+    // The ROM goes at 0x200 and the rest of memory is cleared. A ROM that doesn't fit even XO-CHIP's 64 KB isn't a CHIP-8 ROM.
+    if(size > XO_MAX_ROM_SIZE) {
+        return false;
+    }
+
+    if(size > MAX_ROM_SIZE) { // Only an XO-CHIP ROM gets (and pays for) the 64 KB
+        memory.Extend();
+        extended = true;
+    }
+    else {
+        memory.Shrink();
+    }
+
+    WriteMemory(START_ADDRESS, data, size);
+    WriteMemory(START_ADDRESS + size, zeros, memory.Size() - START_ADDRESS - size);
+    return true;
+}
+
+void Chip8::LoadProgram(uint8_t const* image) {
+    // One straight copy, then every decoded entry over program memory goes stale at once. Images are classic ROMs,
+    // so whatever an XO-CHIP ROM left past 4 KB goes too
+    memory.Shrink();
+    memcpy(memory.Data() + START_ADDRESS, image, MAX_ROM_SIZE);
+    InvalidateCode(START_ADDRESS, MAX_ROM_SIZE);
+}
+
+void Chip8::Reset(unsigned int seed) {
+    memset(registers, 0, sizeof(registers));
+    memset(stack, 0, sizeof(stack));
+    keypad = 0;
+    memset(&video, 0, sizeof(video));
+    memset(flags, 0, sizeof(flags));
+    planes = 1;
+    memset(audio_pattern, 0, sizeof(audio_pattern));
+    pitch = 64;
+    xo_audio = false;
+    extended = false;
+    index = 0;
+    pc = START_ADDRESS;
+    sp = 0;
+    delay_timer = 0;
+    sound_timer = 0;
+    instruction_count = 0;
+    skipped_count = 0;
+    video_dirty = true;
+    frame_count = 0;
+
+    rand_gen.seed(seed);
+    randByte.reset();
+
+    // XO-CHIP's memory past 4 KB is dropped (LoadROM() allocates it again for a ROM that needs it),
+    // the interpreter area goes back to zeros plus the fonts
+    memory.Shrink();
+    uint8_t interpreter_area[START_ADDRESS]{};
+    memcpy(interpreter_area + FONTSET_ADDRESS, fontset, FONTSET_SIZE);
+    memcpy(interpreter_area + BIGFONT_ADDRESS, bigfont, BIGFONT_SIZE);
+    WriteMemory(0, interpreter_area, START_ADDRESS);
+}
+
+/**
+ * Save states
+ * Little-endian, fields in a fixed order so a state can be shared between hosts
+ * (and so consecutive states XOR down to almost nothing, see RewindBuffer).
+ * A classic machine writes version 1, the layout it always had:
+ *   "C8ST", u16 version, u16 reserved, memory[4096], V[16], stack[16] (u16),
+ *   I (u16), PC (u16), SP, DT, ST, keypad (u16 mask), RNG state (u32),
+ *   instruction count (u64), frame count (u64), video[32] (u64)
+ * Once a ROM uses SUPER-CHIP/XO-CHIP state it writes version 2, where bit 0 of the reserved
+ * field says memory is the full 65536 bytes, video is planes[2][128] (u64), and after it come
+ * hires, plane mask, flags[16], audio pattern[16], pitch, XO audio.
+ */
+
+static uint8_t* Put(uint8_t* out, uint64_t value, unsigned int bytes) {
+    for(unsigned int i = 0; i < bytes; i++) *out++ = static_cast<uint8_t>(value >> (8 * i));
+    return out;
+}
+
+static uint64_t Get(uint8_t const*& in, unsigned int bytes) {
+    uint64_t value = 0;
+    for(unsigned int i = 0; i < bytes; i++) value |= static_cast<uint64_t>(*in++) << (8 * i);
+    return value;
+}
+
+size_t Chip8::SaveState(uint8_t* state) const {
+    uint8_t* out = state;
+
+    memcpy(out, "C8ST", 4);
+    out = Put(out + 4, extended ? STATE_VERSION : 1, 2);
+    out = Put(out, memory.Extended(), 2);
+
+    memcpy(out, memory.Data(), memory.Size());
+    out += memory.Size();
+    memcpy(out, registers, sizeof(registers));
+    out += sizeof(registers);
+    for(uint16_t level : stack) out = Put(out, level, 2);
+
+    out = Put(out, index, 2);
+    out = Put(out, pc, 2);
+    out = Put(out, sp, 1);
+    out = Put(out, delay_timer, 1);
+    out = Put(out, sound_timer, 1);
+    out = Put(out, keypad, 2);
+    out = Put(out, rand_gen.state, 4);
+    out = Put(out, instruction_count, 8);
+    out = Put(out, frame_count, 8);
+    if(!extended) { // Plane 0 in low resolution is all a classic ROM can have drawn
+        for(unsigned int row = 0; row < VIDEO_HEIGHT; row++) out = Put(out, video.planes[0][row], 8);
+        return out - state;
+    }
+    for(auto const& plane : video.planes) {
+        for(uint64_t word : plane) out = Put(out, word, 8);
+    }
+
+    out = Put(out, video.hires, 1);
+    out = Put(out, planes, 1);
+    memcpy(out, flags, sizeof(flags));
+    out += sizeof(flags);
+    memcpy(out, audio_pattern, sizeof(audio_pattern));
+    out += sizeof(audio_pattern);
+    out = Put(out, pitch, 1);
+    out = Put(out, xo_audio, 1);
+    return out - state;
+}
+
+bool Chip8::LoadState(uint8_t const* state, size_t size) {
+    uint8_t const* in = state;
+
+    if(size < STATE_V1_SIZE || memcmp(in, "C8ST", 4)) {
+        return false;
+    }
+    in += 4;
+    unsigned int version = Get(in, 2);
+    unsigned int reserved = Get(in, 2);
+    bool xo_memory = version == STATE_VERSION && (reserved & 1u); // Version 1 has nothing there
+    size_t needed = version == 1 ? STATE_V1_SIZE : xo_memory ? STATE_SIZE : STATE_V2_SIZE;
+    if((version != 1 && version != STATE_VERSION) || size < needed) { // A state may sit in a bigger buffer (e.g. a rewind or movie snapshot)
+        return false;
+    }
 
-    pc += 2; // Increment the PC before we do anything else!
+    // Check every field the machine relies on before touching any of it. The PC and the
+    // return addresses are masked on fetch, so any 16-bit value is one a ROM could have left.
+    uint8_t const* fields = in + (xo_memory ? XO_MEMORY_SIZE : MEMORY_SIZE) + sizeof(registers) + sizeof(stack) + 4; // SP, past I and the PC
+    uint8_t const* seed = fields + 5; // Past SP, DT, ST and the keypad
+    uint32_t rng_state = Get(seed, 4);
+    if(fields[0] > STACK_LEVELS || rng_state < RandomEngine::min() || rng_state > RandomEngine::max()) {
+        return false;
+    }
+    if(version != 1) {
+        uint8_t const* words = seed + 16; // Past the instruction and frame counts
+        uint8_t const* extra = words + sizeof(video.planes); // hires, plane mask, flags, audio pattern, pitch, XO audio
+        if(extra[0] > 1 || extra[1] > 3 || extra[35] > 1) {
+            return false;
+        }
+        unsigned int active = extra[0] ? VIDEO_WORDS : VIDEO_HEIGHT;
+        for(unsigned int plane = 0; plane < VIDEO_PLANES; plane++) { // Nothing past Words(), scrolls and sprites rely on it
+            uint8_t const* unused = words + (plane * VIDEO_WORDS + active) * 8;
+            for(size_t i = 0; i < (VIDEO_WORDS - active) * 8; i++) {
+                if(unused[i]) {
+                    return false;
+                }
+            }
+        }
+    }
 
-	((*this).*(table[(opcode & 0xF000u) >> 12u]))(); // Decode and Execute
+    if(xo_memory) {
+        memory.Extend();
+    }
+    else {
+        memory.Shrink();
+    }
+    WriteMemory(0, in, memory.Size()); // Only code that differs gets decoded (or translated) again
+    in += memory.Size();
+    memcpy(registers, in, sizeof(registers));
+    in += sizeof(registers);
+    for(uint16_t& level : stack) level = Get(in, 2);
+
+    index = Get(in, 2);
+    pc = Get(in, 2);
+    sp = Get(in, 1);
+    delay_timer = Get(in, 1);
+    sound_timer = Get(in, 1);
+
+    keypad = Get(in, 2);
+
+    rand_gen.state = Get(in, 4);
+    instruction_count = Get(in, 8);
+    frame_count = Get(in, 8);
+    memset(&video, 0, sizeof(video));
+    for(unsigned int plane = 0; plane < (version == 1 ? 1 : VIDEO_PLANES); plane++) {
+        for(unsigned int word = 0; word < (version == 1 ? VIDEO_HEIGHT : VIDEO_WORDS); word++) video.planes[plane][word] = Get(in, 8);
+    }
+    video_dirty = true;
+
+    extended = version != 1;
+    if(version == 1) { // Everything else as it is at power-on
+        planes = 1;
+        memset(flags, 0, sizeof(flags));
+        memset(audio_pattern, 0, sizeof(audio_pattern));
+        pitch = 64;
+        xo_audio = false;
+        return true;
+    }
 
+    video.hires = Get(in, 1) != 0;
+    planes = Get(in, 1);
+    memcpy(flags, in, sizeof(flags));
+    in += sizeof(flags);
+    memcpy(audio_pattern, in, sizeof(audio_pattern));
+    in += sizeof(audio_pattern);
+    pitch = Get(in, 1);
+    xo_audio = Get(in, 1) != 0;
+
+    return true;
+}
+
+void Chip8::WriteMemory(uint16_t address, uint8_t const* data, size_t size) {
+    // Only bytes that actually change get written and invalidated, so reloading the same ROM keeps its decoded code
+    size_t i = 0;
+
+    while(i < size) {
+        if(i + 8 <= size && !memcmp(memory.Data() + address + i, data + i, 8)) {
+            i += 8; // Identical stretches (most of the 64 KB, when a ROM is reloaded) go a word at a time
+            continue;
+        }
+        if(memory[address + i] == data[i]) {
+            i++;
+            continue;
+        }
+
+        size_t first = i;
+        while(i < size && memory[address + i] != data[i]) {
+            i++;
+        }
+
+        memcpy(memory.Data() + address + first, data + first, i - first);
+        InvalidateCode(address + first, i - first);
+    }
+}
+
+void Chip8::ExpandVideo(uint32_t* pixels) const {
+    unsigned int width = video.Width();
+
+    for(unsigned int y = 0; y < video.Height(); y++) {
+        for(unsigned int x = 0; x < width; x++) {
+            uint64_t word = video.planes[0][y * video.RowWords() + x / 64];
+            pixels[y * width + x] = (word >> (63u - x % 64)) & 1u ? 0xFFFFFFFF : 0x00000000; // On pixels are white
+        }
+    }
+}
+
+void Chip8::Cycle() { // Define the CPU cycle loop! (Fetch, Decode, Execute)
+    Run(1);
+}
+
+void Chip8::TickTimers() { // Called at 60 Hz by whoever drives the emulator, independent of the instruction rate
     if(delay_timer > 0) { // Decrement the delay timer if it has been set
         delay_timer--;
     }
@@ -135,31 +441,439 @@ void Chip8::Cycle() { // Define the CPU cycle loop! (Fetch, Decode, Execute)
     }
 }
 
+uint64_t Chip8::RunFrames(uint64_t frames, unsigned int instructions_per_frame) {
+    uint64_t executed = 0;
+
+    for(uint64_t frame = 0; frame < frames; frame++) {
+        executed += Run(instructions_per_frame);
+        TickTimers();
+    }
+
+    return executed;
+}
+
+uint64_t Chip8::Run(uint64_t instructions) {
+    run_end = instruction_count + instructions; // Timers and keys only change between batches, so idle loops can skip up to here
+
+    if(jit) {
+        return jit->Run(*this, instructions);
+    }
+    if(aot) {
+        return aot->Run(*this, instructions);
+    }
+
+    return Interpret(instructions);
+}
+
+uint64_t Chip8::Interpret(uint64_t instructions) {
+    uint64_t start = instruction_count;
+    uint64_t end = start + instructions;
+
+    while(instruction_count < end) {
+        uint16_t address = pc & memory.Mask();
+        Instruction const* op;
+        Instruction single;
+
+        if(address < MEMORY_SIZE) {
+            op = &decoded[address]; // Fetch + Decode, straight from the cache
+
+            if(op->length == 0) { // Not decoded yet (or invalidated), decode it now
+                op = &DecodeAt(address);
+            }
+
+            if(op->length > end - instruction_count) { // A superinstruction would overrun the batch, run just its first instruction
+                single = Decode(OpcodeAt(address));
+                op = &single;
+            }
+        }
+        else { // XO-CHIP code past the cache gets decoded every time it runs
+            single = Decode(OpcodeAt(address));
+            op = &single;
+        }
+
+        instruction_count += op->length; // Superinstructions that bail out early give back what they didn't run
+
+#ifdef CHIP8_PROFILE
+        if(profiler) {
+            profiler->Instruction(address, OpcodeAt(address));
+        }
+#endif
+
+#ifdef CHIP8_TRACE
+        if(tracer) {
+            uint16_t opcode = OpcodeAt(address); // Fetched now, Fx55 may write over it
+            uint8_t before[REGISTER_COUNT];
+            memcpy(before, registers, sizeof(before));
+            pc += 2;
+            ((*this).*(op->handler))(*op);
+            Trace(address, opcode, before);
+            continue;
+        }
+#endif
+
+        pc += 2; // Increment the PC before we do anything else!
+
+        ((*this).*(op->handler))(*op); // Execute
+    }
+
+    return instruction_count - start;
+}
+
+#ifdef CHIP8_TRACE
+void Chip8::Trace(uint16_t address, uint16_t opcode, uint8_t const* before) {
+    TraceRecord record;
+    record.pc = address;
+    record.opcode = opcode;
+    record.index = index;
+    record.sp = sp;
+
+    // Most instructions change one register or none, so compare 8 at a time before looking for which
+    record.reg = 0xFF;
+    record.value = 0;
+    uint64_t old_words[2], new_words[2];
+    memcpy(old_words, before, sizeof(old_words));
+    memcpy(new_words, registers, sizeof(new_words));
+    if(old_words[0] != new_words[0] || old_words[1] != new_words[1]) {
+        unsigned int x = 0;
+        while(registers[x] == before[x]) {
+            x++;
+        }
+        record.reg = static_cast<uint8_t>(x);
+        record.value = registers[x];
+    }
+
+    // Only Fx33, Fx55 and 5xy2 write RAM, all starting at I (which none of them changes)
+    record.write_address = 0;
+    record.write_length = 0;
+    record.write_hash = 0;
+    unsigned int x = (opcode >> 8u) & 0xFu;
+    unsigned int y = (opcode >> 4u) & 0xFu;
+    if((opcode & 0xF0FFu) == 0xF033u || (opcode & 0xF0FFu) == 0xF055u || (opcode & 0xF00Fu) == 0x5002u) {
+        record.write_address = index;
+        record.write_length = (opcode & 0xF000u) == 0x5000u ? (x > y ? x - y : y - x) + 1 : (opcode & 0xFFu) == 0x33u ? 3 : x + 1;
+
+        uint32_t hash = 2166136261u;
+        for(unsigned int i = 0; i < record.write_length; i++) {
+            hash = (hash ^ memory[(index + i) & memory.Mask()]) * 16777619u;
+        }
+        record.write_hash = hash;
+    }
+
+    tracer->Record(record);
+}
+#endif
+
 /**
- * Table Helper Functions
+ * Idle loops
+ * Keys and timers only change between Run() batches, so a loop waiting on them keeps
+ * looping until the batch ends. Once one goes around, we skip its remaining whole
+ * iterations in one go: the machine ends up exactly where spinning would have left it.
+ */
+
+unsigned int Chip8::IdleLoopLength(uint16_t head) const {
+    if(head > MEMORY_SIZE - 6) {
+        return 0;
+    }
+
+    uint16_t first = OpcodeAt(head);
+    if(first == (0x1000u | head) || (first & 0xF0FFu) == 0xF00Au || first == 0x00FDu) { // JP to itself, LD Vx, K (only reached while no key is down) or EXIT
+        return 1;
+    }
+
+    // LD Vx, DT; SE/SNE Vx, byte; JP head: polls the delay timer
+    uint16_t skip = OpcodeAt(head + 2);
+    if((first & 0xF0FFu) == 0xF007u && ((skip & 0xF000u) == 0x3000u || (skip & 0xF000u) == 0x4000u)
+            && (skip & 0x0F00u) == (first & 0x0F00u) && OpcodeAt(head + 4) == (0x1000u | head)) {
+        return 3;
+    }
+
+    return 0;
+}
+
+void Chip8::SkipIdleLoop(uint16_t jump_address) {
+#ifdef CHIP8_PROFILE
+    if(profiler) { // The profiler wants to see every iteration
+        return;
+    }
+#endif
+#ifdef CHIP8_TRACE
+    if(tracer) { // So does the tracer
+        return;
+    }
+#endif
+
+    unsigned int length = IdleLoopLength(pc);
+    if(!length || pc + 2 * (length - 1) != jump_address || instruction_count >= run_end) { // Not the back edge of an idle loop
+        return;
+    }
+
+    if(length == 3) { // Only idle if the delay timer keeps the skip from being taken
+        uint16_t skip = OpcodeAt(pc + 2);
+        bool taken = (skip & 0xF000u) == 0x3000u ? delay_timer == (skip & 0xFFu) : delay_timer != (skip & 0xFFu);
+        if(taken) {
+            return;
+        }
+    }
+
+    uint64_t skipped = (run_end - instruction_count) / length * length;
+    instruction_count += skipped;
+    skipped_count += skipped;
+}
+
+bool Chip8::WaitingForKey() const {
+    return (OpcodeAt(pc) & 0xF0FFu) == 0xF00Au && !keypad && !delay_timer && !sound_timer;
+}
+
+/**
+ * Decoding
  * This is your daily reminder that C++ function pointer syntax is miserable.
  * Use Rust next time.
  * You have been warned...
  */
 
-void Chip8::Table0()
-{
-	((*this).*(table0[opcode & 0x000Fu]))();
+uint16_t Chip8::OpcodeAt(uint16_t address) const {
+    return (memory[address & memory.Mask()] << 8u) | memory[(address + 1u) & memory.Mask()];
+}
+
+// Anything not listed is an unknown opcode
+constexpr Chip8::Chip8Func Chip8::Generic(uint16_t opcode) {
+    return (opcode >> 12u) == 0x0 ? ((opcode & 0xFFF0u) == 0x00C0 ? &Chip8::OP_00Cn
+                                   : (opcode & 0xFFF0u) == 0x00D0 ? &Chip8::OP_00Dn
+                                   : opcode == 0x00FB ? &Chip8::OP_00FB
+                                   : opcode == 0x00FC ? &Chip8::OP_00FC
+                                   : opcode == 0x00FD ? &Chip8::OP_00FD
+                                   : opcode == 0x00FE ? &Chip8::OP_00FE
+                                   : opcode == 0x00FF ? &Chip8::OP_00FF
+                                   : (opcode & 0xFu) == 0x0 ? &Chip8::OP_00E0 // Otherwise only the last nibble is decoded, as it always was
+                                   : (opcode & 0xFu) == 0xE ? &Chip8::OP_00EE
+                                   : &Chip8::OP_NULL)
+         : (opcode >> 12u) == 0x1 ? &Chip8::OP_1nnn
+         : (opcode >> 12u) == 0x2 ? &Chip8::OP_2nnn
+         : (opcode >> 12u) == 0x3 ? &Chip8::OP_3xkk
+         : (opcode >> 12u) == 0x4 ? &Chip8::OP_4xkk
+         : (opcode >> 12u) == 0x5 ? ((opcode & 0xFu) == 0x2 ? &Chip8::OP_5xy2
+                                   : (opcode & 0xFu) == 0x3 ? &Chip8::OP_5xy3
+                                   : &Chip8::OP_5xy0)
+         : (opcode >> 12u) == 0x6 ? &Chip8::OP_6xkk
+         : (opcode >> 12u) == 0x7 ? &Chip8::OP_7xkk
+         : (opcode >> 12u) == 0x8 ? ((opcode & 0xFu) == 0x0 ? &Chip8::OP_8xy0
+                                   : (opcode & 0xFu) == 0x1 ? &Chip8::OP_8xy1
+                                   : (opcode & 0xFu) == 0x2 ? &Chip8::OP_8xy2
+                                   : (opcode & 0xFu) == 0x3 ? &Chip8::OP_8xy3
+                                   : (opcode & 0xFu) == 0x4 ? &Chip8::OP_8xy4
+                                   : (opcode & 0xFu) == 0x5 ? &Chip8::OP_8xy5
+                                   : (opcode & 0xFu) == 0x6 ? &Chip8::OP_8xy6
+                                   : (opcode & 0xFu) == 0x7 ? &Chip8::OP_8xy7
+                                   : (opcode & 0xFu) == 0xE ? &Chip8::OP_8xyE
+                                   : &Chip8::OP_NULL)
+         : (opcode >> 12u) == 0x9 ? &Chip8::OP_9xy0
+         : (opcode >> 12u) == 0xA ? &Chip8::OP_Annn
+         : (opcode >> 12u) == 0xB ? &Chip8::OP_Bnnn
+         : (opcode >> 12u) == 0xC ? &Chip8::OP_Cxkk
+         : (opcode >> 12u) == 0xD ? &Chip8::OP_Dxyn
+         : (opcode >> 12u) == 0xE ? ((opcode & 0xFu) == 0x1 ? &Chip8::OP_ExA1
+                                   : (opcode & 0xFu) == 0xE ? &Chip8::OP_Ex9E
+                                   : &Chip8::OP_NULL)
+         : (opcode == 0xF000 ? &Chip8::OP_F000
+          : (opcode & 0xFFu) == 0x01 ? &Chip8::OP_Fn01
+          : opcode == 0xF002 ? &Chip8::OP_F002
+          : (opcode & 0xFFu) == 0x07 ? &Chip8::OP_Fx07
+          : (opcode & 0xFFu) == 0x0A ? &Chip8::OP_Fx0A
+          : (opcode & 0xFFu) == 0x15 ? &Chip8::OP_Fx15
+          : (opcode & 0xFFu) == 0x18 ? &Chip8::OP_Fx18
+          : (opcode & 0xFFu) == 0x1E ? &Chip8::OP_Fx1E
+          : (opcode & 0xFFu) == 0x29 ? &Chip8::OP_Fx29
+          : (opcode & 0xFFu) == 0x30 ? &Chip8::OP_Fx30
+          : (opcode & 0xFFu) == 0x33 ? &Chip8::OP_Fx33
+          : (opcode & 0xFFu) == 0x3A ? &Chip8::OP_Fx3A
+          : (opcode & 0xFFu) == 0x55 ? &Chip8::OP_Fx55
+          : (opcode & 0xFFu) == 0x65 ? &Chip8::OP_Fx65
+          : (opcode & 0xFFu) == 0x75 ? &Chip8::OP_Fx75
+          : (opcode & 0xFFu) == 0x85 ? &Chip8::OP_Fx85
+          : &Chip8::OP_NULL);
+}
+
+#ifndef CHIP8_COMPACT_DISPATCH
+constexpr uint16_t Chip8::Canonical(uint16_t opcode) {
+    return Generic(opcode) == &Chip8::OP_NULL ? 0x0001u // Every unknown opcode does nothing the same way
+         : (opcode >> 12u) == 0x0 ? ((opcode & 0x0F00u) ? opcode & 0x000Fu : opcode) // 0nn0 and 0nnE are 00E0 and 00EE, the 00nn ones all differ
+         : ((opcode >> 12u) == 0x5 && Generic(opcode) == &Chip8::OP_5xy0) || (opcode >> 12u) == 0x9 ? opcode & 0xFFF0u // x, y
+         : (opcode >> 12u) == 0x8 && ((opcode & 0xFu) == 0x6 || (opcode & 0xFu) == 0xE) ? opcode & 0xFF0Fu // Shifts only use x
+         : (opcode >> 12u) == 0xE ? opcode & 0xFF0Fu // x, the last nibble picks the skip
+         : opcode; // Everything else uses every bit
+}
+
+// The handler sees the same operands Decode() would give it, only now the compiler knows them too
+template<uint16_t OPCODE>
+void Chip8::OP_Fixed(Instruction const&) {
+    static constexpr Instruction op{nullptr, OPCODE & 0x0FFFu, (OPCODE & 0x0F00u) >> 8u, (OPCODE & 0x00F0u) >> 4u, OPCODE & 0x00FFu, OPCODE & 0x000Fu, 1};
+    constexpr Chip8Func handler = Generic(OPCODE);
+
+    ((*this).*handler)(op);
+}
+
+// Index sequences (std::index_sequence is C++14), built by doubling so 65536 entries only nest 16 deep
+template<size_t... I> struct OpcodeSequence {
+    typedef OpcodeSequence<I..., (sizeof...(I) + I)...> Doubled;
+};
+template<size_t N> struct MakeOpcodeSequence {
+    typedef typename MakeOpcodeSequence<N / 2>::type::Doubled type;
+};
+template<> struct MakeOpcodeSequence<1> {
+    typedef OpcodeSequence<0> type;
+};
+
+template<size_t... OPCODES>
+struct Chip8::FixedTable<OpcodeSequence<OPCODES...>> {
+    static const Chip8Func handlers[sizeof...(OPCODES)];
+};
+
+// Constant-initialized, so it costs nothing at startup
+template<size_t... OPCODES>
+const Chip8::Chip8Func Chip8::FixedTable<OpcodeSequence<OPCODES...>>::handlers[sizeof...(OPCODES)] = {&Chip8::OP_Fixed<Chip8::Canonical(OPCODES)>...};
+#endif
+
+Chip8::Instruction Chip8::Decode(uint16_t opcode) const {
+    Instruction op;
+
+    // Pull every operand out up front, handlers never touch the raw opcode
+    op.nnn = opcode & 0x0FFFu;
+    op.x = (opcode & 0x0F00u) >> 8u;
+    op.y = (opcode & 0x00F0u) >> 4u;
+    op.kk = opcode & 0x00FFu;
+    op.n = opcode & 0x000Fu;
+    op.length = 1;
+
+    op.handler = Generic(opcode);
+
+    return op;
+}
+
+Chip8::Instruction const& Chip8::DecodeAt(uint16_t address) {
+    uint16_t opcode = OpcodeAt(address);
+    Instruction op = Decode(opcode);
+
+#if defined(CHIP8_PROFILE) || defined(CHIP8_TRACE)
+    unsigned int room = 1; // No superinstructions, so the profiler and tracer see every instruction on their own
+#else
+    // Only fuse with instructions that don't wrap around the end of memory
+    unsigned int room = (MEMORY_SIZE - address) / 2;
+#endif
+    uint16_t next = room > 1 ? OpcodeAt(address + 2) : 0;
+
+    if(room > 1 && (opcode & 0xF000u) == 0xA000u && (next & 0xF000u) == 0xD000u) { // LD I, addr + DRW
+        Instruction draw = Decode(next);
+        op.x = draw.x;
+        op.y = draw.y;
+        op.n = draw.n;
+        op.handler = &Chip8::OP_Annn_Dxyn;
+        op.length = 2;
+    }
+    else if(room > 1 && (next & 0xF000u) == 0x1000u) { // Skip + JP addr is a conditional branch
+        Chip8Func fused = nullptr;
+
+        if(op.handler == &Chip8::OP_3xkk) fused = &Chip8::OP_Skip_1nnn<&Chip8::OP_3xkk>;
+        else if(op.handler == &Chip8::OP_4xkk) fused = &Chip8::OP_Skip_1nnn<&Chip8::OP_4xkk>;
+        else if(op.handler == &Chip8::OP_5xy0) fused = &Chip8::OP_Skip_1nnn<&Chip8::OP_5xy0>;
+        else if(op.handler == &Chip8::OP_9xy0) fused = &Chip8::OP_Skip_1nnn<&Chip8::OP_9xy0>;
+        else if(op.handler == &Chip8::OP_Ex9E) fused = &Chip8::OP_Skip_1nnn<&Chip8::OP_Ex9E>;
+        else if(op.handler == &Chip8::OP_ExA1) fused = &Chip8::OP_Skip_1nnn<&Chip8::OP_ExA1>;
+
+        if(fused) {
+            op.nnn = next & 0x0FFFu; // The skips don't use nnn, so it can hold the jump target
+            op.handler = fused;
+            op.length = 2;
+        }
+    }
+    else if((opcode & 0xF000u) == 0x6000u) { // A run of LD Vx, byte
+        unsigned int length = 1;
+        while(length < MAX_FUSED_LENGTH && length < room && (OpcodeAt(address + 2 * length) & 0xF000u) == 0x6000u) {
+            length++;
+        }
+
+        if(length > 1) {
+            op.handler = &Chip8::OP_6xkk_Run;
+            op.length = length;
+        }
+    }
+
+#ifndef CHIP8_COMPACT_DISPATCH
+    if(op.length == 1) { // Not fused, so it can have the handler made for exactly this opcode
+        op.handler = FixedTable<MakeOpcodeSequence<0xFFFF + 1>::type>::handlers[opcode];
+    }
+#endif
+
+    decoded[address] = op;
+    return decoded[address];
+}
+
+void Chip8::InvalidateCode(uint16_t address, unsigned int length) {
+    address &= memory.Mask();
+    if(address + length > memory.Size()) { // The write wrapped around the end of memory
+        InvalidateCode(0, address + length - memory.Size());
+        length = memory.Size() - address;
+    }
+
+    // Any entry starting up to a full superinstruction before the write may cover it
+    unsigned int reach = 2 * MAX_FUSED_LENGTH - 1;
+    unsigned int first = address >= reach ? address - reach : 0;
+    unsigned int last = address + length < MEMORY_SIZE ? address + length : MEMORY_SIZE;
+    if(first >= last) { // XO-CHIP memory past the cache, nothing there was decoded or translated
+        return;
+    }
+
+    for(unsigned int i = first; i < last; i++) {
+        decoded[i].length = 0;
+    }
+
+    // Let the JIT know, it drops any translated block in this range (the AOT engine rechecks its blocks)
+    if(address < code_write_first) {
+        code_write_first = address;
+    }
+    if(last > code_write_last) {
+        code_write_last = last;
+    }
 }
 
-void Chip8::Table8()
-{
-	((*this).*(table8[opcode & 0x000Fu]))();
+/**
+ * SUPERINSTRUCTIONS!
+ * Each one behaves exactly like the guest instructions it replaces.
+ * The PC has already moved past the first instruction when these run.
+ */
+
+// LD I, addr + DRW Vx, Vy, nibble
+void Chip8::OP_Annn_Dxyn(Instruction const& op) {
+    index = op.nnn; // LD I, addr
+    pc += 2; // Step over the DRW
+    OP_Dxyn(op); // The DRW operands were decoded into x, y and n
 }
 
-void Chip8::TableE()
-{
-	((*this).*(tableE[opcode & 0x000Fu]))();
+// Skip + JP addr: if the skip is taken the jump never runs, otherwise we take the jump
+template<Chip8::Chip8Func SKIP>
+void Chip8::OP_Skip_1nnn(Instruction const& op) {
+    uint16_t jump_pc = pc; // Where the JP lives
+
+    ((*this).*SKIP)(op);
+
+    if(pc != jump_pc) { // Skipped over the JP, so only one instruction ran
+        instruction_count--;
+    }
+    else {
+        pc = op.nnn; // JP addr
+        SkipIdleLoop(jump_pc);
+    }
 }
 
-void Chip8::TableF()
-{
-	((*this).*(tableF[opcode & 0x00FFu]))();
+// A run of LD Vx, byte
+void Chip8::OP_6xkk_Run(Instruction const& op) {
+    uint16_t address = pc - 2; // Start of the run
+
+    for(unsigned int i = 0; i < op.length; i++) {
+        registers[memory[address] & 0x0Fu] = memory[address + 1]; // LD Vx, byte
+        address += 2;
+    }
+
+    pc = address;
 }
 
 /**
@@ -168,117 +882,124 @@ void Chip8::TableF()
  */
 
 // NULL: Do nothing (Catch-all in case the table gets clobbered)
-void Chip8::OP_NULL() {
+void Chip8::OP_NULL(Instruction const&) {
     // Do nothing
 }
 
 // CLS: Clear the display
-void Chip8::OP_00E0() { 
-    memset(video, 0, sizeof(video)); // CLS: Set the entire video buffer to zero (clear the screen!)
+void Chip8::OP_00E0(Instruction const&) { 
+    for(unsigned int plane = 0; plane < VIDEO_PLANES; plane++) {
+        if((planes >> plane) & 1u) { // CLS: Clear every row of the plane at once (256 bytes in low resolution)
+            memset(video.planes[plane], 0, video.Words() * sizeof(uint64_t));
+        }
+    }
+    video_dirty = true;
 } 
 
 // RET: Return from a subroutine
-void Chip8::OP_00EE() {
+void Chip8::OP_00EE(Instruction const&) {
     sp--; // Decrement the stack pointer
-    pc = stack[sp]; // Set the PC to the new stack frame
+    pc = stack[sp & (STACK_LEVELS - 1u)]; // Set the PC to the new stack frame (a ROM that returns more than it called wraps around the stack)
 }
 
 // JP addr: Jump to location nnn
-void Chip8::OP_1nnn() {
-    uint16_t address = opcode & 0x0FFFu; // Parse out the address
+void Chip8::OP_1nnn(Instruction const& op) {
+    uint16_t address = op.nnn; // Pre-decoded address
+    uint16_t jump_pc = pc - 2; // Where the JP lives
     pc = address; // Set the PC to the address we're jumping to
+    SkipIdleLoop(jump_pc);
 }
 
 // CALL addr: Call subroutine at nnn
-void Chip8::OP_2nnn() {
-    uint16_t address = opcode & 0x0FFFu; // Parse out the address
-    stack[sp] = pc; // Store the PC on the stack
+void Chip8::OP_2nnn(Instruction const& op) {
+    uint16_t address = op.nnn; // Pre-decoded address
+    stack[sp & (STACK_LEVELS - 1u)] = pc; // Store the PC on the stack (calls past 16 levels deep wrap around it)
     sp++; // Increment the stack pointer
     pc = address; // Set the PC to the address we're jumping to
 } 
 
 // SE Vx, byte: Skip next instruction if Vx == kk
-void Chip8::OP_3xkk() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse register number using bitmask
-	uint8_t byte = opcode & 0x00FFu; // Parse byte using bitmask
+void Chip8::OP_3xkk(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+	uint8_t byte = op.kk; // Pre-decoded byte
 
 	if (registers[Vx] == byte) { // If the value at register Vx == the byte in question
-		pc += 2; // Skip the next instruction (increment PC by *TWO*)
+		SkipNext(); // Skip the next instruction (increment PC by *TWO*, or four over an F000 nnnn)
 	}
 } 
 
 // SNE Vx, byte: Skip next instruction if Vx != kk
-void Chip8::OP_4xkk() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse register number using bitmask
-	uint8_t byte = opcode & 0x00FFu; // Parse byte using bitmask
+void Chip8::OP_4xkk(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+	uint8_t byte = op.kk; // Pre-decoded byte
 
 	if (registers[Vx] != byte) { // If the value at register Vx != the byte in question
-		pc += 2; // Skip the next instruction (increment PC by *TWO*)
+		SkipNext(); // Skip the next instruction (increment PC by *TWO*, or four over an F000 nnnn)
 	}
 }
 
 // SE Vx, Vy: Skip next instruction if Vx == Vy
-void Chip8::OP_5xy0(){
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
+void Chip8::OP_5xy0(Instruction const& op){
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t Vy = op.y; // Pre-decoded Vy register number
 
     if(registers[Vx] == registers[Vy]) { // If the value at register Vx == value at register Vy
-        pc += 2; // Skip the next instruction
+        SkipNext(); // Skip the next instruction
     }
 } 
 
 // LD Vx, byte: Set Vx = kk
-void Chip8::OP_6xkk() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse register number using bitmask
-	uint8_t byte = opcode & 0x00FFu; // Parse byte using bitmask
+void Chip8::OP_6xkk(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+	uint8_t byte = op.kk; // Pre-decoded byte
 
     registers[Vx] = byte; // Set the value at Vx equal to the byte
 } 
 
 // ADD Vx, byte: Set Vx = Vx + kk
-void Chip8::OP_7xkk() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse register number using bitmask
-	uint8_t byte = opcode & 0x00FFu; // Parse byte using bitmask
+void Chip8::OP_7xkk(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+	uint8_t byte = op.kk; // Pre-decoded byte
 
     registers[Vx] += byte; // Set the Vx = Vx + byte
 } 
 
 // LD Vx, Vy: Set Vx = Vy
-void Chip8::OP_8xy0() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
+void Chip8::OP_8xy0(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t Vy = op.y; // Pre-decoded Vy register number
 
-    registers[Vx] = registers[Vx]; // Set Vx = Vy
+    registers[Vx] = registers[Vy]; // Set Vx = Vy
 } 
 
 // OR Vx, Vy: Set Vx = Vx OR Vy
-void Chip8::OP_8xy1() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
+void Chip8::OP_8xy1(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t Vy = op.y; // Pre-decoded Vy register number
 
     registers[Vx] |= registers[Vy]; // Set Vx |= Vy
 } 
 
 // AND Vx, Vy: Set Vx = Vx AND 
-void Chip8::OP_8xy2() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
+void Chip8::OP_8xy2(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t Vy = op.y; // Pre-decoded Vy register number
 
     registers[Vx] &= registers[Vy]; // Set Vx &= Vy
 } 
 
 // XOR Vx, Vy: Set Vx = Vx XOR Vy
-void Chip8::OP_8xy3() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
+void Chip8::OP_8xy3(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t Vy = op.y; // Pre-decoded Vy register number
 
     registers[Vx] ^= registers[Vy]; // Set Vx ^= Vy
 } 
 
 // ADD Vx, Vy: Set Vx = Vx + Vy, set VF = carry. (VF is overflow flag)
-void Chip8::OP_8xy4() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
+void Chip8::OP_8xy4(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t Vy = op.y; // Pre-decoded Vy register number
 
     uint16_t sum = registers[Vx] + registers[Vy]; // Add the registers Vx and Vy
 
@@ -293,9 +1014,9 @@ void Chip8::OP_8xy4() {
 } 
 
 // SUB Vx, Vy: Set Vx = Vx - Vy, set VF = carry. (VF is underflow flag)
-void Chip8::OP_8xy5() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
+void Chip8::OP_8xy5(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t Vy = op.y; // Pre-decoded Vy register number
 
     if(registers[Vx] > registers[Vy]) { // If Vx > Vy
         registers[0xF] = 1; // Set the flag register (VF) to 1
@@ -308,8 +1029,8 @@ void Chip8::OP_8xy5() {
 } 
 
 // SHR Vx: Set Vx = Vx SHR 1. (Right shift, save remainder in VF)
-void Chip8::OP_8xy6() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_8xy6(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     registers[0xF] = (registers[Vx] & 0x1u); // Save the LSB to VF
 
@@ -317,9 +1038,9 @@ void Chip8::OP_8xy6() {
 } 
 
 // SUBN Vx, Vy: Set Vx = Vy - Vx, set VF = NOT borrow
-void Chip8::OP_8xy7() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
+void Chip8::OP_8xy7(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t Vy = op.y; // Pre-decoded Vy register number
 
     if(registers[Vy] > registers[Vx]) { // If Vy > Vx
         registers[0xF] = 1; // Set the flag register (VF) to 1
@@ -332,8 +1053,8 @@ void Chip8::OP_8xy7() {
 } 
 
 // SHL Vx {, Vy}: Set Vx = Vx SHL 1. (Left shift, save MSB in VF)
-void Chip8::OP_8xyE() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_8xyE(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     registers[0xF] = (registers[Vx] & 0x80u) >> 7u; // Save the MSB to VF
 
@@ -341,180 +1062,211 @@ void Chip8::OP_8xyE() {
 } 
 
 // SNE Vx, Vy: Skip next instruction if Vx != Vy
-void Chip8::OP_9xy0() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
+void Chip8::OP_9xy0(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t Vy = op.y; // Pre-decoded Vy register number
 
     if(registers[Vx] != registers[Vy]) { // If the value at register Vx != value at register Vy
-        pc += 2; // Skip the next instruction
+        SkipNext(); // Skip the next instruction
     }
 } 
 
 // LD I, addr: Set I = nnn
-void Chip8::OP_Annn() {
-    uint16_t address = opcode &= 0x0FFFu; // Parse the address using bitmask
+void Chip8::OP_Annn(Instruction const& op) {
+    uint16_t address = op.nnn; // Pre-decoded address
 
     index = address; // Set the index register equal to the address
 } 
 
 // JP V0, addr: Jump to location nnn + V0
-void Chip8::OP_Bnnn() {
-    uint16_t address = opcode &= 0x0FFFu; // Parse the address using bitmask
+void Chip8::OP_Bnnn(Instruction const& op) {
+    uint16_t address = op.nnn; // Pre-decoded address
 
     pc = registers[0] + address; // Set the PC to V0 + address
 }
 
 // RND Vx, byte: Set Vx = random byte AND kk
-void Chip8::OP_Cxkk() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-    uint8_t byte = opcode & 0x00FFu; // Parse the byte
+void Chip8::OP_Cxkk(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+    uint8_t byte = op.kk; // Pre-decoded byte
 
     registers[Vx] = randByte(rand_gen) & byte; // Set Vx = randByte & byte
 } 
 
 // DRW Vx, Vy, nibble: Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision.
-void Chip8::OP_Dxyn() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
-	uint8_t Vy = (opcode & 0x00F0u) >> 4u; // Parse Vy reg number using bitmask
-	uint8_t height = opcode & 0x000Fu; // Parse height using bitmask
+void Chip8::OP_Dxyn(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+	uint8_t Vy = op.y; // Pre-decoded Vy register number
+	uint8_t height = op.n; // Pre-decoded height
+
+    // The starting position wraps, the sprite itself is clipped at the screen edges
+    // SUPER-CHIP and XO-CHIP drawing. Dxy0 is only a 16x16 sprite once the ROM has switched an extension on,
+    // a classic ROM's Dxy0 draws nothing, as it always did
+    if(video.hires || planes != 1 || (height == 0 && extended)) {
+        DrawPlanes(registers[Vx], registers[Vy], height);
+        return;
+    }
 
-    // Wrap if we go beyond the screen boundaries!
     uint8_t x_pos = registers[Vx] % VIDEO_WIDTH;
     uint8_t y_pos = registers[Vy] % VIDEO_HEIGHT;
 
-    registers[0xF] = 0; // Set VF = 0
+    unsigned int rows = height < VIDEO_HEIGHT - y_pos ? height : VIDEO_HEIGHT - y_pos; // Rows that are on screen
+    uint64_t collision = 0;
 
-    for(unsigned int row = 0; row < height; row++) { // Iterate over each row of the sprite
+    for(unsigned int row = 0; row < rows; row++) { // Iterate over each row of the sprite
 
-        uint8_t sprite_byte = memory[index + row]; // Access the current sprite byte
+        uint8_t sprite_byte = memory[(index + row) & memory.Mask()]; // Access the current sprite byte
 
-        for(unsigned int col = 0; col < 8; col++) { // Iterate over each bit (pixel) of the current sprite byte
-           
-            uint8_t sprite_pixel = sprite_byte & (0x80u >> col); // Get the current sprite pixel with bitmask
-            uint32_t* screen_pixel = &video[(y_pos + row) * VIDEO_WIDTH + (x_pos + col)]; // Get a pointer to the current screen pixel
+        // Line the sprite byte up with the screen row (pixel 0 is the MSB), anything past the right edge falls off
+        uint64_t sprite_row = (static_cast<uint64_t>(sprite_byte) << 56u) >> x_pos;
 
-            if(sprite_pixel) { // If the sprite pixel is on
+        collision |= video.planes[0][y_pos + row] & sprite_row; // Any pixel that is on in both collides
+        video.planes[0][y_pos + row] ^= sprite_row; // XOR the whole sprite row onto the screen at once
+    }
 
-                if(*screen_pixel == 0xFFFFFFFF) { // If the screen pixel is already on (value at pointer == 0xFFFFFFFF)
-                    registers[0xF] = 1; // Set the flag register (VF) to 1, indicating collision!
-                }
+    registers[0xF] = collision != 0; // Set VF = 1 on collision, 0 otherwise
+    video_dirty = true;
 
-                *screen_pixel ^= 0xFFFFFFFF; // Functionally XOR the screen pixel with the sprite pixel
-            }
+#ifdef CHIP8_PROFILE
+    if(profiler) {
+        unsigned int pixels = 0;
+        for(unsigned int row = 0; row < rows; row++) {
+            pixels += __builtin_popcountll((static_cast<uint64_t>(memory[(index + row) & memory.Mask()]) << 56u) >> x_pos);
         }
+        profiler->Draw(pixels, collision != 0);
     }
+#endif
 } 
 
+// Dxyn on any plane in either resolution, 8xn or (n = 0) 16x16. Each selected plane takes its own sprite,
+// one after the other from I, and every sprite row is one or two word XORs like the classic path
+void Chip8::DrawPlanes(uint8_t x, uint8_t y, uint8_t n) {
+    unsigned int row_words = video.RowWords();
+    unsigned int x_pos = x % video.Width(); // The starting position wraps, the sprite itself is clipped at the screen edges
+    unsigned int y_pos = y % video.Height();
+    unsigned int word = x_pos / 64; // Where the sprite's left edge lands in the row
+    unsigned int shift = x_pos % 64;
+
+    bool wide = n == 0; // 16x16, two bytes a row
+    unsigned int sprite_rows = wide ? 16 : n;
+    unsigned int rows = sprite_rows < video.Height() - y_pos ? sprite_rows : video.Height() - y_pos;
+    unsigned int sprite_size = wide ? 32 : n;
+
+    uint16_t address = index;
+    uint64_t collision = 0;
+#ifdef CHIP8_PROFILE
+    unsigned int pixels = 0;
+#endif
+
+    for(unsigned int plane = 0; plane < VIDEO_PLANES; plane++) {
+        if(!((planes >> plane) & 1u)) {
+            continue;
+        }
+
+        uint64_t* line = video.planes[plane] + y_pos * row_words + word;
+        for(unsigned int row = 0; row < rows; row++, line += row_words) {
+            uint64_t sprite_row = wide ? static_cast<uint64_t>(memory[(address + 2 * row) & memory.Mask()]) << 56u
+                                         | static_cast<uint64_t>(memory[(address + 2 * row + 1) & memory.Mask()]) << 48u
+                                       : static_cast<uint64_t>(memory[(address + row) & memory.Mask()]) << 56u;
+
+            uint64_t left = sprite_row >> shift;
+            collision |= line[0] & left;
+            line[0] ^= left;
+
+            uint64_t right = 0; // What crosses into the right half of a high resolution row, past the right edge it falls off
+            if(shift && word + 1 < row_words) {
+                right = sprite_row << (64u - shift);
+                collision |= line[1] & right;
+                line[1] ^= right;
+            }
+#ifdef CHIP8_PROFILE
+            pixels += __builtin_popcountll(left) + __builtin_popcountll(right);
+#endif
+        }
+
+        address += sprite_size; // The next plane's sprite follows this one
+    }
+
+    registers[0xF] = collision != 0; // VF = 1 if any plane collided
+    video_dirty = true;
+
+#ifdef CHIP8_PROFILE
+    if(profiler) {
+        profiler->Draw(pixels, collision != 0);
+    }
+#endif
+}
+
 // SKP Vx: Skip next instruction if key with the value of Vx is pressed
-void Chip8::OP_Ex9E() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Ex9E(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
 	uint8_t key = registers[Vx]; // Find the expected key value
 
-	if (keypad[key]) { // If that key is pressed
-		pc += 2; // Skip the next instruction
+	if (key < KEY_COUNT && (keypad >> key) & 1u) { // If that key is pressed (there are no keys past F)
+		SkipNext(); // Skip the next instruction
 	}
 } 
 
 // SKNP Vx: Skip next instruction if key with the value of Vx is NOT pressed
-void Chip8::OP_ExA1() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_ExA1(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
 	uint8_t key = registers[Vx]; // Find the expected key value
 
-	if (!keypad[key]) { // If that key is NOT pressed
-		pc += 2; // Skip the next instruction
+	if (key >= KEY_COUNT || !((keypad >> key) & 1u)) { // If that key is NOT pressed
+		SkipNext(); // Skip the next instruction
 	}
 } 
 
 // LD Vx, DT: Set Vx = delay timer value
-void Chip8::OP_Fx07() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Fx07(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     registers[Vx] = delay_timer; // Set Vx = delay_timer
 } 
 
 // LD Vx,K: Wait for a key press, store the value of the key in Vx
-void Chip8::OP_Fx0A() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Fx0A(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
-    if(keypad[0]) { // If zero is pressed on the keypad
-        registers[Vx] = 0; // Vx = 0
-    }
-    else if(keypad[1]) { // If one is pressed on the keypad
-        registers[Vx] = 1; // Vx = 1...and so on
-    }
-    else if(keypad[2]) {
-        registers[Vx] = 2;
-    }
-    else if(keypad[3]) {
-        registers[Vx] = 3;
-    }
-    else if(keypad[4]) {
-        registers[Vx] = 4;
-    }
-    else if(keypad[5]) {
-        registers[Vx] = 5;
-    }
-    else if(keypad[6]) {
-        registers[Vx] = 6;
-    }
-    else if(keypad[7]) {
-        registers[Vx] = 7;
-    }
-    else if(keypad[8]) {
-        registers[Vx] = 8;
-    }
-    else if(keypad[9]) {
-        registers[Vx] = 9;
-    }
-    else if(keypad[10]) {
-        registers[Vx] = 10;
-    }
-    else if(keypad[11]) {
-        registers[Vx] = 11;
-    }
-    else if(keypad[12]) {
-        registers[Vx] = 12;
-    }
-    else if(keypad[13]) {
-        registers[Vx] = 13;
-    }
-    else if(keypad[14]) {
-        registers[Vx] = 14;
-    }
-    else if(keypad[15]) {
-        registers[Vx] = 15;
+    if(keypad) { // The lowest key held down wins
+        uint8_t key = 0;
+        while(!((keypad >> key) & 1u)) {
+            key++;
+        }
+        registers[Vx] = key;
     }
     else {
         pc -= 2; // Easiest way to wait is to just decrement the PC by two until a key is pressed!
+        SkipIdleLoop(pc); // No key goes down before the batch ends, so wait out the rest of it
     }
 } 
 
 // LD DT, Vx: Set delay timer = Vx
-void Chip8::OP_Fx15() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Fx15(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     delay_timer = registers[Vx]; // Set delay_timer = Vx
 } 
 
 // LD ST, Vx: Set sound timer = Vx
-void Chip8::OP_Fx18() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Fx18(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     sound_timer = registers[Vx]; // Set sound_timer = Vx
 } 
 
 // ADD I, Vx: Set I = I + Vx
-void Chip8::OP_Fx1E() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Fx1E(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     index = index + registers[Vx]; // Set index = index + Vx
 } 
 
 // LD F, Vx: Set I = location of sprite for digit Vx
-void Chip8::OP_Fx29() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Fx29(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     uint8_t digit = registers[Vx]; // Get the digit at Vx
 
@@ -522,37 +1274,219 @@ void Chip8::OP_Fx29() {
 } 
 
 // LD B, Vx: Store BCD representation of Vx in memory locations I, I+1, and I+2
-void Chip8::OP_Fx33() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Fx33(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     uint8_t value = registers[Vx]; // Get the value at Vx
 
     // Ones place
-    memory[index + 2] = value % 10;
+    memory[(index + 2) & memory.Mask()] = value % 10;
     value /= 10;
 
     // Tens place
-    memory[index + 1] = value % 10;
+    memory[(index + 1) & memory.Mask()] = value % 10;
     value /= 10;
 
     // Hundreds place
-    memory[index] = value % 10; 
+    memory[index & memory.Mask()] = value % 10; 
+
+    InvalidateCode(index, 3); // We may have just written over code
 } 
 
 // LD [I], Vx: Store registers V0 through Vx in memory starting at location I
-void Chip8::OP_Fx55() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Fx55(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     for (uint8_t i = 0; i <= Vx; i++) { // For each register from V0 through Vx (INCLUSIVE!!!)
-        memory[index + i] = registers[i]; // Set the memory at index + i to the current value of the register
+        memory[(index + i) & memory.Mask()] = registers[i]; // Set the memory at index + i to the current value of the register
     }
+
+    InvalidateCode(index, Vx + 1); // We may have just written over code
 } 
 
 // LD Vx, [I]: Read registers V0 through Vx in memory starting at location I
-void Chip8::OP_Fx65() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u; // Parse Vx reg number using bitmask
+void Chip8::OP_Fx65(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
 
     for (uint8_t i = 0; i <= Vx; i++) { // For each register from V0 through Vx (INCLUSIVE!!!)
-        registers[i] = memory[index + i]; // Read the memory at index + i to the respective register
+        registers[i] = memory[(index + i) & memory.Mask()]; // Read the memory at index + i to the respective register
+    }
+}
+
+/**
+ * SUPER-CHIP and XO-CHIP extensions
+ * Scroll amounts are in pixels of the current resolution, as XO-CHIP (and Octo) have it.
+ * Scrolls, clears and draws only touch the planes selected with Fn01 (just plane 0 until a ROM picks others).
+ */
+
+// SCD nibble: Scroll the selected planes down n pixels
+void Chip8::OP_00Cn(Instruction const& op) {
+    unsigned int words = video.Words();
+    unsigned int shift = op.n * video.RowWords(); // Rows are whole words, so this is one move per plane
+
+    for(unsigned int plane = 0; plane < VIDEO_PLANES; plane++) {
+        if((planes >> plane) & 1u) {
+            memmove(video.planes[plane] + shift, video.planes[plane], (words - shift) * sizeof(uint64_t));
+            memset(video.planes[plane], 0, shift * sizeof(uint64_t)); // Blank rows scroll in at the top
+        }
+    }
+    video_dirty = true;
+}
+
+// SCU nibble: Scroll the selected planes up n pixels
+void Chip8::OP_00Dn(Instruction const& op) {
+    unsigned int words = video.Words();
+    unsigned int shift = op.n * video.RowWords();
+
+    for(unsigned int plane = 0; plane < VIDEO_PLANES; plane++) {
+        if((planes >> plane) & 1u) {
+            memmove(video.planes[plane], video.planes[plane] + shift, (words - shift) * sizeof(uint64_t));
+            memset(video.planes[plane] + words - shift, 0, shift * sizeof(uint64_t)); // Blank rows scroll in at the bottom
+        }
     }
+    video_dirty = true;
+}
+
+// SCR: Scroll the selected planes right 4 pixels
+void Chip8::OP_00FB(Instruction const&) {
+    for(unsigned int plane = 0; plane < VIDEO_PLANES; plane++) {
+        if(!((planes >> plane) & 1u)) {
+            continue;
+        }
+
+        uint64_t* rows = video.planes[plane];
+        if(video.hires) { // The right half takes the low pixels of the left half
+            for(unsigned int y = 0; y < HIRES_HEIGHT; y++) {
+                rows[2 * y + 1] = (rows[2 * y + 1] >> 4u) | (rows[2 * y] << 60u);
+                rows[2 * y] >>= 4u;
+            }
+        }
+        else {
+            for(unsigned int y = 0; y < VIDEO_HEIGHT; y++) {
+                rows[y] >>= 4u; // Pixel 0 is the MSB, so right is down
+            }
+        }
+    }
+    video_dirty = true;
+}
+
+// SCL: Scroll the selected planes left 4 pixels
+void Chip8::OP_00FC(Instruction const&) {
+    for(unsigned int plane = 0; plane < VIDEO_PLANES; plane++) {
+        if(!((planes >> plane) & 1u)) {
+            continue;
+        }
+
+        uint64_t* rows = video.planes[plane];
+        if(video.hires) { // The left half takes the high pixels of the right half
+            for(unsigned int y = 0; y < HIRES_HEIGHT; y++) {
+                rows[2 * y] = (rows[2 * y] << 4u) | (rows[2 * y + 1] >> 60u);
+                rows[2 * y + 1] <<= 4u;
+            }
+        }
+        else {
+            for(unsigned int y = 0; y < VIDEO_HEIGHT; y++) {
+                rows[y] <<= 4u;
+            }
+        }
+    }
+    video_dirty = true;
+}
+
+// EXIT: Stop the interpreter
+void Chip8::OP_00FD(Instruction const&) {
+    pc -= 2; // Nothing to exit to, so stay here for good, like LD Vx, K with no key
+    SkipIdleLoop(pc);
+}
+
+// LOW: Low resolution (64x32)
+void Chip8::OP_00FE(Instruction const&) {
+    extended = true;
+    memset(video.planes, 0, sizeof(video.planes)); // Every plane starts blank in the new mode, which keeps unused words zero
+    video.hires = false;
+    video_dirty = true;
+}
+
+// HIGH: High resolution (128x64)
+void Chip8::OP_00FF(Instruction const&) {
+    extended = true;
+    memset(video.planes, 0, sizeof(video.planes));
+    video.hires = true;
+    video_dirty = true;
+}
+
+// SAVE Vx - Vy: Store Vx through Vy in memory starting at location I, in the order given (Vx first), I unchanged
+void Chip8::OP_5xy2(Instruction const& op) {
+    unsigned int count = (op.x <= op.y ? op.y - op.x : op.x - op.y) + 1;
+    int step = op.x <= op.y ? 1 : -1;
+
+    for(unsigned int i = 0; i < count; i++) {
+        memory[(index + i) & memory.Mask()] = registers[op.x + step * static_cast<int>(i)];
+    }
+
+    InvalidateCode(index, count); // We may have just written over code
+}
+
+// LOAD Vx - Vy: Read Vx through Vy from memory starting at location I, in the order given (Vx first), I unchanged
+void Chip8::OP_5xy3(Instruction const& op) {
+    unsigned int count = (op.x <= op.y ? op.y - op.x : op.x - op.y) + 1;
+    int step = op.x <= op.y ? 1 : -1;
+
+    for(unsigned int i = 0; i < count; i++) {
+        registers[op.x + step * static_cast<int>(i)] = memory[(index + i) & memory.Mask()];
+    }
+}
+
+// LD I, long: Set I = the 16-bit word following this instruction
+void Chip8::OP_F000(Instruction const&) {
+    memory.Extend(); // I can point anywhere in 64 KB from now on
+    extended = true;
+    index = OpcodeAt(pc); // The PC is already on the address word
+    pc += 2; // Step over it
+}
+
+// PLANE n: Select the planes drawing and scrolling act on (0-3, x is the mask)
+void Chip8::OP_Fn01(Instruction const& op) {
+    planes = op.x & 0x3u;
+    extended = true;
+}
+
+// AUDIO: Load the 16-byte audio pattern from memory starting at location I
+void Chip8::OP_F002(Instruction const&) {
+    for(unsigned int i = 0; i < sizeof(audio_pattern); i++) {
+        audio_pattern[i] = memory[(index + i) & memory.Mask()];
+    }
+    xo_audio = true;
+    extended = true;
+}
+
+// LD HF, Vx: Set I = location of the big font sprite for digit Vx
+void Chip8::OP_Fx30(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+
+    index = BIGFONT_ADDRESS + 10 * (registers[Vx] & 0xFu); // Big digits are 10 bytes each
+}
+
+// PITCH Vx: Set the audio pitch register = Vx
+void Chip8::OP_Fx3A(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+
+    pitch = registers[Vx];
+    xo_audio = true;
+    extended = true;
+}
+
+// LD R, Vx: Store V0 through Vx in the user flags
+void Chip8::OP_Fx75(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+
+    memcpy(flags, registers, Vx + 1u); // All 16, like XO-CHIP (SUPER-CHIP had 8)
+    extended = true;
+}
+
+// LD Vx, R: Read V0 through Vx from the user flags
+void Chip8::OP_Fx85(Instruction const& op) {
+    uint8_t Vx = op.x; // Pre-decoded Vx register number
+
+    memcpy(registers, flags, Vx + 1u);
 } 
\ No newline at end of file
@@ -1,52 +1,275 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <random>
+#include <utility>
 
 
 const unsigned int KEY_COUNT = 16;
-const unsigned int MEMORY_SIZE = 4096;
+const unsigned int MEMORY_SIZE = 4096; // Classic RAM, and the window the code cache, JIT and AOT engines cover
 const unsigned int REGISTER_COUNT = 16;
 const unsigned int STACK_LEVELS = 16;
 const unsigned int VIDEO_HEIGHT = 32;
 const unsigned int VIDEO_WIDTH = 64;
+const unsigned int PROGRAM_ADDRESS = 0x200; // ROMs are loaded here
+const unsigned int MAX_ROM_SIZE = 4096 - PROGRAM_ADDRESS; // Everything from PROGRAM_ADDRESS to the end of RAM
+const unsigned int XO_MEMORY_SIZE = 65536; // XO-CHIP RAM, only allocated once a ROM needs more than MEMORY_SIZE
+const unsigned int XO_MAX_ROM_SIZE = XO_MEMORY_SIZE - PROGRAM_ADDRESS; // Biggest ROM LoadROM() takes
+const unsigned int HIRES_WIDTH = 128; // SUPER-CHIP/XO-CHIP high resolution mode
+const unsigned int HIRES_HEIGHT = 64;
+const unsigned int VIDEO_PLANES = 2; // XO-CHIP bitplanes
+const unsigned int VIDEO_WORDS = HIRES_WIDTH / 64 * HIRES_HEIGHT; // 64-bit words per plane, enough for hires
+
+// Save states: "C8ST", a version, then every bit of machine state in a fixed little-endian layout
+const uint16_t STATE_VERSION = 2; // Newest version, only written for machines a ROM took out of classic CHIP-8
+const size_t STATE_SIZE = 67705; // Biggest state: version 2 with all 64 KB of RAM
+const size_t STATE_V1_SIZE = 4437; // Classic machine
+const size_t STATE_V2_SIZE = 6265; // SUPER-CHIP/XO-CHIP machine still on 4 KB of RAM
+
+// SUPER-CHIP/XO-CHIP opcodes: 00Cn, 00Dn, 00FB-00FF, 5xy2, 5xy3, F000, Fn01, F002, Fx30, Fx3A, Fx75, Fx85
+inline bool IsExtendedOpcode(uint16_t opcode) {
+    switch(opcode >> 12) {
+        case 0x0: return (opcode & 0xFFF0) == 0x00C0 || (opcode & 0xFFF0) == 0x00D0 || (opcode >= 0x00FB && opcode <= 0x00FF);
+        case 0x5: return (opcode & 0xF) == 0x2 || (opcode & 0xF) == 0x3;
+        case 0xF: {
+            unsigned int kk = opcode & 0xFF;
+            return opcode == 0xF000 || opcode == 0xF002 || kk == 0x01 || kk == 0x30 || kk == 0x3A || kk == 0x75 || kk == 0x85;
+        }
+        default: return false;
+    }
+}
+
+/**
+ * Display
+ * One bitmask per plane, 64 pixels to a word, pixel 0 of a word in its MSB. Low resolution rows are
+ * one word each, so plane 0 of a 64x32 screen is words 0-31, laid out exactly like the classic
+ * display. High resolution rows are two words (left half first), rows 0-63 in words 0-127.
+ * Words past the active mode's Words() are always zero. Plane 1 is only ever drawn by XO-CHIP ROMs,
+ * pixel values are (plane 1 bit << 1) | plane 0 bit.
+ */
+struct Display {
+    uint64_t planes[VIDEO_PLANES][VIDEO_WORDS];
+    bool hires;
+
+    unsigned int Width() const { return hires ? HIRES_WIDTH : VIDEO_WIDTH; }
+    unsigned int Height() const { return hires ? HIRES_HEIGHT : VIDEO_HEIGHT; }
+    unsigned int RowWords() const { return hires ? 2 : 1; }
+    unsigned int Words() const { return hires ? VIDEO_WORDS : VIDEO_HEIGHT; } // Active words per plane
+};
+
+/**
+ * RAM
+ * The classic 4 KB sits inline. XO-CHIP's 64 KB is only allocated once a ROM needs it (a ROM
+ * over MAX_ROM_SIZE, F000, a state that holds it), so classic machines stay as small as they were.
+ * Addresses wrap at Size(): 4 KB until Extend(), 64 KB after.
+ */
+class Memory {
+    public:
+        Memory() {}
+        Memory(Memory&& other) { *this = std::move(other); }
+        Memory& operator=(Memory&& other);
+
+        uint8_t& operator[](unsigned int address) { return bytes[address]; }
+        uint8_t const& operator[](unsigned int address) const { return bytes[address]; }
+        uint8_t* Data() { return bytes; }
+        uint8_t const* Data() const { return bytes; }
+        unsigned int Size() const { return mask + 1u; }
+        uint16_t Mask() const { return mask; } // Size() - 1, for wrapping addresses
+        bool Extended() const { return mask != MEMORY_SIZE - 1u; }
+
+        void Extend(); // Grow to XO_MEMORY_SIZE, the new part zeroed (nothing if it already is)
+        void Shrink(); // Drop everything past MEMORY_SIZE and free it
+
+    private:
+        uint8_t classic[MEMORY_SIZE]{};
+        std::unique_ptr<uint8_t[]> xo; // All 64 KB once extended
+        uint8_t* bytes{classic};
+        uint16_t mask{MEMORY_SIZE - 1u};
+};
+
+class AotEngine;
+class JitX64;
+class Profiler;
+class Tracer;
+struct AotMachine;
+
+// Park-Miller "minimal standard" LCG: the same sequence as libstdc++'s std::default_random_engine,
+// but the same on every standard library and with a state we can save and restore
+class RandomEngine {
+    public:
+        typedef uint32_t result_type;
+
+        explicit RandomEngine(uint32_t seed = 1) { this->seed(seed); }
+        void seed(uint32_t seed) { state = seed % MODULUS ? seed % MODULUS : 1; }
+        result_type operator()() { state = static_cast<uint64_t>(state) * 16807u % MODULUS; return state; }
+        static constexpr result_type min() { return 1; }
+        static constexpr result_type max() { return MODULUS - 1; }
+
+        uint32_t state; // Last value handed out
+
+    private:
+        static const uint32_t MODULUS = 2147483647u;
+};
+
+// Which engine executes instructions, both give the same observable results
+enum class Engine {
+    Interpreter, // Predecoded interpreter (always available)
+    Jit, // x86-64 dynamic recompiler, falls back to the interpreter for cold code
+    Aot // The ROM's ahead-of-time compiled blocks (see aot.hpp), only for ROMs built in
+};
 
 class Chip8 {
+    friend class JitX64;
+    friend class AotEngine;
+    friend struct AotMachine;
+
     public:
-        uint8_t keypad[16]{}; // Store our keypad mappings
-        uint32_t video[64 * 32]{}; // Display buffer
+        Display video{}; // Display buffer: plane 0 in low resolution is one 64-bit word per row, pixel 0 is the MSB
 
-        Chip8(); // Prototype for constructor
-        void LoadROM(const char* filename); // Prototype for ROM loader
-        void Cycle(); // Prototype for cycler
+        Chip8(); // Prototype for constructor (seeds the RNG from the clock)
+        explicit Chip8(unsigned int seed); // Prototype for constructor with a fixed RNG seed (reproducible runs)
+        Chip8(Chip8&&);
+        Chip8& operator=(Chip8&&);
+        ~Chip8();
+        bool LoadROM(const char* filename); // Map a ROM file and load it, false (and nothing loaded) if it's missing, empty or too big
+        bool LoadROM(uint8_t const* data, size_t size); // Load a ROM image that is already in memory, false (and nothing loaded) if it's over XO_MAX_ROM_SIZE
+        void LoadProgram(uint8_t const* image); // Copy a zero-padded MAX_ROM_SIZE program image (e.g. from a RomCorpus) into RAM in one go
+        void Reset(unsigned int seed); // Back to power-on state with a new RNG seed, program memory below 4 KB is left for LoadROM() to rewrite
+        size_t SaveState(uint8_t* state) const; // Write the whole machine into up to STATE_SIZE bytes, returns how many (STATE_V1_SIZE for a classic ROM)
+        bool LoadState(uint8_t const* state, size_t size); // Restore a SaveState(), false (and nothing changed) if it's not one we understand or a field is out of range
+        void ExpandVideo(uint32_t* pixels) const; // Expand plane 0 into video.Width() x video.Height() RGBA pixels for presenting (room for 128x64)
+        void Cycle(); // Prototype for cycler (exactly one instruction)
+        uint64_t Run(uint64_t instructions); // Run a batch of instructions, returns how many were executed
+        void TickTimers(); // Count the delay and sound timers down by one 60 Hz tick
+        uint64_t RunFrames(uint64_t frames, unsigned int instructions_per_frame); // Run() a frame's worth then TickTimers(), frames times, returns instructions executed
+        uint64_t InstructionCount() const { return instruction_count; } // Instructions executed since power-on
+        uint64_t SkippedCount() const { return skipped_count; } // How many of those idle loop skipping counted without running them (not in save states)
+        bool VideoDirty() const { return video_dirty; } // True if 00E0 or Dxyn ran since the last PresentVideo()
+        void PresentVideo() { video_dirty = false; frame_count++; } // Mark the display as shown to the user
+        uint64_t FrameCount() const { return frame_count; } // Frames presented since power-on
+        uint16_t Keys() const { return keypad; } // Keys held down, bit k = key k
+        void SetKeys(uint16_t keys) { keypad = keys; } // Replace the whole keypad state
+        uint16_t* KeypadData() { return &keypad; } // The keypad mask itself, for callers that write it in place between batches
+        void SetKey(uint8_t key, bool pressed) { keypad = pressed ? keypad | (1u << (key & 0xFu)) : keypad & ~(1u << (key & 0xFu)); }
+        bool SoundActive() const { return sound_timer > 0; } // The beeper should be sounding
+        bool XoAudio() const { return xo_audio; } // The ROM set its own audio pattern or pitch (F002, Fx3A)
+        uint8_t const* AudioPattern() const { return audio_pattern; } // 16 bytes, 128 1-bit samples
+        uint8_t Pitch() const { return pitch; } // Playback rate is 4000 * 2^((pitch - 64) / 48) bits per second
+        bool WaitingForKey() const; // Parked on LD Vx, K with no key down and both timers stopped: nothing changes until a key goes down
+        uint8_t ReadMemory(uint16_t address) const { return memory[address & memory.Mask()]; } // Peek at RAM (e.g. a score for a reward)
+        unsigned int MemorySize() const { return memory.Size(); } // MEMORY_SIZE, or XO_MEMORY_SIZE once a ROM needed it
+        bool Classic() const { return !extended; } // Still plain CHIP-8: one 64x32 plane (video.planes[0] words 0-31 is the whole screen) and 4 KB of RAM
+        uint8_t ReadRegister(uint8_t x) const { return registers[x & 0xFu]; } // Peek at Vx
+        bool SetEngine(Engine engine); // Switch engines, returns false if the engine isn't available on this host (or in this build)
+        static bool InterpreterOnly(); // Profiling and tracing builds, where SetEngine() turns down everything but the interpreter
+        Engine GetEngine() const { return jit ? Engine::Jit : aot ? Engine::Aot : Engine::Interpreter; }
+#ifdef CHIP8_PROFILE
+        void SetProfiler(Profiler* profiler) { this->profiler = profiler; } // Report every instruction to a profiler (nullptr to stop)
+#endif
+#ifdef CHIP8_TRACE
+        void SetTracer(Tracer* tracer) { this->tracer = tracer; } // Record every instruction to an open trace (nullptr to stop)
+#endif
 
     private:
         // Define the specifications of our CHIP-8 Machine
         uint8_t registers[16]{}; // Define our 16, 8-bit, general purpose registers
-        uint8_t memory[4096]{}; // Define our 4 Kilobytes of RAM
+        Memory memory; // Define our 4 Kilobytes of RAM (64 for XO-CHIP)
         uint16_t index{}; // Define our special 16-bit index register
         uint16_t pc{}; // Define a 16-bit program counter
         uint16_t stack[16]{}; // Define our 32-byte stack (16, 16-bit slots)
         uint8_t sp{}; // 8-bit stack pointer (where we are on the stack)
         uint8_t delay_timer{}; // 8-bit delay_timer (counts down at 60 Hz)
-        uint8_t sound_timer{}; // 8-bit sound_timer (counts down at 60 Hz) TODO: Implement sound in SDL2
-        uint16_t opcode;
+        uint16_t keypad{}; // Keys held down, bit k = key k
+        uint8_t sound_timer{}; // 8-bit sound_timer (counts down at 60 Hz), the beeper sounds while it's non-zero
+        uint8_t flags[16]{}; // SUPER-CHIP "RPL" user flags (Fx75, Fx85)
+        uint8_t planes{1}; // XO-CHIP plane mask: which planes 00E0, scrolls and Dxyn act on
+        uint8_t audio_pattern[16]{}; // XO-CHIP audio pattern buffer (F002)
+        uint8_t pitch{64}; // XO-CHIP pitch register (Fx3A)
+        bool xo_audio{}; // Set once F002 or Fx3A runs
+        bool extended{}; // The ROM left classic CHIP-8 (00FE/00FF, planes, flags, audio, long I or a ROM over 4 KB): Dxy0 is 16x16 and states need version 2
 
-        std::default_random_engine rand_gen; // Create a member variable for our RNG engine
+        RandomEngine rand_gen; // Create a member variable for our RNG engine
         std::uniform_int_distribution<uint8_t> randByte; // Create a member variable for an RNG output
 
-        // Define prototypes for our table functions
-        void Table0();
-        void Table8();
-        void TableE();
-        void TableF();
+        uint64_t instruction_count{}; // Instructions executed since power-on
+        uint64_t skipped_count{}; // Part of instruction_count that SkipIdleLoop() added without running
+        bool video_dirty{true}; // Display changed since it was last presented (starts dirty so the first frame shows)
+        uint64_t frame_count{}; // Frames presented since power-on
+
+        std::unique_ptr<JitX64> jit; // Set while the JIT engine is selected
+        std::unique_ptr<AotEngine> aot; // Set while the AOT engine is selected
+        uint16_t code_write_first{0xFFFF}; // Lowest address written since the JIT or AOT engine last looked (0xFFFF = nothing written)
+        uint16_t code_write_last{}; // One past the highest address written since the JIT or AOT engine last looked
+#ifdef CHIP8_PROFILE
+        Profiler* profiler{}; // Set while profiling
+#endif
+#ifdef CHIP8_TRACE
+        Tracer* tracer{}; // Set while tracing
+        void Trace(uint16_t address, uint16_t opcode, uint8_t const* before); // Record the instruction that just ran, before = the V registers it started with
+#endif
 
-        typedef void (Chip8::*Chip8Func)();
-        Chip8Func table[0xF + 1]{&Chip8::OP_NULL};
-        Chip8Func table0[0xE + 1]{&Chip8::OP_NULL};
-        Chip8Func table8[0xE + 1]{&Chip8::OP_NULL};
-        Chip8Func tableE[0xE + 1]{&Chip8::OP_NULL};
-        Chip8Func tableF[0x65 + 1]{&Chip8::OP_NULL};
+        uint64_t run_end{}; // Instruction count the current Run() batch stops at
+        uint64_t Interpret(uint64_t instructions); // The interpreter engine behind Run()
+        unsigned int IdleLoopLength(uint16_t head) const; // Instructions in the idle loop starting at head (0 = not one)
+        void SkipIdleLoop(uint16_t jump_address); // Just went around an idle loop from jump_address, skip its whole iterations up to run_end
+
+        /**
+         * Predecoded instruction cache
+         * Every address gets decoded once into its final handler plus pre-extracted operands,
+         * so the hot loop does a single indirect call instead of fetch + mask + up to two table hops.
+         * An entry may also be a superinstruction covering several guest instructions.
+         * Entries are thrown away whenever memory they were decoded from is written (Fx55, Fx33, LoadROM).
+         */
+        struct Instruction;
+        typedef void (Chip8::*Chip8Func)(Instruction const&);
+
+        struct Instruction {
+            Chip8Func handler; // Fully resolved handler
+            uint16_t nnn; // Address operand
+            uint8_t x; // Vx register number
+            uint8_t y; // Vy register number
+            uint8_t kk; // Byte operand
+            uint8_t n; // Nibble operand
+            uint8_t length; // Guest instructions covered by this entry (0 = not decoded yet)
+        };
+
+        static const unsigned int MAX_FUSED_LENGTH = 8; // Longest superinstruction (in guest instructions)
+
+        Instruction decoded[MEMORY_SIZE]{}; // Decoded instruction for every address below MEMORY_SIZE (code past it is decoded as it runs)
+
+        Instruction Decode(uint16_t opcode) const; // Decode a single opcode (no fusion)
+        Instruction const& DecodeAt(uint16_t address); // Decode (and fuse) the instruction at address into the cache
+        void InvalidateCode(uint16_t address, unsigned int length); // Drop cache entries that cover [address, address + length)
+        void WriteMemory(uint16_t address, uint8_t const* data, size_t size); // Copy into RAM, invalidating only code that changed
+        uint16_t OpcodeAt(uint16_t address) const; // Read the big-endian opcode at address
+        void SkipNext() { pc += OpcodeAt(pc) == 0xF000u ? 4 : 2; } // Step over the next instruction, all 4 bytes of an XO-CHIP LD I, long
+        void DrawPlanes(uint8_t x_pos, uint8_t y_pos, uint8_t n); // Dxyn for high resolution, 16x16 sprites and more than one plane
+
+        static constexpr Chip8Func Generic(uint16_t opcode); // The handler for an opcode (top nibble, then the last nibble or byte), a constant expression
+
+        /**
+         * Opcode table
+         * One static table shared by every instance, indexed by the whole 16-bit opcode. Each entry is a
+         * handler specialized at compile time on the operands its opcode uses (OP_Fixed), so DecodeAt()
+         * hands the hot loop a handler that decodes nothing. Building with CHIP8_COMPACT_DISPATCH leaves
+         * the table (about 43,000 tiny functions) out and the cache holds the generic handlers instead.
+         */
+#ifndef CHIP8_COMPACT_DISPATCH
+        static constexpr uint16_t Canonical(uint16_t opcode); // Clear the bits an opcode's handler ignores, so opcodes that behave the same share one specialization
+        template<uint16_t OPCODE> void OP_Fixed(Instruction const& op); // Generic(OPCODE) with OPCODE's operands as constants
+        template<class OPCODES> struct FixedTable; // handlers[opcode] = &OP_Fixed<Canonical(opcode)>
+#endif
+
+        /**
+         * SUPERINSTRUCTIONS!
+         * Common instruction sequences fused into a single cache entry.
+         */
+
+        void OP_Annn_Dxyn(Instruction const& op); // LD I, addr + DRW Vx, Vy, nibble
+        template<Chip8Func SKIP> void OP_Skip_1nnn(Instruction const& op); // Any skip followed by JP addr (a conditional branch)
+        void OP_6xkk_Run(Instruction const& op); // A run of LD Vx, byte
 
         /**
          * OPCODES!
@@ -54,39 +277,60 @@ class Chip8 {
          * The actual implementation of each opcode is in chip_8.cpp
          */
     
-        void OP_NULL(); // NULL: Do nothing (Catch-all if the table gets clobbered)
-        void OP_00E0(); // CLS: Clear the display
-        void OP_00EE(); // RET: Return from a subroutine
-        void OP_1nnn(); // JP addr: Jump to location nnn
-        void OP_2nnn(); // CALL addr: Call subroutine at nnn
-        void OP_3xkk(); // SE Vx, byte: Skip next instruction if Vx == kk
-        void OP_4xkk(); // SNE Vx, byte: Skip next instruction if Vx != kk
-        void OP_5xy0(); // SE Vx, Vy: Skip next instruction if Vx == Vy
-        void OP_6xkk(); // LD Vx, byte: Set Vx = kk
-        void OP_7xkk(); // ADD Vx, byte: Set Vx = Vx + kk
-        void OP_8xy0(); // LD Vx, Vy: Set Vx = Vy
-        void OP_8xy1(); // OR Vx, Vy: Set Vx = Vx OR Vy
-        void OP_8xy2(); // AND Vx, Vy: Set Vx = Vx AND Vy
-        void OP_8xy3(); // XOR Vx, Vy: Set Vx = Vx XOR Vy
-        void OP_8xy4(); // ADD Vx, Vy: Set Vx = Vx + Vy, set VF = carry. (VF is overflow flag)
-        void OP_8xy5(); // SUB Vx, Vy: Set Vx = Vx - Vy, set VF = carry. (VF is underflow flag)
-        void OP_8xy6(); // SHR Vx: Set Vx = Vx SHR 1. (Right shift, save remainder in VF)
-        void OP_8xy7(); // SUBN Vx, Vy: Set Vx = Vy - Vx, set VF = NOT borrow
-        void OP_8xyE(); // SHL Vx {, Vy}: Set Vx = Vx SHL 1. (Left shift, save MSB in VF)
-        void OP_9xy0(); // SNE Vx, Vy: Skip next instruction if Vx != Vy
-        void OP_Annn(); // LD I, addr: Set I = nnn
-        void OP_Bnnn(); // JP V0, addr: Jump to location nnn + V0
-        void OP_Cxkk(); // RND Vx, byte: Set Vx = random byte AND kk
-        void OP_Dxyn(); // DRW Vx, Vy, nibble: Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision.
-        void OP_Ex9E(); // SKP Vx: Skip next instruction if key with the value of Vx is pressed
-        void OP_ExA1(); // SKNP Vx: Skip next instruction if key with the value of Vx is NOT pressed
-        void OP_Fx07(); // LD Vx, DT: Set Vx = delay timer value
-        void OP_Fx0A(); // LD Vx,K: Wait for a key press, store the value of the key in Vx
-        void OP_Fx15(); // LD DT, Vx: Set delay timer = Vx
-        void OP_Fx18(); // LD ST, Vx: Set sound timer = Vx
-        void OP_Fx1E(); // ADD I, Vx: Set I = I + Vx
-        void OP_Fx29(); // LD F, Vx: Set I = location of sprite for digit Vx
-        void OP_Fx33(); // LD B, Vx: Store BCD representation of Vx in memory locations I, I+1, and I+2
-        void OP_Fx55(); // LD [I], Vx: Store registers V0 through Vx in memory starting at location I
-        void OP_Fx65(); // LD Vx, [I]: Read registers V0 through Vx in memory starting at location I
+        void OP_NULL(Instruction const& op); // NULL: Do nothing (Catch-all if the table gets clobbered)
+        void OP_00E0(Instruction const& op); // CLS: Clear the display (the selected planes)
+        void OP_00EE(Instruction const& op); // RET: Return from a subroutine
+        void OP_1nnn(Instruction const& op); // JP addr: Jump to location nnn
+        void OP_2nnn(Instruction const& op); // CALL addr: Call subroutine at nnn
+        void OP_3xkk(Instruction const& op); // SE Vx, byte: Skip next instruction if Vx == kk
+        void OP_4xkk(Instruction const& op); // SNE Vx, byte: Skip next instruction if Vx != kk
+        void OP_5xy0(Instruction const& op); // SE Vx, Vy: Skip next instruction if Vx == Vy
+        void OP_6xkk(Instruction const& op); // LD Vx, byte: Set Vx = kk
+        void OP_7xkk(Instruction const& op); // ADD Vx, byte: Set Vx = Vx + kk
+        void OP_8xy0(Instruction const& op); // LD Vx, Vy: Set Vx = Vy
+        void OP_8xy1(Instruction const& op); // OR Vx, Vy: Set Vx = Vx OR Vy
+        void OP_8xy2(Instruction const& op); // AND Vx, Vy: Set Vx = Vx AND Vy
+        void OP_8xy3(Instruction const& op); // XOR Vx, Vy: Set Vx = Vx XOR Vy
+        void OP_8xy4(Instruction const& op); // ADD Vx, Vy: Set Vx = Vx + Vy, set VF = carry. (VF is overflow flag)
+        void OP_8xy5(Instruction const& op); // SUB Vx, Vy: Set Vx = Vx - Vy, set VF = carry. (VF is underflow flag)
+        void OP_8xy6(Instruction const& op); // SHR Vx: Set Vx = Vx SHR 1. (Right shift, save remainder in VF)
+        void OP_8xy7(Instruction const& op); // SUBN Vx, Vy: Set Vx = Vy - Vx, set VF = NOT borrow
+        void OP_8xyE(Instruction const& op); // SHL Vx {, Vy}: Set Vx = Vx SHL 1. (Left shift, save MSB in VF)
+        void OP_9xy0(Instruction const& op); // SNE Vx, Vy: Skip next instruction if Vx != Vy
+        void OP_Annn(Instruction const& op); // LD I, addr: Set I = nnn
+        void OP_Bnnn(Instruction const& op); // JP V0, addr: Jump to location nnn + V0
+        void OP_Cxkk(Instruction const& op); // RND Vx, byte: Set Vx = random byte AND kk
+        void OP_Dxyn(Instruction const& op); // DRW Vx, Vy, nibble: Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision.
+        void OP_Ex9E(Instruction const& op); // SKP Vx: Skip next instruction if key with the value of Vx is pressed
+        void OP_ExA1(Instruction const& op); // SKNP Vx: Skip next instruction if key with the value of Vx is NOT pressed
+        void OP_Fx07(Instruction const& op); // LD Vx, DT: Set Vx = delay timer value
+        void OP_Fx0A(Instruction const& op); // LD Vx,K: Wait for a key press, store the value of the key in Vx
+        void OP_Fx15(Instruction const& op); // LD DT, Vx: Set delay timer = Vx
+        void OP_Fx18(Instruction const& op); // LD ST, Vx: Set sound timer = Vx
+        void OP_Fx1E(Instruction const& op); // ADD I, Vx: Set I = I + Vx
+        void OP_Fx29(Instruction const& op); // LD F, Vx: Set I = location of sprite for digit Vx
+        void OP_Fx33(Instruction const& op); // LD B, Vx: Store BCD representation of Vx in memory locations I, I+1, and I+2
+        void OP_Fx55(Instruction const& op); // LD [I], Vx: Store registers V0 through Vx in memory starting at location I
+        void OP_Fx65(Instruction const& op); // LD Vx, [I]: Read registers V0 through Vx in memory starting at location I
+
+        /**
+         * SUPER-CHIP and XO-CHIP extensions
+         */
+
+        void OP_00Cn(Instruction const& op); // SCD nibble: Scroll the selected planes down n pixels
+        void OP_00Dn(Instruction const& op); // SCU nibble: Scroll the selected planes up n pixels (XO-CHIP)
+        void OP_00FB(Instruction const& op); // SCR: Scroll the selected planes right 4 pixels
+        void OP_00FC(Instruction const& op); // SCL: Scroll the selected planes left 4 pixels
+        void OP_00FD(Instruction const& op); // EXIT: Stop the interpreter (it stays on this instruction)
+        void OP_00FE(Instruction const& op); // LOW: Low resolution (64x32), clears the display
+        void OP_00FF(Instruction const& op); // HIGH: High resolution (128x64), clears the display
+        void OP_5xy2(Instruction const& op); // SAVE Vx - Vy: Store Vx through Vy (either way round) in memory starting at I, I unchanged
+        void OP_5xy3(Instruction const& op); // LOAD Vx - Vy: Read Vx through Vy (either way round) from memory starting at I, I unchanged
+        void OP_F000(Instruction const& op); // LD I, long: Set I = the 16-bit word following this instruction
+        void OP_Fn01(Instruction const& op); // PLANE n: Select the planes drawing and scrolling act on
+        void OP_F002(Instruction const& op); // AUDIO: Load the 16-byte audio pattern from memory starting at I
+        void OP_Fx30(Instruction const& op); // LD HF, Vx: Set I = location of the 8x10 big font sprite for digit Vx
+        void OP_Fx3A(Instruction const& op); // PITCH Vx: Set the audio pitch register = Vx
+        void OP_Fx75(Instruction const& op); // LD R, Vx: Store V0 through Vx in the user flags
+        void OP_Fx85(Instruction const& op); // LD Vx, R: Read V0 through Vx from the user flags
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include <mapped_file.hpp>
+#include <rom_corpus.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static void Usage(const char* program) {
+    std::cerr << "Usage: " << program << " build <archive> <manifest>\n"
+              << "       " << program << " list <archive>\n";
+    std::exit(EXIT_FAILURE);
+}
+
+static const struct {
+    char const* name;
+    uint16_t flag;
+} quirk_names[] = {
+    {"shift_vy", QUIRK_SHIFT_VY},
+    {"load_store_i", QUIRK_LOAD_STORE_I},
+    {"jump_vx", QUIRK_JUMP_VX},
+    {"vf_reset", QUIRK_VF_RESET},
+    {"display_wait", QUIRK_DISPLAY_WAIT},
+    {"wrap_sprites", QUIRK_WRAP_SPRITES},
+};
+
+// Manifest lines: <ROM path> [name=<name>] [ips=<N>] [quirks=<quirk>,<quirk>...], '#' starts a comment
+static bool LoadManifest(const char* filename, std::vector<CorpusRom>& roms) {
+    std::ifstream manifest(filename);
+
+    if(!manifest.is_open()) {
+        std::cerr << "Could not open manifest: " << filename << "\n";
+        return false;
+    }
+
+    std::string line;
+    unsigned int line_number = 0;
+
+    while(std::getline(manifest, line)) {
+        line_number++;
+
+        size_t hash = line.find('#');
+        if(hash != std::string::npos) {
+            line.erase(hash);
+        }
+
+        std::istringstream fields(line);
+        std::string path;
+        if(!(fields >> path)) {
+            continue; // Blank line
+        }
+
+        CorpusRom rom;
+        rom.name = path.substr(path.find_last_of('/') + 1);
+
+        std::string field;
+        while(fields >> field) {
+            size_t equals = field.find('=');
+            std::string key = field.substr(0, equals);
+            std::string value = equals == std::string::npos ? "" : field.substr(equals + 1);
+
+            if(key == "name" && !value.empty()) {
+                rom.name = value;
+            }
+            else if(key == "ips" && !value.empty()) {
+                rom.ips = std::strtoul(value.c_str(), nullptr, 10);
+            }
+            else if(key == "quirks") {
+                std::istringstream quirks(value);
+                std::string quirk;
+                while(std::getline(quirks, quirk, ',')) {
+                    bool known = false;
+                    for(auto const& q : quirk_names) {
+                        if(quirk == q.name) {
+                            rom.quirks |= q.flag;
+                            known = true;
+                        }
+                    }
+                    if(!known) {
+                        std::cerr << filename << ":" << line_number << ": unknown quirk " << quirk << "\n";
+                        return false;
+                    }
+                }
+            }
+            else {
+                std::cerr << filename << ":" << line_number << ": expected name=, ips= or quirks=\n";
+                return false;
+            }
+        }
+
+        MappedFile file;
+        if(!file.Open(path.c_str()) || file.Size() == 0 || file.Size() > MAX_ROM_SIZE) {
+            std::cerr << filename << ":" << line_number << ": " << path << " is missing, empty or bigger than " << MAX_ROM_SIZE << " bytes\n";
+            return false;
+        }
+        rom.data.assign(file.Data(), file.Data() + file.Size());
+
+        roms.push_back(rom);
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc == 4 && !std::strcmp(argv[1], "build")) {
+        std::vector<CorpusRom> roms;
+        if(!LoadManifest(argv[3], roms)) {
+            return EXIT_FAILURE;
+        }
+
+        if(!RomCorpus::Build(argv[2], roms)) {
+            std::cerr << "Could not write corpus: " << argv[2] << "\n";
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if(argc == 3 && !std::strcmp(argv[1], "list")) {
+        RomCorpus corpus;
+        if(!corpus.Open(argv[2])) {
+            std::cerr << "Could not open corpus: " << argv[2] << "\n";
+            return EXIT_FAILURE;
+        }
+
+        for(size_t i = 0; i < corpus.Count(); i++) {
+            RomCorpus::Entry const& entry = corpus[i];
+
+            std::string quirks;
+            for(auto const& q : quirk_names) {
+                if(entry.quirks & q.flag) {
+                    quirks += quirks.empty() ? q.name : std::string(",") + q.name;
+                }
+            }
+
+            std::printf("%016llx %5u bytes %6u ips %-20s %s\n", static_cast<unsigned long long>(entry.hash), entry.size, entry.ips,
+                        quirks.empty() ? "-" : quirks.c_str(), entry.Name().c_str());
+        }
+        return EXIT_SUCCESS;
+    }
+
+    Usage(argv[0]);
+}
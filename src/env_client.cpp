@@ -0,0 +1,126 @@
+#include <env_client.hpp>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+EnvClient::~EnvClient() {
+    Unmap();
+    if(socket >= 0) {
+        close(socket);
+    }
+}
+
+bool EnvClient::Connect(const char* path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(address.sun_path)) {
+        return false;
+    }
+    strcpy(address.sun_path, path);
+
+    socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(socket < 0) {
+        return false;
+    }
+
+    if(connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(socket);
+        socket = -1;
+        return false;
+    }
+
+    return true;
+}
+
+EnvStatus EnvClient::Create(uint8_t const* rom, size_t size, EnvOptions const& options) {
+    if(size == 0 || size > MAX_ROM_SIZE) {
+        return EnvStatus::BadRom;
+    }
+
+    Unmap(); // The server drops the old environment too
+
+    EnvRequest request{};
+    request.command = static_cast<uint32_t>(EnvCommand::Create);
+    request.count = options.count;
+    request.max_episode_steps = options.max_episode_steps;
+    request.instructions_per_step = options.instructions_per_step;
+    request.seed = options.seed;
+    request.engine = static_cast<uint32_t>(options.engine);
+    request.rom_size = size;
+
+    int memory = -1;
+    EnvReply reply{};
+    EnvStatus status = Request(request, rom, size, &memory, &reply);
+    if(status != EnvStatus::Ok) {
+        if(memory >= 0) {
+            close(memory);
+        }
+        return status;
+    }
+
+    void* mapping = memory >= 0 ? mmap(nullptr, reply.shared_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0) : MAP_FAILED;
+    if(memory >= 0) {
+        close(memory); // The mapping keeps the memory alive
+    }
+    if(mapping == MAP_FAILED) {
+        return EnvStatus::NoMemory;
+    }
+
+    // Only trust a header that describes exactly what was mapped
+    EnvShared const* header = static_cast<EnvShared const*>(mapping);
+    EnvShared layout = EnvSharedLayout(options.count);
+    if(reply.shared_size < sizeof(EnvShared) || memcmp(header, &layout, sizeof(layout)) || layout.size != reply.shared_size) {
+        munmap(mapping, reply.shared_size);
+        return EnvStatus::BadRequest;
+    }
+
+    shared = static_cast<EnvShared*>(mapping);
+    shared_size = reply.shared_size;
+    return EnvStatus::Ok;
+}
+
+EnvStatus EnvClient::Reset() {
+    EnvRequest request{};
+    request.command = static_cast<uint32_t>(EnvCommand::Reset);
+    return Request(request);
+}
+
+EnvStatus EnvClient::Step() {
+    EnvRequest request{};
+    request.command = static_cast<uint32_t>(EnvCommand::Step);
+    return Request(request);
+}
+
+EnvStatus EnvClient::Close() {
+    Unmap();
+
+    EnvRequest request{};
+    request.command = static_cast<uint32_t>(EnvCommand::Close);
+    return Request(request);
+}
+
+EnvStatus EnvClient::Request(EnvRequest const& request, void const* payload, size_t payload_size, int* fd, EnvReply* reply) {
+    EnvRequest versioned = request;
+    versioned.version = ENV_PROTOCOL_VERSION;
+
+    EnvReply received{};
+    if(socket < 0 || !EnvSend(socket, &versioned, sizeof(versioned)) || !EnvSend(socket, payload, payload_size)
+            || !EnvReceive(socket, &received, sizeof(received), fd)) {
+        return EnvStatus::Disconnected;
+    }
+
+    if(reply) {
+        *reply = received;
+    }
+    return static_cast<EnvStatus>(received.status);
+}
+
+void EnvClient::Unmap() {
+    if(shared) {
+        munmap(shared, shared_size);
+        shared = nullptr;
+        shared_size = 0;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <env_protocol.hpp>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * Environment client
+ * The trainer's end of chip8_env_server (env_protocol.hpp): connect, Create() an environment,
+ * then fill in Actions() and call Step() for each frame. Observations(), Rewards() and Dones()
+ * point straight into the shared memory the server writes, so nothing is copied.
+ */
+struct EnvOptions {
+    uint64_t count{1}; // Number of instances
+    unsigned int instructions_per_step{10}; // Instructions per step (one step is one 60 Hz frame)
+    uint64_t max_episode_steps{0}; // End the episode after this many steps (0 = never)
+    unsigned int seed{0}; // Instance i of episode e is seeded with seed + i + e * count
+    Engine engine{Engine::Interpreter};
+};
+
+class EnvClient {
+    public:
+        EnvClient() = default;
+        ~EnvClient();
+        EnvClient(EnvClient const&) = delete;
+        EnvClient& operator=(EnvClient const&) = delete;
+
+        bool Connect(const char* path); // Connect to a server's socket, false if nobody is listening there
+        EnvStatus Create(uint8_t const* rom, size_t size, EnvOptions const& options); // Start an environment running the ROM, and map its memory
+        EnvStatus Reset(); // Restart every instance
+        EnvStatus Step(); // Step every instance with the keypad masks in Actions()
+        EnvStatus Close(); // Drop the environment (the connection stays open)
+
+        size_t Count() const { return shared ? shared->count : 0; }
+        uint16_t* Actions() { return reinterpret_cast<uint16_t*>(Base() + shared->actions); } // One keypad mask per instance, bit k = key k held down
+        uint64_t const* Observations() const { return reinterpret_cast<uint64_t const*>(Base() + shared->observations); } // Instance i's frame starts at i * VIDEO_HEIGHT
+        float const* Rewards() const { return reinterpret_cast<float const*>(Base() + shared->rewards); }
+        uint8_t const* Dones() const { return Base() + shared->dones; }
+
+    private:
+        int socket{-1};
+        EnvShared* shared{}; // The mapping, starting with its header
+        size_t shared_size{};
+
+        uint8_t* Base() const { return reinterpret_cast<uint8_t*>(shared); }
+        EnvStatus Request(EnvRequest const& request, void const* payload = nullptr, size_t payload_size = 0, int* fd = nullptr, EnvReply* reply = nullptr);
+        void Unmap();
+};
@@ -0,0 +1,131 @@
+#include <env_client.hpp>
+#include <mapped_file.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static void Usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--envs N] [--steps N] [--ipf N] [--episode N] [--seed N] [--engine interpreter|jit] <socket> <ROM>\n";
+    std::exit(EXIT_FAILURE);
+}
+
+// Drives a chip8_env_server the way chip8_vector_env drives a VectorEnv in-process: same seeds,
+// same random actions, so the observation hash matches and the step rate shows what the socket costs
+int main(int argc, char* argv[]) {
+    EnvOptions options;
+    options.count = 1024;
+    uint64_t step_count = 1000;
+    const char* socket_path = nullptr;
+    const char* ROM_filename = nullptr;
+
+    for(int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if(!std::strcmp(argv[i], "--envs") && has_value) {
+            options.count = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--steps") && has_value) {
+            step_count = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--ipf") && has_value) {
+            options.instructions_per_step = std::stoul(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--episode") && has_value) {
+            options.max_episode_steps = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--seed") && has_value) {
+            options.seed = std::stoul(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--engine") && has_value) {
+            std::string name = argv[++i];
+            if(name == "jit") options.engine = Engine::Jit;
+            else if(name != "interpreter") Usage(argv[0]);
+        }
+        else if(argv[i][0] != '-' && !socket_path) {
+            socket_path = argv[i];
+        }
+        else if(argv[i][0] != '-' && !ROM_filename) {
+            ROM_filename = argv[i];
+        }
+        else {
+            Usage(argv[0]);
+        }
+    }
+
+    if(!ROM_filename) {
+        Usage(argv[0]);
+    }
+
+    MappedFile file;
+    if(!file.Open(ROM_filename) || file.Size() == 0 || file.Size() > MAX_ROM_SIZE) {
+        std::cerr << "Could not load ROM (missing, empty or bigger than " << MAX_ROM_SIZE << " bytes): " << ROM_filename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    EnvClient client;
+    if(!client.Connect(socket_path)) {
+        std::cerr << "No environment server at " << socket_path << "\n";
+        return EXIT_FAILURE;
+    }
+
+    EnvStatus status = client.Create(file.Data(), file.Size(), options);
+    if(status != EnvStatus::Ok) {
+        std::cerr << "Could not create the environment: " << EnvStatusName(status) << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // The same xorshift actions as chip8_vector_env
+    uint16_t* actions = client.Actions();
+    uint64_t state = 0x9E3779B97F4A7C15ull + options.seed;
+    auto randomize = [&]() {
+        for(size_t i = 0; i < client.Count(); i++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            actions[i] = static_cast<uint16_t>(1u << (state % 17)); // One key held down, or none
+        }
+    };
+
+    uint64_t episodes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for(uint64_t step = 0; step < step_count && status == EnvStatus::Ok; step++) {
+        randomize();
+        status = client.Step();
+
+        for(size_t i = 0; i < client.Count(); i++) {
+            episodes += client.Dones()[i];
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if(seconds <= 0.0) seconds = 1e-9;
+
+    if(status != EnvStatus::Ok) {
+        std::cerr << "Step failed: " << EnvStatusName(status) << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // FNV-1a over the last observations, straight out of shared memory
+    uint64_t hash = 0xCBF29CE484222325ull;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(client.Observations());
+    for(size_t i = 0; i < client.Count() * VIDEO_HEIGHT * sizeof(uint64_t); i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+
+    uint64_t env_steps = step_count * client.Count();
+    std::printf("envs: %llu\n", static_cast<unsigned long long>(client.Count()));
+    std::printf("env_steps: %llu\n", static_cast<unsigned long long>(env_steps));
+    std::printf("episodes_done: %llu\n", static_cast<unsigned long long>(episodes));
+    std::printf("wall_time_s: %.6f\n", seconds);
+    std::printf("round_trips_per_s: %.0f\n", step_count / seconds);
+    std::printf("env_steps_per_s: %.0f\n", env_steps / seconds);
+    std::printf("observation_hash: %016llx\n", static_cast<unsigned long long>(hash));
+
+    client.Close();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+#include <env_protocol.hpp>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+bool EnvSend(int socket, void const* data, size_t size, int fd) {
+    char const* bytes = static_cast<char const*>(data);
+
+    while(size > 0) {
+        iovec io{const_cast<char*>(bytes), size};
+        msghdr message{};
+        message.msg_iov = &io;
+        message.msg_iovlen = 1;
+
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        if(fd >= 0) { // Only on the first chunk
+            memset(control, 0, sizeof(control));
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(header), &fd, sizeof(int));
+        }
+
+        ssize_t sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+        if(sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if(sent <= 0) {
+            return false;
+        }
+
+        bytes += sent;
+        size -= sent;
+        fd = -1;
+    }
+
+    return true;
+}
+
+bool EnvReceive(int socket, void* data, size_t size, int* fd) {
+    char* bytes = static_cast<char*>(data);
+
+    if(fd) {
+        *fd = -1;
+    }
+
+    while(size > 0) {
+        iovec io{bytes, size};
+        msghdr message{};
+        message.msg_iov = &io;
+        message.msg_iovlen = 1;
+
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t received = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+        if(received < 0 && errno == EINTR) {
+            continue;
+        }
+        if(received <= 0) {
+            return false;
+        }
+
+        for(cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+            if(header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+                int passed;
+                memcpy(&passed, CMSG_DATA(header), sizeof(int));
+                if(fd && *fd < 0) {
+                    *fd = passed;
+                }
+                else {
+                    close(passed); // Nobody asked for it
+                }
+            }
+        }
+
+        bytes += received;
+        size -= received;
+    }
+
+    return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * Environment server protocol
+ * A trainer in another process drives a VectorEnv through chip8_env_server (env_server.hpp).
+ * Control messages go over a Unix domain stream socket: a fixed-size EnvRequest, plus the
+ * ROM bytes after a Create, answered by a fixed-size EnvReply. The bulk data never touches
+ * the socket. Create answers with a shared memory file descriptor (SCM_RIGHTS) that both sides
+ * map. The trainer writes actions there, sends Step, and reads the observations, rewards and
+ * dones the server wrote in place once the reply arrives. Step advances every instance by one
+ * frame, so one round trip covers the whole batch. The shared memory's size is sealed, so
+ * a client can't shrink it under the server.
+ * Observations are classic 64x32 screens, so only classic CHIP-8 ROMs are served: bigger
+ * ROMs are refused at Create, and a Reset or Step after which an instance has left classic
+ * CHIP-8 (VectorEnv::Classic()) still runs but answers BadRom.
+ * Both ends are the same machine and build, so everything is in host byte order.
+ */
+const uint32_t ENV_PROTOCOL_VERSION = 1;
+const uint32_t ENV_SHARED_MAGIC = 0x56453843; // "C8EV" in memory on little-endian hosts
+const uint64_t ENV_MAX_COUNT = 1u << 20; // Instances per environment
+
+enum class EnvCommand : uint32_t {
+    Create = 1, // Start a VectorEnv for the ROM that follows (replacing any the connection has), reply carries the shared memory
+    Reset, // Restart every instance (VectorEnv::Reset())
+    Step, // Apply the actions in shared memory and run one frame on every instance (VectorEnv::Step())
+    Close // Drop the connection's environment
+};
+
+enum class EnvStatus : int32_t {
+    Ok = 0,
+    BadRequest, // Unknown command, wrong version or out-of-range Create parameters
+    BadRom, // Empty or bigger than MAX_ROM_SIZE, or (Reset/Step) it left classic CHIP-8 and the observations don't show it
+    NoEnvironment, // Reset/Step before Create
+    NoMemory, // The shared memory or the instances couldn't be allocated (or are over the server's budget), or the client couldn't map it
+    Disconnected // Client only: the server hung up
+};
+
+inline char const* EnvStatusName(EnvStatus status) {
+    switch(status) {
+        case EnvStatus::Ok: return "ok";
+        case EnvStatus::BadRequest: return "bad request";
+        case EnvStatus::BadRom: return "bad ROM";
+        case EnvStatus::NoEnvironment: return "no environment";
+        case EnvStatus::NoMemory: return "out of memory";
+        case EnvStatus::Disconnected: return "disconnected";
+    }
+    return "?";
+}
+
+struct EnvRequest {
+    uint32_t version; // ENV_PROTOCOL_VERSION
+    uint32_t command; // EnvCommand
+
+    // Create only, the same meaning as in VectorEnvConfig
+    uint64_t count;
+    uint64_t max_episode_steps;
+    uint32_t instructions_per_step;
+    uint32_t seed;
+    uint32_t engine; // Engine
+    uint32_t rom_size; // ROM bytes following the request
+};
+
+struct EnvReply {
+    int32_t status; // EnvStatus
+    uint32_t reserved;
+    uint64_t shared_size; // Create: bytes to map from the descriptor sent with this reply
+};
+
+/**
+ * Shared memory layout
+ * An EnvShared header, then each array on its own cache lines:
+ *   actions:      count uint16_t keypad masks (trainer writes, bit k = key k held down)
+ *   observations: count packed framebuffers, VIDEO_HEIGHT uint64_t rows each (server writes)
+ *   rewards:      count floats (server writes)
+ *   dones:        count bytes (server writes)
+ * Offsets are from the start of the region. The server fills in the header, the trainer checks it.
+ */
+struct EnvShared {
+    uint32_t magic; // ENV_SHARED_MAGIC
+    uint32_t version; // ENV_PROTOCOL_VERSION
+    uint64_t count;
+    uint64_t actions;
+    uint64_t observations;
+    uint64_t rewards;
+    uint64_t dones;
+    uint64_t size; // Whole region
+};
+
+inline EnvShared EnvSharedLayout(uint64_t count) {
+    auto align = [](uint64_t offset) { return (offset + 63u) & ~uint64_t(63u); };
+
+    EnvShared layout{};
+    layout.magic = ENV_SHARED_MAGIC;
+    layout.version = ENV_PROTOCOL_VERSION;
+    layout.count = count;
+    layout.actions = align(sizeof(EnvShared));
+    layout.observations = align(layout.actions + count * sizeof(uint16_t));
+    layout.rewards = align(layout.observations + count * VIDEO_HEIGHT * sizeof(uint64_t));
+    layout.dones = align(layout.rewards + count * sizeof(float));
+    layout.size = align(layout.dones + count);
+    return layout;
+}
+
+// Send/receive exactly size bytes over the socket, false if the peer went away. fd, if not -1, rides
+// along with the data as SCM_RIGHTS, and a received one is stored in *fd (-1 if none came).
+bool EnvSend(int socket, void const* data, size_t size, int fd = -1);
+bool EnvReceive(int socket, void* data, size_t size, int* fd = nullptr);
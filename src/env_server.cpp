@@ -0,0 +1,226 @@
+#include <env_server.hpp>
+#include <vector_env.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// An anonymous file of the given size, mapped read-write at *mapping. Returns its descriptor, -1 if any of it fails.
+// The size is sealed before the client gets the descriptor, so it can't ftruncate() the file out from under our mapping (SIGBUS).
+static int CreateShared(size_t size, void** mapping) {
+    int memory = memfd_create("chip8-env", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if(memory < 0) {
+        return -1;
+    }
+
+    if(ftruncate(memory, size) != 0 || fcntl(memory, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        close(memory);
+        return -1;
+    }
+
+    if((*mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0)) == MAP_FAILED) {
+        close(memory);
+        return -1;
+    }
+
+    return memory;
+}
+
+EnvServer::EnvServer(unsigned int threads) : threads(threads) {
+}
+
+EnvServer::~EnvServer() {
+    Reap(true);
+
+    if(listener >= 0) {
+        close(listener);
+        unlink(path.c_str());
+    }
+}
+
+bool EnvServer::Listen(const char* path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    strcpy(address.sun_path, path);
+
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listener < 0) {
+        return false;
+    }
+
+    unlink(path); // Left over from a server that didn't shut down cleanly
+    if(bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        close(listener);
+        listener = -1;
+        return false;
+    }
+
+    this->path = path;
+    return true;
+}
+
+void EnvServer::Serve() {
+    while(!stopping) {
+        int socket = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if(socket < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break; // Stop() shut the listener down
+        }
+
+        Reap(false);
+
+        sessions.emplace_back(new Session());
+        Session& session = *sessions.back();
+        session.socket = socket;
+        session.thread = std::thread(&EnvServer::Run, this, std::ref(session));
+    }
+
+    Reap(true);
+}
+
+void EnvServer::Stop() {
+    stopping = true;
+    if(listener >= 0) {
+        shutdown(listener, SHUT_RDWR); // Wakes up accept()
+    }
+}
+
+void EnvServer::Reap(bool all) {
+    for(size_t i = 0; i < sessions.size();) {
+        Session& session = *sessions[i];
+        if(!all && !session.finished) {
+            i++;
+            continue;
+        }
+
+        shutdown(session.socket, SHUT_RDWR); // Its thread is blocked reading the next request, if it's still running
+        session.thread.join();
+        close(session.socket); // Only now, so the descriptor can't be reused under a running session
+        sessions.erase(sessions.begin() + i);
+    }
+}
+
+void EnvServer::Run(Session& session) {
+    std::unique_ptr<VectorEnv> env;
+    void* shared = MAP_FAILED;
+    size_t shared_size = 0;
+
+    auto release = [&]() {
+        env.reset();
+        if(shared != MAP_FAILED) {
+            munmap(shared, shared_size);
+            shared = MAP_FAILED;
+        }
+    };
+
+    EnvRequest request;
+    while(EnvReceive(session.socket, &request, sizeof(request))) {
+        EnvReply reply{};
+        int memory = -1; // Shared memory descriptor for the client, only after a Create
+
+        if(request.version != ENV_PROTOCOL_VERSION) { // Nothing after this can be trusted to line up, so answer and hang up
+            reply.status = static_cast<int32_t>(EnvStatus::BadRequest);
+            EnvSend(session.socket, &reply, sizeof(reply));
+            break;
+        }
+        else if(request.command == static_cast<uint32_t>(EnvCommand::Create)) {
+            if(request.rom_size > MAX_ROM_SIZE) { // Can't even skip past something that big safely, so hang up
+                break;
+            }
+
+            std::vector<uint8_t> rom(request.rom_size);
+            if(!EnvReceive(session.socket, rom.data(), rom.size())) {
+                break;
+            }
+
+            release(); // A Create replaces whatever the connection had, even if it fails
+            EnvShared layout = EnvSharedLayout(request.count);
+
+            if(rom.empty()) {
+                reply.status = static_cast<int32_t>(EnvStatus::BadRom);
+            }
+            else if(request.count == 0 || request.count > ENV_MAX_COUNT || request.instructions_per_step == 0 || request.engine > static_cast<uint32_t>(Engine::Aot)) {
+                reply.status = static_cast<int32_t>(EnvStatus::BadRequest);
+            }
+            else if(request.count * sizeof(Chip8) + layout.size > MEMORY_BUDGET) { // Can't overflow, count is at most ENV_MAX_COUNT
+                reply.status = static_cast<int32_t>(EnvStatus::NoMemory);
+            }
+            else if((memory = CreateShared(layout.size, &shared)) < 0) {
+                reply.status = static_cast<int32_t>(EnvStatus::NoMemory);
+            }
+            else {
+                shared_size = layout.size;
+                uint8_t* base = static_cast<uint8_t*>(shared);
+                memcpy(base, &layout, sizeof(layout));
+
+                VectorEnvConfig config;
+                config.count = request.count;
+                config.threads = threads;
+                config.instructions_per_step = request.instructions_per_step;
+                config.max_episode_steps = request.max_episode_steps;
+                config.seed = request.seed;
+                config.engine = static_cast<Engine>(request.engine);
+
+                VectorEnvBuffers buffers;
+                buffers.observations = reinterpret_cast<uint64_t*>(base + layout.observations);
+                buffers.rewards = reinterpret_cast<float*>(base + layout.rewards);
+                buffers.dones = base + layout.dones;
+
+                try {
+                    env.reset(new VectorEnv(rom, config, buffers)); // Writes the first observations
+                    reply.shared_size = layout.size;
+                }
+                catch(std::bad_alloc const&) { // Within the budget but more than the host has right now, the server carries on
+                    release();
+                    close(memory);
+                    memory = -1;
+                    reply.status = static_cast<int32_t>(EnvStatus::NoMemory);
+                }
+            }
+        }
+        else if(request.command == static_cast<uint32_t>(EnvCommand::Reset) || request.command == static_cast<uint32_t>(EnvCommand::Step)) {
+            if(!env) {
+                reply.status = static_cast<int32_t>(EnvStatus::NoEnvironment);
+            }
+            else if(request.command == static_cast<uint32_t>(EnvCommand::Reset)) {
+                env->Reset();
+            }
+            else {
+                uint8_t const* base = static_cast<uint8_t const*>(shared);
+                env->Step(reinterpret_cast<uint16_t const*>(base + EnvSharedLayout(env->Count()).actions)); // Our own layout, not the header the client can scribble on
+                steps += env->Count();
+            }
+
+            if(env && !env->Classic()) {
+                reply.status = static_cast<int32_t>(EnvStatus::BadRom);
+            }
+        }
+        else if(request.command == static_cast<uint32_t>(EnvCommand::Close)) {
+            release();
+        }
+        else {
+            reply.status = static_cast<int32_t>(EnvStatus::BadRequest);
+        }
+
+        bool sent = EnvSend(session.socket, &reply, sizeof(reply), memory);
+        if(memory >= 0) {
+            close(memory); // The client has its own copy of the descriptor now
+        }
+        if(!sent) {
+            break;
+        }
+    }
+
+    release();
+    session.finished = true;
+}
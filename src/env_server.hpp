@@ -0,0 +1,48 @@
+#pragma once
+
+#include <env_protocol.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Environment server
+ * Listens on a Unix domain socket and gives every connection its own VectorEnv, stepped in
+ * place in memory shared with the client (see env_protocol.hpp). Each connection is served
+ * on its own thread and its steps run on that environment's thread pool, so trainers don't
+ * wait on each other.
+ */
+class EnvServer {
+    public:
+        explicit EnvServer(unsigned int threads = 0); // Worker threads for each environment's pool, 0 = one per hardware thread
+        ~EnvServer();
+        EnvServer(EnvServer const&) = delete;
+        EnvServer& operator=(EnvServer const&) = delete;
+
+        bool Listen(const char* path); // Bind the socket (replacing a stale one), false if that fails
+        void Serve(); // Accept and serve connections until Stop(), then hang up on all of them
+        void Stop(); // Make Serve() return, safe to call from a signal handler
+        uint64_t Steps() const { return steps.load(); } // Instance steps served so far, over every connection
+
+    private:
+        struct Session {
+            int socket;
+            std::atomic<bool> finished{false};
+            std::thread thread;
+        };
+
+        static const uint64_t MEMORY_BUDGET = uint64_t(16) << 30; // Most one environment's instances and shared memory may take
+
+        unsigned int threads;
+        int listener{-1};
+        std::string path;
+        std::atomic<bool> stopping{false};
+        std::atomic<uint64_t> steps{0};
+        std::vector<std::unique_ptr<Session>> sessions; // Only touched by Serve()
+
+        void Run(Session& session); // Serve one connection until it hangs up
+        void Reap(bool all); // Join finished sessions (or hang up on every one first) and close their sockets
+};
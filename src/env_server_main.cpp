@@ -0,0 +1,58 @@
+#include <env_server.hpp>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static void Usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--threads N] <socket>\n";
+    std::exit(EXIT_FAILURE);
+}
+
+static EnvServer* server; // For the signal handler
+
+static void OnSignal(int) {
+    server->Stop();
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int threads = 0;
+    const char* socket_path = nullptr;
+
+    for(int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if(!std::strcmp(argv[i], "--threads") && has_value) {
+            threads = std::stoul(argv[++i]);
+        }
+        else if(argv[i][0] != '-' && !socket_path) {
+            socket_path = argv[i];
+        }
+        else {
+            Usage(argv[0]);
+        }
+    }
+
+    if(!socket_path) {
+        Usage(argv[0]);
+    }
+
+    EnvServer env_server(threads);
+    if(!env_server.Listen(socket_path)) {
+        std::cerr << "Could not listen on " << socket_path << ": " << std::strerror(errno) << "\n";
+        return EXIT_FAILURE;
+    }
+
+    server = &env_server;
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    std::cerr << "Listening on " << socket_path << "\n";
+    env_server.Serve();
+
+    std::printf("env_steps: %llu\n", static_cast<unsigned long long>(env_server.Steps()));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+#include <frame_recorder.hpp>
+#include <rewind.hpp>
+#include <cstring>
+
+static const size_t V1_FRAME_BYTES = VIDEO_HEIGHT * 8;
+
+static void Put(std::vector<uint8_t>& out, uint64_t value, unsigned int bytes) {
+    for(unsigned int i = 0; i < bytes; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+static void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while(value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Words as big-endian bytes, so the byte stream reads left to right whatever the host
+static void StoreRows(Display const& video, uint8_t* bytes) {
+    *bytes++ = video.hires;
+    for(auto const& plane : video.planes) {
+        for(uint64_t word : plane) {
+            for(unsigned int i = 0; i < 8; i++) *bytes++ = static_cast<uint8_t>(word >> (56 - 8 * i));
+        }
+    }
+}
+
+static void LoadRows(uint8_t const* bytes, size_t size, Display& video) {
+    Display loaded{};
+    if(size == V1_FRAME_BYTES) { // Version 1: plane 0's rows and nothing else
+        for(unsigned int y = 0; y < VIDEO_HEIGHT; y++) {
+            for(unsigned int i = 0; i < 8; i++) loaded.planes[0][y] = loaded.planes[0][y] << 8 | *bytes++;
+        }
+    }
+    else {
+        loaded.hires = *bytes++ != 0;
+        for(auto& plane : loaded.planes) {
+            for(uint64_t& word : plane) {
+                for(unsigned int i = 0; i < 8; i++) word = word << 8 | *bytes++;
+            }
+        }
+    }
+    video = loaded;
+}
+
+/**
+ * FrameRecorder
+ */
+
+bool FrameRecorder::Open(const char* filename) {
+    Close();
+
+    file = strcmp(filename, "-") ? std::fopen(filename, "wb") : stdout;
+    if(!file) {
+        return false;
+    }
+
+    ok = true;
+    buffer.clear();
+    buffer.reserve(BUFFER_SIZE + 2 * FRAME_BYTES);
+    memset(previous, 0, sizeof(previous));
+    previous_frame = last_frame = changed = written = 0;
+    any_frames = false;
+
+    buffer.insert(buffer.end(), {'C', '8', 'F', 'R'});
+    Put(buffer, VERSION, 2);
+    Put(buffer, HIRES_WIDTH, 2);
+    Put(buffer, HIRES_HEIGHT, 2);
+    Put(buffer, 0, 2);
+    return true;
+}
+
+void FrameRecorder::Record(uint64_t frame, Display const& video) {
+    if(!file) {
+        return;
+    }
+
+    uint8_t rows[FRAME_BYTES];
+    StoreRows(video, rows);
+    last_frame = frame;
+    any_frames = true;
+
+    if(!memcmp(rows, previous, FRAME_BYTES)) {
+        return;
+    }
+
+    delta.clear();
+    RewindBuffer::Encode(rows, previous, delta, FRAME_BYTES);
+
+    PutVarint(buffer, frame - previous_frame);
+    PutVarint(buffer, delta.size());
+    buffer.insert(buffer.end(), delta.begin(), delta.end());
+
+    memcpy(previous, rows, FRAME_BYTES);
+    previous_frame = frame;
+    changed++;
+
+    if(buffer.size() >= BUFFER_SIZE) {
+        Flush();
+    }
+}
+
+bool FrameRecorder::Close() {
+    if(!file) {
+        return true;
+    }
+
+    if(any_frames) { // How long the recording ran, past the last change
+        PutVarint(buffer, last_frame + 1 - previous_frame);
+        PutVarint(buffer, 0);
+    }
+    Flush();
+
+    bool closed = file == stdout ? std::fflush(file) == 0 : std::fclose(file) == 0;
+    file = nullptr;
+    return ok && closed;
+}
+
+void FrameRecorder::Flush() {
+    ok &= std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    written += buffer.size();
+    buffer.clear();
+}
+
+/**
+ * FrameReader
+ */
+
+FrameReader::~FrameReader() {
+    if(file && file != stdin) {
+        std::fclose(file);
+    }
+}
+
+bool FrameReader::Open(const char* filename) {
+    file = strcmp(filename, "-") ? std::fopen(filename, "rb") : stdin;
+    if(!file) {
+        return false;
+    }
+
+    uint8_t header[12];
+    if(std::fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, "C8FR", 4)) {
+        return false;
+    }
+
+    auto field = [&](unsigned int offset) { return header[offset] | header[offset + 1] << 8; };
+    if(field(4) == 1 && field(6) == VIDEO_WIDTH && field(8) == VIDEO_HEIGHT) {
+        frame_bytes = V1_FRAME_BYTES;
+        return true;
+    }
+    frame_bytes = FrameRecorder::FRAME_BYTES;
+    return field(4) == FrameRecorder::VERSION && field(6) == HIRES_WIDTH && field(8) == HIRES_HEIGHT;
+}
+
+bool FrameReader::Next(uint64_t& frame, Display& video) {
+    uint64_t gap;
+    uint64_t size;
+
+    while(file && GetVarint(gap) && GetVarint(size) && size <= 4 * frame_bytes) { // No delta of one frame gets near that size
+        this->frame += gap;
+        if(started && gap == 0) {
+            return false; // Frames only go forward, the rest is damaged
+        }
+        started = true;
+
+        if(size == 0) { // End marker
+            end_frame = this->frame;
+            continue;
+        }
+
+        delta.resize(size);
+        if(std::fread(delta.data(), 1, size, file) != size) {
+            return false;
+        }
+
+        RewindBuffer::Apply(delta.data(), delta.data() + size, current, frame_bytes);
+        LoadRows(current, frame_bytes, video);
+        frame = this->frame;
+        end_frame = frame + 1;
+        return true;
+    }
+
+    return false;
+}
+
+bool FrameReader::GetVarint(uint64_t& value) {
+    value = 0;
+
+    for(unsigned int shift = 0; shift < 64; shift += 7) {
+        int byte = std::fgetc(file);
+        if(byte == EOF) {
+            return false;
+        }
+
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if(!(byte & 0x80)) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+/**
+ * Frame recordings
+ * Video capture at the display's own resolution: 1 bit per pixel, and only the frames that
+ * changed. Each one is stored as the XOR against the frame before it, run-length encoded with
+ * the rewind buffer's codec, so a frame where a sprite moved costs a few bytes and a static
+ * screen costs nothing. Records go through a 64 KiB buffer to a file or a pipe, and a recording
+ * can be read back as it's being written (e.g. `chip8_headless --record-video - ... | chip8_frames -`).
+ *
+ * File layout: "C8FR", u16 version, u16 width, u16 height, u16 reserved (little-endian), then
+ * one record per changed frame: varint frames since the previous record (the first counts from
+ * frame 0), varint delta size, the delta. A frame is a hires byte (0 or 1) then both planes'
+ * words (see Display), each as big-endian bytes, leftmost pixel in the MSB. The header's size is
+ * the largest frame, 128x64. A record with an empty delta (the last one) only marks how long the
+ * recording ran. Version 1 recordings (64x32, a frame is plane 0's 32 rows) can still be read.
+ */
+
+class FrameRecorder {
+    public:
+        static const uint16_t VERSION = 2;
+        static const size_t FRAME_BYTES = 1 + VIDEO_PLANES * VIDEO_WORDS * 8; // As stored
+
+        ~FrameRecorder() { Close(); }
+
+        bool Open(const char* filename); // "-" writes to stdout
+        void Record(uint64_t frame, Display const& video); // Call once per frame, frame numbers must go up. Unchanged frames only cost a compare
+        bool Close(); // Mark the last frame and flush, false if anything failed to write
+
+        uint64_t ChangedFrames() const { return changed; }
+        uint64_t Bytes() const { return written + buffer.size(); } // Encoded size so far, header included
+
+    private:
+        static const size_t BUFFER_SIZE = 64u << 10;
+
+        FILE* file{};
+        bool ok{};
+        std::vector<uint8_t> buffer; // Records not written out yet
+        std::vector<uint8_t> delta; // Scratch for the record being encoded
+        uint8_t previous[FRAME_BYTES]{}; // Last recorded frame, as stored
+        uint64_t previous_frame{}; // Frame number of the last record
+        uint64_t last_frame{}; // Newest frame seen
+        bool any_frames{};
+        uint64_t changed{};
+        uint64_t written{};
+
+        void Flush();
+};
+
+class FrameReader {
+    public:
+        ~FrameReader();
+
+        bool Open(const char* filename); // "-" reads from stdin, false if it isn't a recording this version can read
+        bool Next(uint64_t& frame, Display& video); // The next changed frame and its number, false at the end (or if the rest is damaged)
+        uint64_t Frames() const { return end_frame; } // As of the last Next(): one past the last frame the recording covers
+
+    private:
+        FILE* file{};
+        uint8_t current[FrameRecorder::FRAME_BYTES]{};
+        size_t frame_bytes{}; // Of this recording's version
+        uint64_t frame{}; // Frame of the last record read
+        uint64_t end_frame{};
+        bool started{};
+        std::vector<uint8_t> delta;
+
+        bool GetVarint(uint64_t& value);
+};
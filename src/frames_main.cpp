@@ -0,0 +1,205 @@
+#include <frame_recorder.hpp>
+#include <renderer.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Frame recording decoder
+ * Reads a recording made with --record-video and writes the frames out as numbered
+ * PPM or PNG images (<prefix>_<frame>.ppm), drawn by the software renderer. By default
+ * only the frames that changed are written; --every-frame fills in the ones in between.
+ * Without a prefix it only prints what's in the recording.
+ */
+
+static void Usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--format ppm|png] [--scale N] [--scale2x] [--scanlines <percent>] [--every-frame] <recording> [<output prefix>]\n";
+    std::exit(EXIT_FAILURE);
+}
+
+static void Put32BE(std::vector<uint8_t>& out, uint32_t value) {
+    for(int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+}
+
+static uint32_t Crc32(uint8_t const* data, size_t size) {
+    static uint32_t table[256];
+    if(!table[1]) {
+        for(uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for(int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+
+    uint32_t crc = 0xFFFFFFFFu;
+    for(size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void PutChunk(std::vector<uint8_t>& png, char const* type, std::vector<uint8_t> const& data) {
+    Put32BE(png, data.size());
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    Put32BE(png, Crc32(png.data() + start, png.size() - start));
+}
+
+// 8-bit RGB PNG. The zlib stream uses stored (uncompressed) blocks, so there's no zlib dependency; recompress with any PNG optimizer
+static bool WritePNG(std::string const& filename, std::vector<uint8_t> const& rgb, unsigned int width, unsigned int height) {
+    std::vector<uint8_t> raw; // Each row with filter type 0 in front
+    raw.reserve((width * 3 + 1) * height);
+    for(unsigned int y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgb.begin() + y * width * 3, rgb.begin() + (y + 1) * width * 3);
+    }
+
+    std::vector<uint8_t> header;
+    Put32BE(header, width);
+    Put32BE(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bits per channel, RGB, no interlace
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    for(size_t offset = 0; offset < raw.size() || offset == 0; offset += 0xFFFF) {
+        size_t length = std::min<size_t>(0xFFFF, raw.size() - offset);
+        zlib.push_back(offset + length == raw.size());
+        zlib.insert(zlib.end(), {static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(~length), static_cast<uint8_t>(~length >> 8)});
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+    }
+
+    uint32_t a = 1, b = 0; // Adler-32
+    for(uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    Put32BE(zlib, b << 16 | a);
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    PutChunk(png, "IHDR", header);
+    PutChunk(png, "IDAT", zlib);
+    PutChunk(png, "IEND", {});
+
+    FILE* file = std::fopen(filename.c_str(), "wb");
+    if(!file) {
+        return false;
+    }
+    bool ok = std::fwrite(png.data(), 1, png.size(), file) == png.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+static bool WritePPM(std::string const& filename, std::vector<uint8_t> const& rgb, unsigned int width, unsigned int height) {
+    FILE* file = std::fopen(filename.c_str(), "wb");
+    if(!file) {
+        return false;
+    }
+    std::fprintf(file, "P6\n%u %u\n255\n", width, height);
+    bool ok = std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+int main(int argc, char* argv[]) {
+    SoftwareRenderer::Options options;
+    options.on_color = 0xFFFFFFFF; // 0xRRGGBB in the low bytes
+    options.off_color = 0xFF000000;
+    bool png = false;
+    bool every_frame = false;
+    const char* recording_filename = nullptr;
+    const char* prefix = nullptr;
+
+    for(int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if(!std::strcmp(argv[i], "--format") && has_value) {
+            std::string format = argv[++i];
+            if(format == "png") png = true;
+            else if(format != "ppm") Usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "--scale") && has_value) {
+            options.scale = std::stoul(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--scale2x")) {
+            options.scale2x = true;
+        }
+        else if(!std::strcmp(argv[i], "--scanlines") && has_value) {
+            options.scanline = std::stoul(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--every-frame")) {
+            every_frame = true;
+        }
+        else if((argv[i][0] != '-' || !std::strcmp(argv[i], "-")) && !recording_filename) {
+            recording_filename = argv[i];
+        }
+        else if(argv[i][0] != '-' && !prefix) {
+            prefix = argv[i];
+        }
+        else {
+            Usage(argv[0]);
+        }
+    }
+
+    SoftwareRenderer renderer(options);
+    if(!recording_filename || !renderer.Valid()) {
+        Usage(argv[0]);
+    }
+
+    FrameReader reader;
+    if(!reader.Open(recording_filename)) {
+        std::cerr << "Could not open frame recording: " << recording_filename << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint32_t> pixels(renderer.Width() * renderer.Height());
+    std::vector<uint8_t> rgb(pixels.size() * 3);
+    uint64_t images = 0;
+
+    auto write = [&](uint64_t frame, Display const& video) {
+        renderer.Render(video, pixels.data(), renderer.Width() * sizeof(uint32_t));
+        for(size_t i = 0; i < pixels.size(); i++) {
+            rgb[i * 3] = pixels[i] >> 16;
+            rgb[i * 3 + 1] = pixels[i] >> 8;
+            rgb[i * 3 + 2] = pixels[i];
+        }
+
+        char number[32];
+        std::snprintf(number, sizeof(number), "_%06llu.%s", static_cast<unsigned long long>(frame), png ? "png" : "ppm");
+        std::string filename = prefix + std::string(number);
+
+        if(!(png ? WritePNG : WritePPM)(filename, rgb, renderer.Width(), renderer.Height())) {
+            std::cerr << "Could not write " << filename << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+        images++;
+    };
+
+    Display shown{}; // The screen as of the last frame read, blank before the first
+    Display video;
+    uint64_t frame;
+    uint64_t next = 0; // First frame not written yet
+    uint64_t changed = 0;
+
+    while(reader.Next(frame, video)) {
+        changed++;
+        if(prefix && every_frame) {
+            for(; next < frame; next++) write(next, shown);
+        }
+
+        shown = video;
+        if(prefix) {
+            write(frame, shown);
+        }
+        next = frame + 1;
+    }
+
+    if(prefix && every_frame) {
+        for(; next < reader.Frames(); next++) write(next, shown);
+    }
+
+    std::printf("frames: %llu\n", static_cast<unsigned long long>(reader.Frames()));
+    std::printf("changed_frames: %llu\n", static_cast<unsigned long long>(changed));
+    std::printf("images: %llu\n", static_cast<unsigned long long>(images));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+#include <headless.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+bool InputScript::Load(const char* filename) {
+    std::ifstream file(filename);
+
+    if(!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    unsigned int line_number = 0;
+
+    while(std::getline(file, line)) {
+        line_number++;
+
+        // Strip comments and skip blank lines
+        size_t hash = line.find('#');
+        if(hash != std::string::npos) {
+            line.erase(hash);
+        }
+        if(line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        uint64_t frame;
+        std::string key;
+        std::string state;
+
+        if(!(fields >> frame >> key >> state)) {
+            std::cerr << filename << ":" << line_number << ": expected <frame> <key> <down|up>\n";
+            return false;
+        }
+
+        unsigned long key_value = std::strtoul(key.c_str(), nullptr, 16); // Keys are written in hex, like the keypad
+        if(key_value >= KEY_COUNT || (state != "down" && state != "up")) {
+            std::cerr << filename << ":" << line_number << ": bad key or state\n";
+            return false;
+        }
+
+        events.push_back({frame, static_cast<uint8_t>(key_value), static_cast<uint8_t>(state == "down")});
+    }
+
+    // Events are applied in frame order, keep the file order for events on the same frame
+    std::stable_sort(events.begin(), events.end(), [](InputEvent const& a, InputEvent const& b) {
+        return a.frame < b.frame;
+    });
+    next = 0;
+
+    return true;
+}
+
+void InputScript::Apply(uint64_t frame, Chip8& chip8) {
+    while(next < events.size() && events[next].frame <= frame) {
+        chip8.SetKey(events[next].key, events[next].pressed);
+        next++;
+    }
+}
+
+// FNV-1a over the display buffer. Plane 1 and the resolution only go in once a ROM uses them,
+// so a classic ROM hashes exactly as it did on the single plane 64x32 display
+static uint64_t VideoHash(Chip8 const& chip8) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    auto add = [&hash](uint64_t const* words, size_t count) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(words);
+        for(size_t i = 0; i < count * sizeof(uint64_t); i++) {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+        }
+    };
+
+    Display const& video = chip8.video;
+    add(video.planes[0], video.Words());
+    bool color = false;
+    for(unsigned int i = 0; i < video.Words(); i++) {
+        color |= video.planes[1][i] != 0;
+    }
+    if(color || video.hires) {
+        uint64_t mode = (video.hires ? 1u : 0u) | (color ? 2u : 0u);
+        add(&mode, 1);
+        if(color) {
+            add(video.planes[1], video.Words());
+        }
+    }
+    return hash;
+}
+
+HeadlessReport RunHeadless(Chip8& chip8, HeadlessConfig const& config, InputScript* script, Movie* recording, FrameRecorder* video) {
+    HeadlessReport report;
+    uint64_t first_skipped = chip8.SkippedCount();
+
+    auto start = std::chrono::steady_clock::now();
+
+    while(true) {
+        if(config.max_frames && report.frames >= config.max_frames) {
+            break;
+        }
+        if(config.max_instructions && report.instructions >= config.max_instructions) {
+            break;
+        }
+
+        if(script) {
+            script->Apply(report.frames, chip8);
+        }
+        if(recording) {
+            recording->RecordFrame(chip8);
+        }
+
+        // Run one frame worth of instructions, cut short if we hit the instruction limit
+        uint64_t budget = config.instructions_per_frame;
+        if(config.max_instructions) {
+            budget = std::min<uint64_t>(budget, config.max_instructions - report.instructions);
+        }
+
+        report.instructions += chip8.Run(budget);
+        chip8.TickTimers(); // Every frame is one 60 Hz timer tick
+        if(video) {
+            video->Record(report.frames, chip8.video);
+        }
+        report.frames++;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    report.wall_seconds = std::chrono::duration<double>(end - start).count();
+    report.skipped = chip8.SkippedCount() - first_skipped;
+
+    report.video_hash = VideoHash(chip8);
+
+    return report;
+}
+
+HeadlessReport RunMovie(Chip8& chip8, Movie const& movie, uint64_t first_frame, uint64_t frames) {
+    HeadlessReport report;
+
+    auto start = std::chrono::steady_clock::now();
+
+    report.desynced = !movie.Seek(first_frame, chip8);
+    uint64_t first_instruction = chip8.InstructionCount();
+    uint64_t first_skipped = chip8.SkippedCount();
+
+    for(uint64_t frame = first_frame; frame < first_frame + frames; frame++) {
+        report.desynced |= !movie.RunFrame(frame, chip8);
+        report.frames++;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    report.wall_seconds = std::chrono::duration<double>(end - start).count();
+    report.instructions = chip8.InstructionCount() - first_instruction;
+    report.skipped = chip8.SkippedCount() - first_skipped;
+    report.video_hash = VideoHash(chip8);
+
+    return report;
+}
+
+void PrintReport(HeadlessReport const& report, FILE* out) {
+    double seconds = report.wall_seconds > 0 ? report.wall_seconds : 1e-9; // Don't divide by zero on empty runs
+
+    std::fprintf(out, "instructions: %llu\n", static_cast<unsigned long long>(report.instructions));
+    std::fprintf(out, "executed_instructions: %llu\n", static_cast<unsigned long long>(report.instructions - report.skipped));
+    std::fprintf(out, "skipped_instructions: %llu\n", static_cast<unsigned long long>(report.skipped));
+    std::fprintf(out, "frames: %llu\n", static_cast<unsigned long long>(report.frames));
+    std::fprintf(out, "wall_time_s: %.6f\n", report.wall_seconds);
+    std::fprintf(out, "instructions_per_s: %.0f\n", (report.instructions - report.skipped) / seconds); // Skipped ones cost nothing, counting them would flatter idle ROMs
+    std::fprintf(out, "frames_per_s: %.1f\n", report.frames / seconds);
+    std::fprintf(out, "video_hash: %016llx\n", static_cast<unsigned long long>(report.video_hash));
+}
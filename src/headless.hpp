@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <frame_recorder.hpp>
+#include <movie.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+
+/**
+ * Headless execution
+ * Runs a ROM with no SDL at all: no window, no renderer, no event pump.
+ * Keypad input comes from a script instead of the keyboard, and the run ends
+ * after a fixed number of instructions and/or frames.
+ */
+
+// A single scripted keypad change, applied at the start of the given frame
+struct InputEvent {
+    uint64_t frame; // Frame number the change is applied on
+    uint8_t key; // Keypad key (0x0 - 0xF)
+    uint8_t pressed; // 1 = key down, 0 = key up
+};
+
+class InputScript {
+    public:
+        bool Load(const char* filename); // Parse "<frame> <key> <down|up>" lines, returns false on error
+        void Apply(uint64_t frame, Chip8& chip8); // Apply every event scheduled for this frame to the keypad
+
+    private:
+        std::vector<InputEvent> events; // Sorted by frame
+        size_t next{}; // Next event that has not been applied yet
+};
+
+struct HeadlessConfig {
+    uint64_t max_instructions{}; // Stop after this many instructions (0 = no limit)
+    uint64_t max_frames{}; // Stop after this many frames (0 = no limit)
+    unsigned int instructions_per_frame{10}; // How many instructions make up one frame
+};
+
+struct HeadlessReport {
+    uint64_t instructions{}; // Instructions executed, as the ROM sees it
+    uint64_t skipped{}; // Of those, how many idle loop skipping counted without running
+    uint64_t frames{}; // Frames executed
+    double wall_seconds{}; // Wall time spent emulating
+    uint64_t video_hash{}; // FNV-1a hash of the final frame, to catch behavior changes
+    bool desynced{}; // A movie's instruction stamps didn't match the run
+};
+
+HeadlessReport RunHeadless(Chip8& chip8, HeadlessConfig const& config, InputScript* script, Movie* recording = nullptr, FrameRecorder* video = nullptr); // Run until a limit is hit, optionally recording a movie and/or the video
+HeadlessReport RunMovie(Chip8& chip8, Movie const& movie, uint64_t first_frame, uint64_t frames); // Seek to a movie frame and play the given number of frames
+void PrintReport(HeadlessReport const& report, FILE* out = stdout); // Print instructions/sec (actually run), frames/sec and wall time
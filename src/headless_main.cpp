@@ -0,0 +1,337 @@
+#include <chip_8.hpp>
+#include <headless.hpp>
+#include <profiler.hpp>
+#include <rom_corpus.hpp>
+#include <scheduler.hpp>
+#include <tracer.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+static void Usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--instructions N] [--frames N] [--ipf N] [--input <script>] [--seed N] [--engine interpreter|jit|aot] [--load-state <file>] [--save-state <file>] [--record <movie>] [--record-video <file|->] [--movie <movie> [--seek N]] [--corpus <archive>]"
+#ifdef CHIP8_PROFILE
+              << " [--profile <prefix>]"
+#endif
+#ifdef CHIP8_TRACE
+              << " [--trace <file>]"
+#endif
+              << " <ROM>\n";
+    std::exit(EXIT_FAILURE);
+}
+
+// Say why SetEngine() turned the engine down
+static void EngineUnavailable(Engine engine) {
+    if(Chip8::InterpreterOnly()) {
+        std::cerr << "Tracing/profiling builds only run the interpreter\n";
+    }
+    else {
+        std::cerr << (engine == Engine::Aot ? "No ahead-of-time build of this ROM, using the interpreter\n" : "JIT not available on this host, using the interpreter\n");
+    }
+}
+
+// Load a ROM file, or with a corpus open, the ROM with that name or hash
+static bool LoadROM(Chip8& chip8, RomCorpus const& corpus, const char* ROM_filename) {
+    if(corpus.Count()) {
+        RomCorpus::Entry const* entry = corpus.Find(ROM_filename);
+        if(!entry) {
+            std::cerr << "No ROM named " << ROM_filename << " in the corpus\n";
+            return false;
+        }
+
+        RomCorpus::Load(*entry, chip8);
+        return true;
+    }
+
+    if(!chip8.LoadROM(ROM_filename)) {
+        std::cerr << "Could not load ROM (missing, empty or bigger than " << XO_MAX_ROM_SIZE << " bytes): " << ROM_filename << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Play back (part of) a recorded movie, by default from the seek point to the end
+static int PlayMovie(const char* movie_filename, uint64_t seek_frame, uint64_t frames, Engine engine, RomCorpus const& corpus, const char* ROM_filename,
+                     const char* trace_filename) {
+    Movie movie;
+    if(!movie.Load(movie_filename)) {
+        std::cerr << "Could not load movie: " << movie_filename << "\n";
+        return EXIT_FAILURE;
+    }
+    if(seek_frame > movie.Frames()) {
+        std::cerr << "Movie only has " << movie.Frames() << " frames\n";
+        return EXIT_FAILURE;
+    }
+
+    Chip8 chip8(movie.Seed());
+    if(!LoadROM(chip8, corpus, ROM_filename)) {
+        return EXIT_FAILURE;
+    }
+    if(!movie.MatchesROM(chip8)) {
+        std::cerr << "Movie was recorded with a different ROM\n";
+        return EXIT_FAILURE;
+    }
+
+    if(!chip8.SetEngine(engine)) {
+        EngineUnavailable(engine);
+    }
+
+#ifdef CHIP8_TRACE
+    Tracer tracer;
+    if(trace_filename) { // Seeking replays from a keyframe, traced too, so traces of the same movie and seek point line up
+        if(!tracer.Open(trace_filename)) {
+            std::cerr << "Could not create trace: " << trace_filename << "\n";
+            return EXIT_FAILURE;
+        }
+        chip8.SetTracer(&tracer);
+    }
+#else
+    (void)trace_filename; // main() turns --trace down without a tracing build
+#endif
+
+    HeadlessReport report = RunMovie(chip8, movie, seek_frame, frames ? frames : movie.Frames() - seek_frame);
+    PrintReport(report);
+
+#ifdef CHIP8_TRACE
+    if(trace_filename && !tracer.Close()) {
+        std::cerr << "Could not write trace: " << trace_filename << "\n";
+        return EXIT_FAILURE;
+    }
+#endif
+
+    if(report.desynced) {
+        std::cerr << "Movie desynced: instruction counts don't match the recording\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char* argv[]) {
+    HeadlessConfig config;
+    const char* input_filename = nullptr;
+    const char* seed = nullptr;
+    Engine engine = Engine::Interpreter;
+    const char* load_state_filename = nullptr;
+    const char* save_state_filename = nullptr;
+    const char* record_filename = nullptr;
+    const char* video_filename = nullptr;
+    const char* movie_filename = nullptr;
+    uint64_t seek_frame = 0;
+    const char* corpus_filename = nullptr;
+    bool ipf_given = false;
+    const char* profile_prefix = nullptr;
+    const char* trace_filename = nullptr;
+    const char* ROM_filename = nullptr;
+
+    // Parse the args, everything but the ROM is optional
+    for(int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if(!std::strcmp(argv[i], "--instructions") && has_value) {
+            config.max_instructions = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--frames") && has_value) {
+            config.max_frames = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--ipf") && has_value) {
+            config.instructions_per_frame = std::stoul(argv[++i]);
+            ipf_given = true;
+        }
+        else if(!std::strcmp(argv[i], "--input") && has_value) {
+            input_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--seed") && has_value) {
+            seed = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--engine") && has_value) {
+            std::string name = argv[++i];
+            if(name == "jit") engine = Engine::Jit;
+            else if(name == "aot") engine = Engine::Aot;
+            else if(name != "interpreter") Usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "--load-state") && has_value) {
+            load_state_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--save-state") && has_value) {
+            save_state_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--record") && has_value) {
+            record_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--record-video") && has_value) {
+            video_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--movie") && has_value) {
+            movie_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--seek") && has_value) {
+            seek_frame = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--corpus") && has_value) {
+            corpus_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--profile") && has_value) {
+            profile_prefix = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--trace") && has_value) {
+            trace_filename = argv[++i];
+        }
+        else if(argv[i][0] != '-' && !ROM_filename) {
+            ROM_filename = argv[i];
+        }
+        else {
+            Usage(argv[0]);
+        }
+    }
+
+    if(!ROM_filename || config.instructions_per_frame == 0) {
+        Usage(argv[0]);
+    }
+
+    // Movies are made of whole frames, and playing one back replaces the other inputs
+    if((record_filename && (config.max_instructions || movie_filename)) || (seek_frame && !movie_filename) || ((profile_prefix || video_filename) && movie_filename)) {
+        Usage(argv[0]);
+    }
+
+#ifndef CHIP8_TRACE
+    if(trace_filename) {
+        std::cerr << "Tracing needs a build configured with -DCHIP8_TRACE=ON\n";
+        std::exit(EXIT_FAILURE);
+    }
+#endif
+
+    RomCorpus corpus;
+    if(corpus_filename && (!corpus.Open(corpus_filename) || corpus.Count() == 0)) {
+        std::cerr << "Could not open corpus (or it's empty): " << corpus_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    if(movie_filename) {
+        return PlayMovie(movie_filename, seek_frame, config.max_frames, engine, corpus, ROM_filename, trace_filename);
+    }
+
+    // Corpus ROMs come with a recommended speed
+    RomCorpus::Entry const* entry = corpus.Count() ? corpus.Find(ROM_filename) : nullptr;
+    if(entry && entry->ips && !ipf_given) {
+        config.instructions_per_frame = std::max(1u, entry->ips / FrameScheduler::FRAME_RATE);
+    }
+
+    // Without a limit we'd run forever, default to ten seconds of 60 Hz frames
+    if(!config.max_instructions && !config.max_frames) {
+        config.max_frames = 600;
+    }
+
+    InputScript script;
+    if(input_filename && !script.Load(input_filename)) {
+        std::cerr << "Could not load input script: " << input_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    // A fixed seed makes the run (and the final video hash) reproducible
+    unsigned int seed_value = seed ? std::stoul(seed) : std::chrono::system_clock::now().time_since_epoch().count();
+    Chip8 chip8(seed_value);
+    if(!LoadROM(chip8, corpus, ROM_filename)) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    if(!chip8.SetEngine(engine)) {
+        EngineUnavailable(engine);
+    }
+
+    Movie movie; // Begun before any save state is loaded, it checks the ROM (the first keyframe holds the loaded state)
+    if(record_filename) {
+        movie.Begin(chip8, seed_value, static_cast<uint64_t>(config.instructions_per_frame) * FrameScheduler::FRAME_RATE);
+    }
+
+    // Pick up exactly where a previous run (e.g. a QA repro) left off
+    uint8_t state[STATE_SIZE];
+    if(load_state_filename) {
+        std::ifstream file(load_state_filename, std::ios::binary);
+        file.read(reinterpret_cast<char*>(state), sizeof(state));
+
+        if(file.bad() || !chip8.LoadState(state, static_cast<size_t>(file.gcount()))) { // Short reads are fine, version 1 states are smaller
+            std::cerr << "Could not load save state: " << load_state_filename << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+#ifdef CHIP8_PROFILE
+    Profiler profiler;
+    if(profile_prefix) {
+        chip8.SetProfiler(&profiler);
+    }
+#else
+    if(profile_prefix) {
+        std::cerr << "Profiling needs a build configured with -DCHIP8_PROFILE=ON\n";
+        std::exit(EXIT_FAILURE);
+    }
+#endif
+
+#ifdef CHIP8_TRACE
+    Tracer tracer;
+    if(trace_filename) {
+        if(!tracer.Open(trace_filename)) {
+            std::cerr << "Could not create trace: " << trace_filename << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+        chip8.SetTracer(&tracer);
+    }
+#endif
+
+    FrameRecorder video;
+    if(video_filename && !video.Open(video_filename)) {
+        std::cerr << "Could not open frame recording: " << video_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    HeadlessReport report = RunHeadless(chip8, config, input_filename ? &script : nullptr, record_filename ? &movie : nullptr, video_filename ? &video : nullptr);
+
+    if(video_filename && !video.Close()) {
+        std::cerr << "Could not write frame recording: " << video_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+    PrintReport(report, video_filename && !std::strcmp(video_filename, "-") ? stderr : stdout); // Keep the report out of a piped recording
+
+#ifdef CHIP8_TRACE
+    if(trace_filename && !tracer.Close()) {
+        std::cerr << "Could not write trace: " << trace_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+#endif
+
+#ifdef CHIP8_PROFILE
+    if(profile_prefix) {
+        std::ofstream json(std::string(profile_prefix) + ".json");
+        std::ofstream folded(std::string(profile_prefix) + ".folded");
+        profiler.WriteJson(json);
+        profiler.WriteFolded(folded);
+
+        if(!json || !folded) {
+            std::cerr << "Could not write profile: " << profile_prefix << ".json/.folded\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+#endif
+
+    if(record_filename && !movie.Save(record_filename)) {
+        std::cerr << "Could not write movie: " << record_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    if(save_state_filename) {
+        size_t size = chip8.SaveState(state);
+
+        std::ofstream file(save_state_filename, std::ios::binary);
+        if(!file.write(reinterpret_cast<char const*>(state), size)) {
+            std::cerr << "Could not write save state: " << save_state_filename << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,911 @@
+#include <jit_x64.hpp>
+#include <chip_8.hpp>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#include <sys/mman.h>
+#define CHIP8_JIT_SUPPORTED 1
+#endif
+
+const size_t CODE_BUFFER_SIZE = 8 * 1024 * 1024; // Executable memory for translated blocks
+
+#ifdef CHIP8_JIT_SUPPORTED
+
+namespace {
+
+// Host registers, numbered the way x86-64 encodes them
+enum Reg {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+};
+
+// Condition codes (low nibble of Jcc/SETcc/CMOVcc)
+enum Cond {
+    CC_B = 0x2, // Unsigned below (carry set)
+    CC_AE = 0x3, // Unsigned above or equal
+    CC_E = 0x4, // Equal
+    CC_NE = 0x5, // Not equal
+    CC_BE = 0x6, // Unsigned below or equal
+    CC_A = 0x7, // Unsigned above
+    CC_S = 0x8 // Sign
+};
+
+// Group 1 ALU operations, the /digit of 0x81/0x83 (and op * 8 + 1 is the reg, reg form)
+enum Alu {
+    ALU_ADD = 0,
+    ALU_OR = 1,
+    ALU_AND = 4,
+    ALU_SUB = 5,
+    ALU_XOR = 6,
+    ALU_CMP = 7
+};
+
+/**
+ * A tiny x86-64 assembler
+ * Just the handful of instruction forms the recompiler needs. All memory operands are
+ * [rbx + disp32] (optionally + index * scale), rbx always holds the Chip8 pointer.
+ */
+class Assembler {
+    public:
+        std::vector<uint8_t> bytes;
+
+        void Byte(uint8_t value) { bytes.push_back(value); }
+
+        void Word(uint16_t value) {
+            Byte(value & 0xFFu);
+            Byte(value >> 8u);
+        }
+
+        void Dword(uint32_t value) {
+            for(int i = 0; i < 4; i++) Byte((value >> (8 * i)) & 0xFFu);
+        }
+
+        void Qword(uint64_t value) {
+            for(int i = 0; i < 8; i++) Byte((value >> (8 * i)) & 0xFFu);
+        }
+
+        // REX prefix, only emitted when needed (or forced, for sil/dil/spl/bpl byte access)
+        void Rex(bool w, int reg, int index, int base, bool force = false) {
+            uint8_t rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+            if(rex != 0x40 || force) Byte(rex);
+        }
+
+        void ModRM(int mod, int reg, int rm) { Byte((mod << 6) | ((reg & 7) << 3) | (rm & 7)); }
+
+        // [rbx + disp32]
+        void Mem(int reg, int32_t disp) {
+            ModRM(2, reg, RBX);
+            Dword(disp);
+        }
+
+        // [rbx + index * (1 << scale) + disp32]
+        void MemIndexed(int reg, int32_t disp, int index, int scale) {
+            ModRM(2, reg, 4);
+            Byte((scale << 6) | ((index & 7) << 3) | RBX);
+            Dword(disp);
+        }
+
+        // mov dst32, src32
+        void MovRR(int dst, int src) {
+            if(dst == src) return;
+            Rex(false, src, 0, dst);
+            Byte(0x89);
+            ModRM(3, src, dst);
+        }
+
+        // mov dst32, imm32
+        void MovRI(int dst, uint32_t imm) {
+            Rex(false, 0, 0, dst);
+            Byte(0xB8 + (dst & 7));
+            Dword(imm);
+        }
+
+        // <op> dst32, src32
+        void AluRR(Alu op, int dst, int src) {
+            Rex(false, src, 0, dst);
+            Byte(op * 8 + 1);
+            ModRM(3, src, dst);
+        }
+
+        // <op> dst32, imm32
+        void AluRI(Alu op, int dst, int32_t imm) {
+            Rex(false, 0, 0, dst);
+            if(imm >= -128 && imm <= 127) {
+                Byte(0x83);
+                ModRM(3, op, dst);
+                Byte(imm & 0xFF);
+            }
+            else {
+                Byte(0x81);
+                ModRM(3, op, dst);
+                Dword(imm);
+            }
+        }
+
+        // shl/shr dst32, imm8
+        void ShlRI(int dst, uint8_t imm) { Shift(4, dst, imm); }
+        void ShrRI(int dst, uint8_t imm) { Shift(5, dst, imm); }
+
+        // test dst32, src32
+        void TestRR(int dst, int src) {
+            Rex(false, src, 0, dst);
+            Byte(0x85);
+            ModRM(3, src, dst);
+        }
+
+        // bt dst32, bit32 (CF = bit of dst, the bit number is taken mod 32)
+        void BtRR(int dst, int bit) {
+            Rex(false, bit, 0, dst);
+            Byte(0x0F);
+            Byte(0xA3);
+            ModRM(3, bit, dst);
+        }
+
+        // cmov<cc> dst32, src32
+        void CmovRR(Cond cc, int dst, int src) {
+            Rex(false, dst, 0, src);
+            Byte(0x0F);
+            Byte(0x40 + cc);
+            ModRM(3, dst, src);
+        }
+
+        // set<cc> dst8 + movzx dst32, dst8 (dst must be eax, ecx or edx)
+        void SetccRR(Cond cc, int dst) {
+            Byte(0x0F);
+            Byte(0x90 + cc);
+            ModRM(3, 0, dst);
+            Byte(0x0F);
+            Byte(0xB6);
+            ModRM(3, dst, dst);
+        }
+
+        // imul dst32, src32, imm8
+        void ImulRRI(int dst, int src, int8_t imm) {
+            Rex(false, dst, 0, src);
+            Byte(0x6B);
+            ModRM(3, dst, src);
+            Byte(imm);
+        }
+
+        // movzx dst32, byte [rbx + disp]
+        void LoadByte(int dst, int32_t disp) {
+            Rex(false, dst, 0, RBX);
+            Byte(0x0F);
+            Byte(0xB6);
+            Mem(dst, disp);
+        }
+
+        // movzx dst32, word [rbx + disp]
+        void LoadWord(int dst, int32_t disp) {
+            Rex(false, dst, 0, RBX);
+            Byte(0x0F);
+            Byte(0xB7);
+            Mem(dst, disp);
+        }
+
+        // movzx dst32, word [rbx + index * 2 + disp]
+        void LoadWordIndexed(int dst, int32_t disp, int index) {
+            Rex(false, dst, index, RBX);
+            Byte(0x0F);
+            Byte(0xB7);
+            MemIndexed(dst, disp, index, 1);
+        }
+
+        // mov byte [rbx + disp], src8
+        void StoreByte(int32_t disp, int src) {
+            Rex(false, src, 0, RBX, src >= RSP); // Without a REX prefix 4-7 would mean ah/ch/dh/bh
+            Byte(0x88);
+            Mem(src, disp);
+        }
+
+        // mov word [rbx + disp], src16
+        void StoreWord(int32_t disp, int src) {
+            Byte(0x66);
+            Rex(false, src, 0, RBX);
+            Byte(0x89);
+            Mem(src, disp);
+        }
+
+        // mov word [rbx + disp], imm16
+        void StoreWordImm(int32_t disp, uint16_t imm) {
+            Byte(0x66);
+            Byte(0xC7);
+            Mem(0, disp);
+            Word(imm);
+        }
+
+        // mov word [rbx + index * 2 + disp], imm16
+        void StoreWordImmIndexed(int32_t disp, int index, uint16_t imm) {
+            Byte(0x66);
+            Rex(false, 0, index, RBX);
+            Byte(0xC7);
+            MemIndexed(0, disp, index, 1);
+            Word(imm);
+        }
+
+        // add qword [rbx + disp], imm32
+        void AddMem64(int32_t disp, int32_t imm) {
+            Byte(0x48);
+            Byte(0x81);
+            Mem(ALU_ADD, disp);
+            Dword(imm);
+        }
+
+        void Push(int reg) {
+            Rex(false, 0, 0, reg);
+            Byte(0x50 + (reg & 7));
+        }
+
+        void Pop(int reg) {
+            Rex(false, 0, 0, reg);
+            Byte(0x58 + (reg & 7));
+        }
+
+        // mov rdi, rbx; mov rsi, arg; mov rax, function; call rax
+        void CallHelper(void (*function)(Chip8*, void const*), void const* arg) {
+            MovRR64(RDI, RBX);
+            MovRI64(RSI, reinterpret_cast<uint64_t>(arg));
+            MovRI64(RAX, reinterpret_cast<uint64_t>(function));
+            Byte(0xFF); ModRM(3, 2, RAX);
+        }
+
+        // mov dst64, imm64
+        void MovRI64(int dst, uint64_t imm) {
+            Rex(true, 0, 0, dst);
+            Byte(0xB8 + (dst & 7));
+            Qword(imm);
+        }
+
+        // mov dst64, [base + index * 8]
+        void LoadQwordTable(int dst, int base, int index) {
+            Rex(true, dst, index, base);
+            Byte(0x8B);
+            ModRM(0, dst, 4);
+            Byte((3 << 6) | ((index & 7) << 3) | (base & 7));
+        }
+
+        // movzx dst32, byte [base + index]
+        void LoadByteTable(int dst, int base, int index) {
+            Rex(false, dst, index, base);
+            Byte(0x0F);
+            Byte(0xB6);
+            ModRM(0, dst, 4);
+            Byte(((index & 7) << 3) | (base & 7));
+        }
+
+        // add dst64, qword [rbx + disp]
+        void AddRM64(int dst, int32_t disp) {
+            Rex(true, dst, 0, RBX);
+            Byte(0x03);
+            Mem(dst, disp);
+        }
+
+        // cmp dst64, qword [base]
+        void CmpRM64(int dst, int base) {
+            Rex(true, dst, 0, base);
+            Byte(0x3B);
+            ModRM(0, dst, base);
+        }
+
+        // test dst64, src64
+        void TestRR64(int dst, int src) {
+            Rex(true, src, 0, dst);
+            Byte(0x85);
+            ModRM(3, src, dst);
+        }
+
+        // j<cc> rel32 to a label we don't know yet, returns the spot to patch
+        size_t JccForward(Cond cc) {
+            Byte(0x0F);
+            Byte(0x80 + cc);
+            Dword(0);
+            return bytes.size() - 4;
+        }
+
+        // j<cc> rel32 back to an earlier position
+        void JccBackward(Cond cc, size_t target) {
+            Byte(0x0F);
+            Byte(0x80 + cc);
+            Dword(target - (bytes.size() + 4));
+        }
+
+        // mov dst64, qword [rbx + disp]
+        void LoadQword(int dst, int32_t disp) {
+            Rex(true, dst, 0, RBX);
+            Byte(0x8B);
+            Mem(dst, disp);
+        }
+
+        // add dst64, imm8
+        void AddRI64(int dst, int8_t imm) {
+            Rex(true, 0, 0, dst);
+            Byte(0x83);
+            ModRM(3, ALU_ADD, dst);
+            Byte(imm);
+        }
+
+        // Point a forward jump at the current position
+        void Bind(size_t patch) {
+            uint32_t rel = bytes.size() - (patch + 4);
+            std::memcpy(&bytes[patch], &rel, 4);
+        }
+
+        // jmp dst64
+        void JmpR(int dst) {
+            Rex(false, 0, 0, dst);
+            Byte(0xFF);
+            ModRM(3, 4, dst);
+        }
+
+        // add/sub rsp, imm8
+        void AdjustRsp(int8_t imm) {
+            AddRI64(RSP, imm);
+        }
+
+        // mov dst64, src64
+        void MovRR64(int dst, int src) {
+            Rex(true, src, 0, dst);
+            Byte(0x89);
+            ModRM(3, src, dst);
+        }
+
+        void Ret() { Byte(0xC3); }
+
+    private:
+        void Shift(int ext, int dst, uint8_t imm) {
+            Rex(false, 0, 0, dst);
+            Byte(0xC1);
+            ModRM(3, ext, dst);
+            Byte(imm);
+        }
+};
+
+// Host registers we hand out to guest V registers
+const int ALLOCATABLE[] = { RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15, RBP };
+const int ALLOCATABLE_COUNT = sizeof(ALLOCATABLE) / sizeof(ALLOCATABLE[0]);
+
+// Every block saves the same registers, so a block can jump straight into the next one's body
+const int SAVED[] = { RBX, RBP, R12, R13, R14, R15 };
+const int SAVED_COUNT = sizeof(SAVED) / sizeof(SAVED[0]);
+
+} // namespace
+
+#endif
+
+JitX64::JitX64() {
+#ifdef CHIP8_JIT_SUPPORTED
+    void* buffer = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(buffer != MAP_FAILED) {
+        code = static_cast<uint8_t*>(buffer);
+        code_size = CODE_BUFFER_SIZE;
+    }
+#endif
+}
+
+JitX64::~JitX64() {
+#ifdef CHIP8_JIT_SUPPORTED
+    if(code) {
+        munmap(code, code_size);
+    }
+#endif
+}
+
+void JitX64::Flush() {
+    std::memset(entry, 0, sizeof(entry));
+    std::memset(body, 0, sizeof(body));
+    std::memset(length, 0, sizeof(length));
+    std::memset(block_end, 0, sizeof(block_end));
+    std::memset(heat, 0, sizeof(heat));
+    std::memset(covered, 0, sizeof(covered));
+    code_used = 0;
+}
+
+void JitX64::Invalidate(unsigned int first, unsigned int last) {
+    bool hit = false;
+    for(unsigned int i = first; i < last && !hit; i++) {
+        hit = covered[i] != 0;
+    }
+
+    if(!hit) { // Plain data write, nothing translated there
+        return;
+    }
+
+    for(unsigned int start = 0; start < MEMORY_SIZE; start++) {
+        if(entry[start] && start < last && block_end[start] > first) {
+            for(unsigned int i = start; i < block_end[start]; i++) {
+                covered[i]--;
+            }
+            entry[start] = nullptr;
+            body[start] = nullptr;
+            heat[start] = 0;
+        }
+    }
+}
+
+void JitX64::Helper(Chip8* chip8, void const* instruction) {
+    Chip8::Instruction const& op = *static_cast<Chip8::Instruction const*>(instruction);
+    ((*chip8).*(op.handler))(op);
+}
+
+uint64_t JitX64::Run(Chip8& chip8, uint64_t instructions) {
+    uint64_t start = chip8.instruction_count;
+    uint64_t end = start + instructions;
+    run_end = end; // Blocks check this before chaining into the next one
+
+    while(chip8.instruction_count < end) {
+        if(chip8.code_write_first < chip8.code_write_last) { // Memory got written, drop any block on top of it
+            Invalidate(chip8.code_write_first, chip8.code_write_last);
+            chip8.code_write_first = 0xFFFF;
+            chip8.code_write_last = 0;
+        }
+
+        uint16_t address = chip8.pc;
+
+        if(address < MEMORY_SIZE) {
+            BlockFunc block = entry[address];
+
+            if(!block && ++heat[address] >= HOT_THRESHOLD && Compile(chip8, address)) {
+                block = entry[address];
+            }
+
+            assert(!block || length[address] > 0); // An empty block would never move the PC
+            if(block && length[address] <= end - chip8.instruction_count) {
+                block(&chip8);
+                continue;
+            }
+        }
+
+        chip8.Interpret(1); // Cold code, or the block doesn't fit in what's left of the batch
+    }
+
+    return chip8.instruction_count - start;
+}
+
+#ifdef CHIP8_JIT_SUPPORTED
+
+bool JitX64::Compile(Chip8& chip8, uint16_t address) {
+    typedef Chip8::Chip8Func Chip8Func;
+
+    // Idle loops stay in the interpreter, its handlers skip them to the end of the batch instead of spinning
+    for(unsigned int back = 0; back < 3 && 2 * back <= address; back++) {
+        if(chip8.IdleLoopLength(address - 2 * back) > back) {
+            return false;
+        }
+    }
+
+    // Field offsets, so the generated code can address the Chip8 through rbx
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(&chip8);
+    const int32_t OFF_V = reinterpret_cast<const uint8_t*>(chip8.registers) - base;
+    const int32_t OFF_I = reinterpret_cast<const uint8_t*>(&chip8.index) - base;
+    const int32_t OFF_PC = reinterpret_cast<const uint8_t*>(&chip8.pc) - base;
+    const int32_t OFF_STACK = reinterpret_cast<const uint8_t*>(chip8.stack) - base;
+    const int32_t OFF_SP = reinterpret_cast<const uint8_t*>(&chip8.sp) - base;
+    const int32_t OFF_DT = reinterpret_cast<const uint8_t*>(&chip8.delay_timer) - base;
+    const int32_t OFF_ST = reinterpret_cast<const uint8_t*>(&chip8.sound_timer) - base;
+    const int32_t OFF_KEYPAD = reinterpret_cast<const uint8_t*>(&chip8.keypad) - base;
+    const int32_t OFF_COUNT = reinterpret_cast<const uint8_t*>(&chip8.instruction_count) - base;
+
+    /**
+     * Pass 1: find the block and the registers it touches
+     */
+
+    auto is_skip = [](Chip8Func h) {
+        return h == &Chip8::OP_3xkk || h == &Chip8::OP_4xkk || h == &Chip8::OP_5xy0
+            || h == &Chip8::OP_9xy0 || h == &Chip8::OP_Ex9E || h == &Chip8::OP_ExA1;
+    };
+
+    // Instructions that end a block because they change the PC, or write memory that might be code
+    auto ends_block = [&](Chip8Func h) {
+        return is_skip(h) || h == &Chip8::OP_1nnn || h == &Chip8::OP_2nnn || h == &Chip8::OP_00EE
+            || h == &Chip8::OP_Bnnn || h == &Chip8::OP_Fx0A || h == &Chip8::OP_Fx33 || h == &Chip8::OP_Fx55
+            || h == &Chip8::OP_00FD || h == &Chip8::OP_5xy2 || h == &Chip8::OP_F000;
+    };
+
+    // Handlers that leave the PC alone and never write memory: called in place, and the block carries on
+    auto in_place = [&](Chip8Func h) {
+        return h == &Chip8::OP_00E0 || h == &Chip8::OP_Cxkk || h == &Chip8::OP_Dxyn || h == &Chip8::OP_Fx65
+            || h == &Chip8::OP_00Cn || h == &Chip8::OP_00Dn || h == &Chip8::OP_00FB || h == &Chip8::OP_00FC
+            || h == &Chip8::OP_00FE || h == &Chip8::OP_00FF || h == &Chip8::OP_5xy3 || h == &Chip8::OP_Fn01
+            || h == &Chip8::OP_F002 || h == &Chip8::OP_Fx30 || h == &Chip8::OP_Fx3A || h == &Chip8::OP_Fx75
+            || h == &Chip8::OP_Fx85;
+    };
+
+    // A JP that closes an idle loop, which has to go through the interpreter's OP_1nnn so it skips the loop at the same point
+    auto idle_back_edge = [&](unsigned int at, uint16_t target) {
+        unsigned int loop = chip8.IdleLoopLength(target);
+        return loop && target + 2 * (loop - 1) == at;
+    };
+
+    std::vector<Chip8::Instruction> block;
+    unsigned int uses[16]{};
+    bool written[16]{};
+
+    for(unsigned int guest = address; block.size() < MAX_BLOCK_LENGTH && guest + 2 <= MEMORY_SIZE; guest += 2) {
+        Chip8::Instruction op = chip8.Decode(chip8.OpcodeAt(guest));
+        Chip8Func h = op.handler;
+
+        if(h == &Chip8::OP_1nnn && idle_back_edge(guest, op.nnn)) { // The block ends just before it
+            break;
+        }
+
+        block.push_back(op);
+
+        // Count register uses for natively translated instructions, helpers go through memory anyway
+        if(h == &Chip8::OP_6xkk || h == &Chip8::OP_7xkk || h == &Chip8::OP_Fx07) {
+            uses[op.x]++;
+            written[op.x] = true;
+        }
+        else if(h == &Chip8::OP_8xy0 || h == &Chip8::OP_8xy1 || h == &Chip8::OP_8xy2 || h == &Chip8::OP_8xy3) {
+            uses[op.x]++;
+            uses[op.y]++;
+            written[op.x] = true;
+        }
+        else if(h == &Chip8::OP_8xy4 || h == &Chip8::OP_8xy5 || h == &Chip8::OP_8xy6
+                || h == &Chip8::OP_8xy7 || h == &Chip8::OP_8xyE) {
+            uses[op.x]++;
+            uses[op.y]++;
+            uses[0xF]++;
+            written[op.x] = true;
+            written[0xF] = true;
+        }
+        else if(h == &Chip8::OP_3xkk || h == &Chip8::OP_4xkk || h == &Chip8::OP_Ex9E || h == &Chip8::OP_ExA1
+                || h == &Chip8::OP_Fx1E || h == &Chip8::OP_Fx29 || h == &Chip8::OP_Fx15 || h == &Chip8::OP_Fx18) {
+            uses[op.x]++;
+        }
+        else if(h == &Chip8::OP_5xy0 || h == &Chip8::OP_9xy0) {
+            uses[op.x]++;
+            uses[op.y]++;
+        }
+        else if(h == &Chip8::OP_Bnnn) {
+            uses[0]++;
+        }
+
+        if(is_skip(h) && guest + 4 > MEMORY_SIZE) { // Where it skips to depends on the word past the end of the code window
+            return false;
+        }
+        if(is_skip(h)) { // A skip over a JP is a two-way branch, pull the JP in
+            Chip8::Instruction jump = chip8.Decode(chip8.OpcodeAt(guest + 2));
+            if(jump.handler == &Chip8::OP_1nnn && !idle_back_edge(guest + 2, jump.nnn)) {
+                block.push_back(jump);
+            }
+        }
+
+        if(ends_block(h)) {
+            break;
+        }
+    }
+
+    if(block.empty()) { // The last (odd) address of the window has no whole opcode below MEMORY_SIZE, the interpreter wraps it
+        return false;
+    }
+
+    /**
+     * Pass 2: register allocation, the most used guest registers get host registers for the whole block
+     */
+
+    int host[16];
+    int allocated = 0;
+    for(int v = 0; v < 16; v++) {
+        host[v] = -1;
+    }
+
+    while(allocated < ALLOCATABLE_COUNT) {
+        int best = -1;
+        for(int v = 0; v < 16; v++) {
+            if(host[v] < 0 && uses[v] > 0 && (best < 0 || uses[v] > uses[best])) {
+                best = v;
+            }
+        }
+        if(best < 0) {
+            break;
+        }
+        host[best] = ALLOCATABLE[allocated++];
+    }
+
+    /**
+     * Pass 3: emit
+     */
+
+    Assembler a;
+
+    auto get = [&](int v, int scratch) { // Register holding Vx (loaded into scratch if it lives in memory)
+        if(host[v] >= 0) return host[v];
+        a.LoadByte(scratch, OFF_V + v);
+        return scratch;
+    };
+    auto load = [&](int v, int dst) { // Copy Vx into dst
+        if(host[v] >= 0) a.MovRR(dst, host[v]);
+        else a.LoadByte(dst, OFF_V + v);
+    };
+    auto put = [&](int v, int src) { // Vx = src (src already masked to 8 bits)
+        if(host[v] >= 0) a.MovRR(host[v], src);
+        else a.StoreByte(OFF_V + v, src);
+    };
+    auto reload = [&]() { // Pick up registers a helper may have changed
+        for(int v = 0; v < 16; v++) {
+            if(host[v] >= 0) a.LoadByte(host[v], OFF_V + v);
+        }
+    };
+    auto writeback = [&]() { // Spill registers we changed so memory is up to date
+        for(int v = 0; v < 16; v++) {
+            if(host[v] >= 0 && written[v]) a.StoreByte(OFF_V + v, host[v]);
+        }
+    };
+
+    // Back to Run(), or if nothing may have been written over and the next block is
+    // translated and fits in the batch, jump straight into its body
+    auto chain_or_return = [&](bool chain) {
+        std::vector<size_t> to_return;
+
+        if(chain) {
+            a.LoadWord(RAX, OFF_PC);
+            a.AluRI(ALU_CMP, RAX, MEMORY_SIZE);
+            to_return.push_back(a.JccForward(CC_AE));
+            a.MovRI64(RCX, reinterpret_cast<uint64_t>(body));
+            a.LoadQwordTable(RCX, RCX, RAX); // body[pc]
+            a.TestRR64(RCX, RCX);
+            to_return.push_back(a.JccForward(CC_E));
+            a.MovRI64(RDX, reinterpret_cast<uint64_t>(length));
+            a.LoadByteTable(RDX, RDX, RAX); // length[pc]
+            a.AddRM64(RDX, OFF_COUNT);
+            a.MovRI64(RAX, reinterpret_cast<uint64_t>(&run_end));
+            a.CmpRM64(RDX, RAX);
+            to_return.push_back(a.JccForward(CC_A)); // count + length[pc] > run_end
+            a.JmpR(RCX);
+        }
+
+        for(size_t patch : to_return) a.Bind(patch);
+        a.AdjustRsp(8);
+        for(int i = SAVED_COUNT; i-- > 0;) a.Pop(SAVED[i]);
+        a.Ret();
+    };
+
+    // Prologue: rdi is the Chip8, it lives in rbx for the whole block
+    for(int reg : SAVED) a.Push(reg);
+    a.AdjustRsp(-8); // Six pushes plus the return address, realign to 16 for helper calls
+    a.MovRR64(RBX, RDI);
+    size_t body_offset = a.bytes.size(); // Chained blocks enter here, with the frame already set up
+    reload();
+    size_t loop_top = a.bytes.size(); // Jumps back to our own start land here, registers already loaded
+
+    // Leave towards a known address after running `executed` instructions
+    auto exit_to = [&](uint16_t target, unsigned int executed) {
+        a.AddMem64(OFF_COUNT, executed);
+
+        if(target == address) { // A loop: go around again with the registers where they are, if the batch allows
+            a.LoadQword(RAX, OFF_COUNT);
+            a.AddRI64(RAX, block.size());
+            a.MovRI64(RDX, reinterpret_cast<uint64_t>(&run_end));
+            a.CmpRM64(RAX, RDX);
+            a.JccBackward(CC_BE, loop_top);
+        }
+
+        a.StoreWordImm(OFF_PC, target);
+        writeback();
+        chain_or_return(true);
+    };
+
+    // Leave towards the address already stored in the PC
+    auto exit_stored = [&](unsigned int executed) {
+        a.AddMem64(OFF_COUNT, executed);
+        writeback();
+        chain_or_return(true);
+    };
+
+    // Run one instruction through the interpreter's handler
+    auto call = [&](unsigned int guest, Chip8::Instruction const& op) {
+        ops[guest] = op;
+        writeback();
+        a.CallHelper(&JitX64::Helper, &ops[guest]);
+        reload();
+    };
+
+    bool exited = false;
+
+    for(size_t i = 0; i < block.size() && !exited; i++) {
+        Chip8::Instruction const& op = block[i];
+        Chip8Func h = op.handler;
+        unsigned int guest = address + 2 * i; // Where this instruction lives
+        uint16_t next = guest + 2; // The PC after this instruction
+
+        if(h == &Chip8::OP_NULL) {
+            // Nothing to do
+        }
+        else if(h == &Chip8::OP_6xkk) {
+            if(host[op.x] >= 0) a.MovRI(host[op.x], op.kk);
+            else { a.MovRI(RAX, op.kk); put(op.x, RAX); }
+        }
+        else if(h == &Chip8::OP_7xkk) {
+            load(op.x, RAX);
+            a.AluRI(ALU_ADD, RAX, op.kk);
+            a.AluRI(ALU_AND, RAX, 0xFF);
+            put(op.x, RAX);
+        }
+        else if(h == &Chip8::OP_8xy0) {
+            put(op.x, get(op.y, RAX));
+        }
+        else if(h == &Chip8::OP_8xy1 || h == &Chip8::OP_8xy2 || h == &Chip8::OP_8xy3) {
+            Alu alu = h == &Chip8::OP_8xy1 ? ALU_OR : h == &Chip8::OP_8xy2 ? ALU_AND : ALU_XOR;
+            load(op.x, RAX);
+            a.AluRR(alu, RAX, get(op.y, RCX));
+            put(op.x, RAX);
+        }
+        else if(h == &Chip8::OP_8xy4) { // VF = carry, then Vx = sum (the sum is taken before VF changes)
+            load(op.x, RAX);
+            a.AluRR(ALU_ADD, RAX, get(op.y, RCX));
+            a.MovRR(RDX, RAX);
+            a.ShrRI(RDX, 8);
+            put(0xF, RDX);
+            a.AluRI(ALU_AND, RAX, 0xFF);
+            put(op.x, RAX);
+        }
+        else if(h == &Chip8::OP_8xy5 || h == &Chip8::OP_8xy7) { // VF first, then the subtraction sees the new VF
+            bool reverse = h == &Chip8::OP_8xy7;
+            load(reverse ? op.y : op.x, RAX);
+            a.AluRR(ALU_CMP, RAX, get(reverse ? op.x : op.y, RCX));
+            a.SetccRR(CC_A, RDX);
+            put(0xF, RDX);
+            load(reverse ? op.y : op.x, RAX);
+            a.AluRR(ALU_SUB, RAX, get(reverse ? op.x : op.y, RCX));
+            a.AluRI(ALU_AND, RAX, 0xFF);
+            put(op.x, RAX);
+        }
+        else if(h == &Chip8::OP_8xy6) {
+            load(op.x, RAX);
+            a.AluRI(ALU_AND, RAX, 1);
+            put(0xF, RAX);
+            load(op.x, RAX);
+            a.ShrRI(RAX, 1);
+            put(op.x, RAX);
+        }
+        else if(h == &Chip8::OP_8xyE) {
+            load(op.x, RAX);
+            a.ShrRI(RAX, 7);
+            put(0xF, RAX);
+            load(op.x, RAX);
+            a.ShlRI(RAX, 1);
+            a.AluRI(ALU_AND, RAX, 0xFF);
+            put(op.x, RAX);
+        }
+        else if(h == &Chip8::OP_Annn) {
+            a.StoreWordImm(OFF_I, op.nnn);
+        }
+        else if(h == &Chip8::OP_Fx1E) {
+            a.LoadWord(RAX, OFF_I);
+            a.AluRR(ALU_ADD, RAX, get(op.x, RCX));
+            a.StoreWord(OFF_I, RAX);
+        }
+        else if(h == &Chip8::OP_Fx29) {
+            a.ImulRRI(RAX, get(op.x, RAX), 5);
+            a.AluRI(ALU_ADD, RAX, 0x50);
+            a.StoreWord(OFF_I, RAX);
+        }
+        else if(h == &Chip8::OP_Fx07) {
+            a.LoadByte(RAX, OFF_DT);
+            put(op.x, RAX);
+        }
+        else if(h == &Chip8::OP_Fx15 || h == &Chip8::OP_Fx18) {
+            a.StoreByte(h == &Chip8::OP_Fx15 ? OFF_DT : OFF_ST, get(op.x, RAX));
+        }
+        else if(in_place(h)) {
+            call(guest, op);
+        }
+        else if(h == &Chip8::OP_1nnn) {
+            exit_to(op.nnn, i + 1);
+            exited = true;
+        }
+        else if(h == &Chip8::OP_2nnn) {
+            a.LoadByte(RCX, OFF_SP);
+            a.AluRI(ALU_AND, RCX, STACK_LEVELS - 1);
+            a.StoreWordImmIndexed(OFF_STACK, RCX, next); // stack[sp & 15] = return address
+            a.LoadByte(RAX, OFF_SP);
+            a.AluRI(ALU_ADD, RAX, 1);
+            a.StoreByte(OFF_SP, RAX);
+            exit_to(op.nnn, i + 1);
+            exited = true;
+        }
+        else if(h == &Chip8::OP_00EE) {
+            a.LoadByte(RAX, OFF_SP);
+            a.AluRI(ALU_SUB, RAX, 1);
+            a.AluRI(ALU_AND, RAX, 0xFF); // sp is 8 bits wide
+            a.StoreByte(OFF_SP, RAX);
+            a.AluRI(ALU_AND, RAX, STACK_LEVELS - 1);
+            a.LoadWordIndexed(RCX, OFF_STACK, RAX); // pc = stack[sp & 15]
+            a.StoreWord(OFF_PC, RCX);
+            exit_stored(i + 1);
+            exited = true;
+        }
+        else if(h == &Chip8::OP_Bnnn) {
+            load(0, RAX);
+            a.AluRI(ALU_ADD, RAX, op.nnn);
+            a.StoreWord(OFF_PC, RAX);
+            exit_stored(i + 1);
+            exited = true;
+        }
+        else if(is_skip(h)) {
+            Cond skip;
+
+            if(h == &Chip8::OP_3xkk || h == &Chip8::OP_4xkk) {
+                a.AluRI(ALU_CMP, get(op.x, RAX), op.kk);
+                skip = h == &Chip8::OP_3xkk ? CC_E : CC_NE;
+            }
+            else if(h == &Chip8::OP_5xy0 || h == &Chip8::OP_9xy0) {
+                int vx = get(op.x, RAX);
+                a.AluRR(ALU_CMP, vx, get(op.y, RCX));
+                skip = h == &Chip8::OP_5xy0 ? CC_E : CC_NE;
+            }
+            else {
+                load(op.x, RAX);
+                a.MovRI(RDX, KEY_COUNT);
+                a.AluRI(ALU_CMP, RAX, KEY_COUNT);
+                a.CmovRR(CC_AE, RAX, RDX); // Keys past F test bit 16, which is always clear
+                a.LoadWord(RCX, OFF_KEYPAD);
+                a.BtRR(RCX, RAX); // CF = key Vx is down
+                skip = h == &Chip8::OP_Ex9E ? CC_B : CC_AE;
+            }
+
+            size_t skipped = a.JccForward(skip);
+
+            if(i + 1 < block.size()) { // Not skipped: the JP we pulled in runs too
+                exit_to(block[i + 1].nnn, i + 2);
+            }
+            else {
+                exit_to(next, i + 1);
+            }
+
+            a.Bind(skipped);
+            exit_to(chip8.OpcodeAt(next) == 0xF000 ? next + 4 : next + 2, i + 1); // Skipping F000 skips its address word too
+            exited = true;
+        }
+        else { // Fx0A, Fx33, Fx55, 00FD, 5xy2, F000: the helper may move the PC or rewrite code, so it ends the block
+            a.StoreWordImm(OFF_PC, next);
+            a.AddMem64(OFF_COUNT, i + 1); // Counted first, like the interpreter does, so LD Vx, K skips to the right place
+            ops[guest] = op;
+            writeback();
+            a.CallHelper(&JitX64::Helper, &ops[guest]);
+            chain_or_return(false); // Back to Run(), it has to look for code we wrote over
+            exited = true;
+        }
+    }
+
+    if(!exited) { // Ran into the block length limit (or the end of memory)
+        exit_to(address + 2 * block.size(), block.size());
+    }
+
+    /**
+     * Install the block
+     */
+
+    if(code_used + a.bytes.size() > code_size) { // Out of space, start over
+        Flush();
+    }
+
+    uint8_t* native = code + code_used;
+    std::memcpy(native, a.bytes.data(), a.bytes.size());
+    code_used += (a.bytes.size() + 15) & ~size_t(15);
+
+    unsigned int end = address + 2 * block.size();
+    if(!block.empty() && is_skip(block.back().handler)) { // The skip's target depends on whether the next word is F000
+        end += 2;
+    }
+    entry[address] = reinterpret_cast<BlockFunc>(native);
+    body[address] = native + body_offset;
+    length[address] = block.size();
+    block_end[address] = end;
+    heat[address] = 0;
+    for(unsigned int i = address; i < end; i++) {
+        covered[i]++;
+    }
+
+    return true;
+}
+
+#else
+
+bool JitX64::Compile(Chip8&, uint16_t) {
+    return false; // Not x86-64, everything stays in the interpreter
+}
+
+#endif
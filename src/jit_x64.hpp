@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * x86-64 dynamic recompiler
+ * Hot basic blocks (ending at 1nnn, 2nnn, 00EE, Bnnn, a skip, or an instruction that
+ * writes memory) are translated into native code. Inside a block the guest V registers
+ * live in host registers; anything complicated (Dxyn, Cxkk, Fx65...) calls straight
+ * into the interpreter's handler, so both engines share the same opcode semantics.
+ * Cold code, and blocks that don't fit in what's left of a Run() batch, are interpreted.
+ */
+class JitX64 {
+    public:
+        JitX64();
+        ~JitX64();
+        JitX64(JitX64 const&) = delete;
+        JitX64& operator=(JitX64 const&) = delete;
+
+        bool Available() const { return code != nullptr; } // False if we couldn't get executable memory (or aren't on x86-64)
+        uint64_t Run(Chip8& chip8, uint64_t instructions); // Same contract as Chip8::Run()
+        void Flush(); // Throw away every translated block
+
+    private:
+        typedef void (*BlockFunc)(Chip8*);
+
+        static const unsigned int HOT_THRESHOLD = 8; // Visits before a block start gets translated
+        static const unsigned int MAX_BLOCK_LENGTH = 64; // Guest instructions per block
+
+        uint8_t* code{}; // Executable code buffer
+        size_t code_size{}; // Size of the code buffer
+        size_t code_used{}; // Bytes of the code buffer handed out so far
+
+        BlockFunc entry[4096]{}; // Native entry point for a block starting at each address
+        uint8_t* body[4096]{}; // Entry point past the prologue, for blocks chaining into each other
+        uint8_t length[4096]{}; // Guest instructions in that block
+        uint16_t block_end[4096]{}; // One past the last guest byte of that block
+        uint16_t heat[4096]{}; // Visits to each address while it wasn't translated
+        uint8_t covered[4096]{}; // How many blocks cover each guest byte
+        Chip8::Instruction ops[4096]{}; // Decoded instructions the blocks hand to Helper()
+        uint64_t run_end{}; // Instruction count the current Run() stops at
+
+        bool Compile(Chip8& chip8, uint16_t address); // Translate the block starting at address
+        void Invalidate(unsigned int first, unsigned int last); // Drop blocks covering [first, last)
+
+        static void Helper(Chip8* chip8, void const* instruction); // Run one decoded instruction through the interpreter's handler
+};
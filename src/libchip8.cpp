@@ -0,0 +1,91 @@
+#include <libchip8.h>
+#include <chip_8.hpp>
+#include <new>
+#include <vector>
+
+struct chip8 {
+    explicit chip8(uint32_t seed) : machine(seed) {
+    }
+
+    Chip8 machine;
+    std::vector<uint8_t> rom; // Kept to reload on reset
+};
+
+int chip8_api_version(void) {
+    return CHIP8_API_VERSION;
+}
+
+chip8_t* chip8_create(uint32_t seed) {
+    return new(std::nothrow) chip8(seed);
+}
+
+void chip8_destroy(chip8_t* chip8) {
+    delete chip8;
+}
+
+void chip8_reset(chip8_t* chip8, uint32_t seed) {
+    chip8->machine.Reset(seed);
+    chip8->machine.LoadROM(chip8->rom.data(), chip8->rom.size()); // Rewrites only what the game changed
+}
+
+int chip8_load_rom(chip8_t* chip8, uint8_t const* data, size_t size) {
+    if(size == 0 || !chip8->machine.LoadROM(data, size)) {
+        return -1;
+    }
+
+    chip8->rom.assign(data, data + size);
+    return 0;
+}
+
+int chip8_set_engine(chip8_t* chip8, enum chip8_engine engine) {
+    switch(engine) {
+        case CHIP8_ENGINE_INTERPRETER: return chip8->machine.SetEngine(Engine::Interpreter) ? 0 : -1;
+        case CHIP8_ENGINE_JIT: return chip8->machine.SetEngine(Engine::Jit) ? 0 : -1;
+        case CHIP8_ENGINE_AOT: return chip8->machine.SetEngine(Engine::Aot) ? 0 : -1;
+    }
+    return -1;
+}
+
+uint64_t chip8_run_for(chip8_t* chip8, uint64_t instructions) {
+    return chip8->machine.Run(instructions);
+}
+
+uint64_t chip8_run_frames(chip8_t* chip8, uint64_t frames, uint32_t instructions_per_frame) {
+    return chip8->machine.RunFrames(frames, instructions_per_frame);
+}
+
+uint64_t const* chip8_framebuffer(chip8_t const* chip8) {
+    return chip8->machine.video.planes[0];
+}
+
+int chip8_hires(chip8_t const* chip8) {
+    return chip8->machine.video.hires;
+}
+
+uint64_t const* chip8_plane(chip8_t const* chip8, unsigned int plane) {
+    return plane < VIDEO_PLANES ? chip8->machine.video.planes[plane] : nullptr;
+}
+
+uint16_t* chip8_keypad(chip8_t* chip8) {
+    return chip8->machine.KeypadData();
+}
+
+int chip8_sound_active(chip8_t const* chip8) {
+    return chip8->machine.SoundActive();
+}
+
+uint64_t chip8_instruction_count(chip8_t const* chip8) {
+    return chip8->machine.InstructionCount();
+}
+
+size_t chip8_state_size(void) {
+    return STATE_SIZE;
+}
+
+size_t chip8_save_state(chip8_t const* chip8, uint8_t* state) {
+    return chip8->machine.SaveState(state);
+}
+
+int chip8_load_state(chip8_t* chip8, uint8_t const* state, size_t size) {
+    return chip8->machine.LoadState(state, size) ? 0 : -1;
+}
@@ -0,0 +1,67 @@
+#ifndef LIBCHIP8_H
+#define LIBCHIP8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * libchip8
+ * The emulator core behind a plain C ABI, for embedding in other programs (no SDL, no C++ at the
+ * boundary). A chip8_t is one machine. Run it in batches with chip8_run_for() or chip8_run_frames(),
+ * then read the display and write the keypad in place between batches: both pointers stay valid
+ * for the machine's lifetime. Functions returning int give 0 on success, -1 on failure.
+ */
+
+#if defined(__GNUC__)
+#define CHIP8_API __attribute__((visibility("default"))) /* The shared library exports nothing else */
+#else
+#define CHIP8_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8_API_VERSION 2 /* Bumped whenever a signature or the meaning of a call changes */
+
+#define CHIP8_VIDEO_WIDTH 64
+#define CHIP8_VIDEO_HEIGHT 32
+#define CHIP8_HIRES_WIDTH 128 /* SUPER-CHIP/XO-CHIP high resolution */
+#define CHIP8_HIRES_HEIGHT 64
+
+typedef struct chip8 chip8_t;
+
+enum chip8_engine {
+    CHIP8_ENGINE_INTERPRETER = 0,
+    CHIP8_ENGINE_JIT = 1, /* x86-64 only */
+    CHIP8_ENGINE_AOT = 2 /* Only for ROMs compiled into the program */
+};
+
+CHIP8_API int chip8_api_version(void); /* CHIP8_API_VERSION of the library actually loaded */
+
+CHIP8_API chip8_t* chip8_create(uint32_t seed); /* Power-on state, RNG seeded with seed. NULL if out of memory */
+CHIP8_API void chip8_destroy(chip8_t* chip8);
+CHIP8_API void chip8_reset(chip8_t* chip8, uint32_t seed); /* Back to power-on with a new seed, the loaded ROM stays loaded */
+
+CHIP8_API int chip8_load_rom(chip8_t* chip8, uint8_t const* data, size_t size); /* Copied, fails if empty or bigger than 65024 bytes (XO-CHIP) */
+CHIP8_API int chip8_set_engine(chip8_t* chip8, enum chip8_engine engine); /* Fails (and stays on the interpreter) if unavailable */
+
+CHIP8_API uint64_t chip8_run_for(chip8_t* chip8, uint64_t instructions); /* Returns the instructions executed */
+CHIP8_API uint64_t chip8_run_frames(chip8_t* chip8, uint64_t frames, uint32_t instructions_per_frame); /* Each frame ticks the 60 Hz timers once */
+
+CHIP8_API uint64_t const* chip8_framebuffer(chip8_t const* chip8); /* Plane 0: CHIP8_VIDEO_HEIGHT rows, pixel x of a row is bit 63 - x (in hires, see below) */
+CHIP8_API int chip8_hires(chip8_t const* chip8); /* Non-zero in 128x64 mode: then each plane is CHIP8_HIRES_HEIGHT rows of two words, left half first */
+CHIP8_API uint64_t const* chip8_plane(chip8_t const* chip8, unsigned int plane); /* Plane 0 or 1 (XO-CHIP), laid out like chip8_framebuffer(), NULL past 1 */
+CHIP8_API uint16_t* chip8_keypad(chip8_t* chip8); /* Keys held down, bit k = key k */
+CHIP8_API int chip8_sound_active(chip8_t const* chip8); /* Non-zero while the beeper should sound */
+CHIP8_API uint64_t chip8_instruction_count(chip8_t const* chip8); /* Since power-on */
+
+CHIP8_API size_t chip8_state_size(void); /* The biggest state: room for an XO-CHIP machine's 64 KB of RAM */
+CHIP8_API size_t chip8_save_state(chip8_t const* chip8, uint8_t* state); /* Writes at most chip8_state_size() bytes, returns how many (a classic ROM's state is about 4 KB) */
+CHIP8_API int chip8_load_state(chip8_t* chip8, uint8_t const* state, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
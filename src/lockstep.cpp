@@ -0,0 +1,370 @@
+#include <lockstep.hpp>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CHIP8_LOCKSTEP_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * Lane primitives
+ * One Ops per ISA, each followed by the shared engine compiled for that ISA.
+ */
+
+// Plain loops, works everywhere
+namespace scalar {
+    struct Ops {
+        struct V8 { uint8_t b[32]; };
+        struct V16 { uint16_t w[32]; };
+
+        static V8 Load8(uint8_t const* p) { V8 v; memcpy(v.b, p, 32); return v; }
+        static V8 Set8(uint8_t value) { V8 v; memset(v.b, value, 32); return v; }
+        static void Store8(uint8_t* p, V8 const& v, uint32_t mask) { for(int i = 0; i < 32; i++) if((mask >> i) & 1u) p[i] = v.b[i]; }
+        static V8 Add8(V8 a, V8 const& b) { for(int i = 0; i < 32; i++) a.b[i] += b.b[i]; return a; }
+        static V8 Sub8(V8 a, V8 const& b) { for(int i = 0; i < 32; i++) a.b[i] -= b.b[i]; return a; }
+        static V8 SubSat8(V8 a, V8 const& b) { for(int i = 0; i < 32; i++) a.b[i] = a.b[i] > b.b[i] ? a.b[i] - b.b[i] : 0; return a; }
+        static V8 And8(V8 a, V8 const& b) { for(int i = 0; i < 32; i++) a.b[i] &= b.b[i]; return a; }
+        static V8 Or8(V8 a, V8 const& b) { for(int i = 0; i < 32; i++) a.b[i] |= b.b[i]; return a; }
+        static V8 Xor8(V8 a, V8 const& b) { for(int i = 0; i < 32; i++) a.b[i] ^= b.b[i]; return a; }
+        static V8 Shr1_8(V8 a) { for(int i = 0; i < 32; i++) a.b[i] >>= 1; return a; }
+        static V8 Shl1_8(V8 a) { for(int i = 0; i < 32; i++) a.b[i] <<= 1; return a; }
+        static V8 Bit0_8(V8 a) { for(int i = 0; i < 32; i++) a.b[i] &= 1u; return a; }
+        static V8 Bit7_8(V8 a) { for(int i = 0; i < 32; i++) a.b[i] >>= 7; return a; }
+        static V8 Ones8(uint32_t mask) { V8 v; for(int i = 0; i < 32; i++) v.b[i] = (mask >> i) & 1u; return v; }
+        static uint32_t Eq8(V8 const& a, V8 const& b) { uint32_t m = 0; for(int i = 0; i < 32; i++) m |= uint32_t(a.b[i] == b.b[i]) << i; return m; }
+        static uint32_t Gt8(V8 const& a, V8 const& b) { uint32_t m = 0; for(int i = 0; i < 32; i++) m |= uint32_t(a.b[i] > b.b[i]) << i; return m; }
+
+        static V16 Load16(uint16_t const* p) { V16 v; memcpy(v.w, p, 64); return v; }
+        static V16 Set16(uint16_t value) { V16 v; for(int i = 0; i < 32; i++) v.w[i] = value; return v; }
+        static void Store16(uint16_t* p, V16 const& v, uint32_t mask) { for(int i = 0; i < 32; i++) if((mask >> i) & 1u) p[i] = v.w[i]; }
+        static V16 Select16(uint32_t mask, V16 a, V16 const& b) { for(int i = 0; i < 32; i++) if(!((mask >> i) & 1u)) a.w[i] = b.w[i]; return a; }
+        static V16 Add16(V16 a, V16 const& b) { for(int i = 0; i < 32; i++) a.w[i] += b.w[i]; return a; }
+        static V16 Sub16(V16 a, V16 const& b) { for(int i = 0; i < 32; i++) a.w[i] -= b.w[i]; return a; }
+        static V16 Mul5_16(V16 a) { for(int i = 0; i < 32; i++) a.w[i] *= 5; return a; }
+        static V16 Widen8(V8 const& a) { V16 v; for(int i = 0; i < 32; i++) v.w[i] = a.b[i]; return v; }
+        static uint32_t Eq16(V16 const& a, V16 const& b) { uint32_t m = 0; for(int i = 0; i < 32; i++) m |= uint32_t(a.w[i] == b.w[i]) << i; return m; }
+        static uint16_t Min16(V16 const& a) { return *std::min_element(a.w, a.w + 32); }
+    };
+
+    #include <lockstep_engine.inl>
+}
+
+#ifdef CHIP8_LOCKSTEP_X86
+
+// AVX2: bytes in one 256-bit register, words in two. Masked stores are blends.
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+    struct Ops {
+        typedef __m256i V8;
+        struct V16 { __m256i lo, hi; };
+
+        static __m256i ByteMask(uint32_t mask) { // Lane bit n -> 0xFF in byte n
+            __m256i spread = _mm256_shuffle_epi8(_mm256_set1_epi32(mask), _mm256_setr_epi64x(0, 0x0101010101010101, 0x0202020202020202, 0x0303030303030303));
+            __m256i bits = _mm256_set1_epi64x(0x8040201008040201);
+            return _mm256_cmpeq_epi8(_mm256_and_si256(spread, bits), bits);
+        }
+        static __m256i WordMask(uint16_t mask) { // Lane bit n -> 0xFFFF in word n
+            __m256i bits = _mm256_setr_epi16(1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, -32768);
+            return _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16(mask), bits), bits);
+        }
+
+        static V8 Load8(uint8_t const* p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p)); }
+        static V8 Set8(uint8_t value) { return _mm256_set1_epi8(value); }
+        static void Store8(uint8_t* p, V8 v, uint32_t mask) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_blendv_epi8(Load8(p), v, ByteMask(mask))); }
+        static V8 Add8(V8 a, V8 b) { return _mm256_add_epi8(a, b); }
+        static V8 Sub8(V8 a, V8 b) { return _mm256_sub_epi8(a, b); }
+        static V8 SubSat8(V8 a, V8 b) { return _mm256_subs_epu8(a, b); }
+        static V8 And8(V8 a, V8 b) { return _mm256_and_si256(a, b); }
+        static V8 Or8(V8 a, V8 b) { return _mm256_or_si256(a, b); }
+        static V8 Xor8(V8 a, V8 b) { return _mm256_xor_si256(a, b); }
+        static V8 Shr1_8(V8 a) { return _mm256_and_si256(_mm256_srli_epi16(a, 1), _mm256_set1_epi8(0x7F)); } // No byte shifts, shift words and drop the bit from the neighbour
+        static V8 Shl1_8(V8 a) { return _mm256_add_epi8(a, a); }
+        static V8 Bit0_8(V8 a) { return _mm256_and_si256(a, _mm256_set1_epi8(1)); }
+        static V8 Bit7_8(V8 a) { return _mm256_and_si256(_mm256_srli_epi16(a, 7), _mm256_set1_epi8(1)); }
+        static V8 Ones8(uint32_t mask) { return _mm256_and_si256(ByteMask(mask), _mm256_set1_epi8(1)); }
+        static uint32_t Eq8(V8 a, V8 b) { return _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)); }
+        static uint32_t Gt8(V8 a, V8 b) { return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b))); } // a > b unless max(a, b) == b
+
+        static V16 Load16(uint16_t const* p) { return { _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p)), _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p + 16)) }; }
+        static V16 Set16(uint16_t value) { return { _mm256_set1_epi16(value), _mm256_set1_epi16(value) }; }
+        static void Store16(uint16_t* p, V16 v, uint32_t mask) {
+            V16 old = Load16(p);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_blendv_epi8(old.lo, v.lo, WordMask(mask)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + 16), _mm256_blendv_epi8(old.hi, v.hi, WordMask(mask >> 16)));
+        }
+        static V16 Select16(uint32_t mask, V16 a, V16 b) { return { _mm256_blendv_epi8(b.lo, a.lo, WordMask(mask)), _mm256_blendv_epi8(b.hi, a.hi, WordMask(mask >> 16)) }; }
+        static V16 Add16(V16 a, V16 b) { return { _mm256_add_epi16(a.lo, b.lo), _mm256_add_epi16(a.hi, b.hi) }; }
+        static V16 Sub16(V16 a, V16 b) { return { _mm256_sub_epi16(a.lo, b.lo), _mm256_sub_epi16(a.hi, b.hi) }; }
+        static V16 Mul5_16(V16 a) { return { _mm256_add_epi16(_mm256_slli_epi16(a.lo, 2), a.lo), _mm256_add_epi16(_mm256_slli_epi16(a.hi, 2), a.hi) }; }
+        static V16 Widen8(V8 a) { return { _mm256_cvtepu8_epi16(_mm256_castsi256_si128(a)), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(a, 1)) }; }
+        static uint32_t Eq16(V16 a, V16 b) {
+            // Pack the two word compares down to bytes (packs interleaves the 128-bit halves, the permute undoes that)
+            __m256i bytes = _mm256_packs_epi16(_mm256_cmpeq_epi16(a.lo, b.lo), _mm256_cmpeq_epi16(a.hi, b.hi));
+            return _mm256_movemask_epi8(_mm256_permute4x64_epi64(bytes, 0xD8));
+        }
+        static uint16_t Min16(V16 a) {
+            __m256i m = _mm256_min_epu16(a.lo, a.hi);
+            __m128i half = _mm_min_epu16(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+            return _mm_cvtsi128_si32(_mm_minpos_epu16(half)) & 0xFFFFu;
+        }
+    };
+
+    #include <lockstep_engine.inl>
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+// AVX-512: same byte layout, but masked stores and compares go straight through mask registers
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f,avx512bw,avx512vl"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw,avx512vl")
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized" // GCC's own 512 -> 256 bit extract intrinsics trip this
+#endif
+
+namespace avx512 {
+    struct Ops {
+        typedef __m256i V8;
+        typedef __m512i V16;
+
+        static V8 Load8(uint8_t const* p) { return _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p)); }
+        static V8 Set8(uint8_t value) { return _mm256_set1_epi8(value); }
+        static void Store8(uint8_t* p, V8 v, uint32_t mask) { _mm256_mask_storeu_epi8(p, mask, v); }
+        static V8 Add8(V8 a, V8 b) { return _mm256_add_epi8(a, b); }
+        static V8 Sub8(V8 a, V8 b) { return _mm256_sub_epi8(a, b); }
+        static V8 SubSat8(V8 a, V8 b) { return _mm256_subs_epu8(a, b); }
+        static V8 And8(V8 a, V8 b) { return _mm256_and_si256(a, b); }
+        static V8 Or8(V8 a, V8 b) { return _mm256_or_si256(a, b); }
+        static V8 Xor8(V8 a, V8 b) { return _mm256_xor_si256(a, b); }
+        static V8 Shr1_8(V8 a) { return _mm256_and_si256(_mm256_srli_epi16(a, 1), _mm256_set1_epi8(0x7F)); }
+        static V8 Shl1_8(V8 a) { return _mm256_add_epi8(a, a); }
+        static V8 Bit0_8(V8 a) { return _mm256_and_si256(a, _mm256_set1_epi8(1)); }
+        static V8 Bit7_8(V8 a) { return _mm256_and_si256(_mm256_srli_epi16(a, 7), _mm256_set1_epi8(1)); }
+        static V8 Ones8(uint32_t mask) { return _mm256_maskz_mov_epi8(mask, _mm256_set1_epi8(1)); }
+        static uint32_t Eq8(V8 a, V8 b) { return _mm256_cmpeq_epu8_mask(a, b); }
+        static uint32_t Gt8(V8 a, V8 b) { return _mm256_cmpgt_epu8_mask(a, b); }
+
+        static V16 Load16(uint16_t const* p) { return _mm512_loadu_si512(p); }
+        static V16 Set16(uint16_t value) { return _mm512_set1_epi16(value); }
+        static void Store16(uint16_t* p, V16 v, uint32_t mask) { _mm512_mask_storeu_epi16(p, mask, v); }
+        static V16 Select16(uint32_t mask, V16 a, V16 b) { return _mm512_mask_blend_epi16(mask, b, a); }
+        static V16 Add16(V16 a, V16 b) { return _mm512_add_epi16(a, b); }
+        static V16 Sub16(V16 a, V16 b) { return _mm512_sub_epi16(a, b); }
+        static V16 Mul5_16(V16 a) { return _mm512_add_epi16(_mm512_slli_epi16(a, 2), a); }
+        static V16 Widen8(V8 a) { return _mm512_cvtepu8_epi16(a); }
+        static uint32_t Eq16(V16 a, V16 b) { return _mm512_cmpeq_epu16_mask(a, b); }
+        static uint16_t Min16(V16 a) {
+            __m256i m = _mm256_min_epu16(_mm512_castsi512_si256(a), _mm512_extracti64x4_epi64(a, 1));
+            __m128i half = _mm_min_epu16(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1));
+            return _mm_cvtsi128_si32(_mm_minpos_epu16(half)) & 0xFFFFu;
+        }
+    };
+
+    #include <lockstep_engine.inl>
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif // CHIP8_LOCKSTEP_X86
+
+/**
+ * Lockstep
+ */
+
+Lockstep::Lockstep(uint8_t const* rom, size_t size, size_t count, unsigned int seed)
+: count(count), loaded(size > 0 && size <= MAX_ROM_SIZE), groups((count + LANES - 1) / LANES), slot(count) {
+    // Let a real Chip8 lay out memory so every lane starts from exactly the same image
+    Chip8 image(seed);
+    if(loaded) {
+        image.LoadROM(rom, size);
+    }
+
+    for(LockstepGroup& g : groups) { // The vector value-initializes them, so everything else starts out zero
+        for(unsigned int lane = 0; lane < LANES; lane++) {
+            g.pc[lane] = 0x200;
+            for(unsigned int address = 0; address < MEMORY_SIZE; address++) {
+                g.memory[lane][address] = image.ReadMemory(address);
+            }
+        }
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        slot[i] = i;
+        groups[i / LANES].live |= loaded ? 1u << (i % LANES) : 0u; // A ROM we can't hold leaves every lane idle
+        groups[i / LANES].rng[i % LANES].seed(seed + i);
+    }
+
+    SetIsa(BestIsa());
+}
+
+Lockstep::Isa Lockstep::BestIsa() {
+#ifdef CHIP8_LOCKSTEP_X86
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) {
+        return Isa::Avx512;
+    }
+    if(__builtin_cpu_supports("avx2")) {
+        return Isa::Avx2;
+    }
+#endif
+    return Isa::Scalar;
+}
+
+bool Lockstep::SetIsa(Isa isa) {
+    if(isa > BestIsa()) {
+        return false;
+    }
+
+    this->isa = isa;
+
+    switch(isa) {
+#ifdef CHIP8_LOCKSTEP_X86
+        case Isa::Avx512: run_group = &avx512::Run; break;
+        case Isa::Avx2: run_group = &avx2::Run; break;
+#endif
+        default: run_group = &scalar::Run; break;
+    }
+
+    return true;
+}
+
+void Lockstep::SetKeys(size_t instance, uint16_t keys) {
+    GroupOf(instance).keys[LaneOf(instance)] = keys;
+}
+
+void Lockstep::Run(uint64_t instructions) {
+    uint64_t before = stats.lane_steps;
+    uint64_t steps_before = stats.steps;
+
+    while(instructions > 0) {
+        uint16_t batch = static_cast<uint16_t>(std::min<uint64_t>(instructions, 0xFFFF)); // Budgets are counted in 16-bit lanes
+        instructions -= batch;
+
+        for(LockstepGroup& g : groups) {
+            for(unsigned int lane = 0; lane < LANES; lane++) g.remaining[lane] = batch;
+            run_group(g, stats);
+        }
+    }
+
+    // Fewer than half the lanes busy per step on average: the groups may have drifted apart.
+    // Only reshuffle if sorting would actually pull matching PCs together, when every
+    // instance is somewhere different moving 4 KiB per lane around buys nothing.
+    uint64_t steps = stats.steps - steps_before;
+    bool settled = stats.lane_steps - regrouped_at >= REGROUP_INTERVAL * count; // Don't regroup more often than it can pay for itself
+    if(groups.size() > 1 && settled && steps && (stats.lane_steps - before) * 2 < steps * LANES) {
+        std::vector<uint16_t> pcs(count);
+        size_t spread = 0; // Distinct PCs summed over the groups as they are now
+        for(size_t first = 0; first < count; first += LANES) {
+            size_t last = std::min<size_t>(first + LANES, count);
+            for(size_t i = first; i < last; i++) pcs[i] = groups[i / LANES].pc[i % LANES]; // Slot order
+            std::sort(pcs.begin() + first, pcs.begin() + last);
+            spread += std::unique(pcs.begin() + first, pcs.begin() + last) - (pcs.begin() + first);
+        }
+
+        std::sort(pcs.begin(), pcs.end());
+        size_t sorted_spread = 0; // The same after regrouping
+        for(size_t i = 0; i < count; i++) {
+            sorted_spread += i % LANES == 0 || pcs[i] != pcs[i - 1];
+        }
+
+        if(sorted_spread * 4 <= spread * 3) {
+            Regroup();
+        }
+    }
+}
+
+void Lockstep::TickTimers() {
+    for(LockstepGroup& g : groups) {
+        switch(isa) {
+#ifdef CHIP8_LOCKSTEP_X86
+            case Isa::Avx512: avx512::Tick(g); break;
+            case Isa::Avx2: avx2::Tick(g); break;
+#endif
+            default: scalar::Tick(g); break;
+        }
+    }
+}
+
+void Lockstep::Regroup() {
+    // Order the instances by PC, then deal them out to lanes in that order
+    std::vector<uint32_t> order(count);
+    for(size_t i = 0; i < count; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return ReadPC(a) < ReadPC(b); });
+
+    std::vector<LockstepGroup, AlignedAllocator<LockstepGroup>> sorted(groups.size());
+
+    for(size_t to = 0; to < count; to++) {
+        LockstepGroup const& src = GroupOf(order[to]);
+        unsigned int s = LaneOf(order[to]);
+        LockstepGroup& dst = sorted[to / LANES];
+        unsigned int d = to % LANES;
+
+        for(unsigned int v = 0; v < 16; v++) dst.V[v][d] = src.V[v][s];
+        for(unsigned int level = 0; level < 16; level++) dst.stack[level][d] = src.stack[level][s];
+        dst.pc[d] = src.pc[s];
+        dst.I[d] = src.I[s];
+        dst.keys[d] = src.keys[s];
+        dst.sp[d] = src.sp[s];
+        dst.dt[d] = src.dt[s];
+        dst.st[d] = src.st[s];
+        dst.rng[d] = src.rng[s];
+        dst.live |= ((src.live >> s) & 1u) << d;
+        dst.unsupported |= ((src.unsupported >> s) & 1u) << d;
+        memcpy(dst.video[d], src.video[s], sizeof(src.video[s]));
+        memcpy(dst.memory[d], src.memory[s], sizeof(src.memory[s]));
+
+        for(unsigned int block = 0; block < MEMORY_SIZE / 16; block++) {
+            dst.written[block] |= ((src.written[block] >> s) & 1u) << d;
+        }
+    }
+
+    for(size_t to = 0; to < count; to++) {
+        slot[order[to]] = to;
+    }
+
+    groups.swap(sorted);
+    stats.regroups++;
+    regrouped_at = stats.lane_steps;
+}
+
+bool Lockstep::Supported() const {
+    for(LockstepGroup const& g : groups) {
+        if(g.unsupported) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Lockstep::ReadVideo(size_t instance, uint64_t* rows) const {
+    memcpy(rows, GroupOf(instance).video[LaneOf(instance)], VIDEO_HEIGHT * sizeof(uint64_t));
+}
+
+uint8_t Lockstep::ReadRegister(size_t instance, uint8_t x) const {
+    return GroupOf(instance).V[x & 0xFu][LaneOf(instance)];
+}
+
+uint8_t Lockstep::ReadMemory(size_t instance, uint16_t address) const {
+    return GroupOf(instance).memory[LaneOf(instance)][address & (MEMORY_SIZE - 1u)];
+}
+
+uint16_t Lockstep::ReadPC(size_t instance) const {
+    return GroupOf(instance).pc[LaneOf(instance)];
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <aligned_allocator.hpp>
+#include <chip_8.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+/**
+ * Lockstep SIMD engine
+ * Runs many instances of one ROM with their state stored lane-wise (structure of
+ * arrays) in groups of 32 lanes. Each step picks the lowest PC among the lanes that
+ * still have instructions left, fetches that opcode once, and executes it for every
+ * lane sitting at the same PC (and holding the same opcode there) under a lane mask.
+ * ALU ops, skips, jumps and I/timer updates are done 32 lanes at a time with AVX2 or
+ * AVX-512 (picked at runtime), Dxyn/Cxkk/memory ops loop over the lanes in the mask.
+ *
+ * Lanes that diverge just run in separate steps of the same group. When a Run() keeps
+ * less than half of the lanes busy per step, instances are regrouped across groups by
+ * PC so the ones doing the same thing end up together again.
+ *
+ * Each instance behaves exactly like a Chip8 with the same seed and keypad input, as long as
+ * the ROM sticks to classic CHIP-8: lanes are 64x32 single plane screens over 4 KB of memory,
+ * with none of the SUPER-CHIP/XO-CHIP instructions. ROMs over MAX_ROM_SIZE are refused up
+ * front (Loaded() is false), and a lane that reaches a SUPER-CHIP/XO-CHIP opcode stops right
+ * there instead of running it wrong (Supported() turns false). Either way, run the ROM on
+ * Chip8 instead.
+ */
+struct LockstepGroup {
+    static const unsigned int LANES = 32;
+
+    alignas(64) uint8_t V[16][LANES]; // V[x][lane]
+    alignas(64) uint16_t pc[LANES];
+    alignas(64) uint16_t I[LANES];
+    alignas(64) uint16_t remaining[LANES]; // Instructions each lane still has to run in the current Run()
+    alignas(64) uint16_t stack[16][LANES]; // stack[level][lane]
+    alignas(64) uint16_t keys[LANES]; // Keypad mask, bit k = key k held down
+    alignas(64) uint8_t sp[LANES];
+    alignas(64) uint8_t dt[LANES];
+    alignas(64) uint8_t st[LANES];
+    uint32_t live; // Lanes that hold an instance
+    uint32_t unsupported; // Lanes stopped on an opcode this engine doesn't run
+    uint32_t written[MEMORY_SIZE / 16]; // Per 16-byte block of memory: lanes that have written to it (their code may differ)
+    RandomEngine rng[LANES];
+    alignas(64) uint64_t video[LANES][VIDEO_HEIGHT]; // Packed framebuffer per lane, same layout as Chip8::video
+    alignas(64) uint8_t memory[LANES][MEMORY_SIZE]; // Full RAM per lane
+};
+
+class Lockstep {
+    public:
+        static const unsigned int LANES = LockstepGroup::LANES;
+
+        enum class Isa {
+            Scalar, // Plain loops over the lanes
+            Avx2, // 32 lanes of bytes per 256-bit register
+            Avx512 // AVX-512BW/VL mask registers instead of blends
+        };
+
+        struct Stats {
+            uint64_t steps{}; // Opcodes issued (each one for a whole group)
+            uint64_t lane_steps{}; // Instructions retired across all lanes
+            uint64_t regroups{}; // Times instances were reshuffled across groups
+        };
+
+        Lockstep(uint8_t const* rom, size_t size, size_t count, unsigned int seed); // Instance i is seeded with seed + i
+
+        size_t Count() const { return count; }
+        bool Loaded() const { return loaded; } // False if the ROM was empty or bigger than MAX_ROM_SIZE (nothing runs)
+        bool Supported() const; // False once any instance stopped on a SUPER-CHIP/XO-CHIP opcode, its results no longer match Chip8
+        static Isa BestIsa(); // Widest ISA this CPU supports
+        bool SetIsa(Isa isa); // Returns false if this CPU can't run it
+        Isa GetIsa() const { return isa; }
+
+        void SetKeys(size_t instance, uint16_t keys); // Bit k = key k held down
+        void Run(uint64_t instructions); // Every instance runs exactly this many instructions
+        void TickTimers(); // One 60 Hz tick for every instance
+        void Regroup(); // Sort instances across groups by PC
+
+        void ReadVideo(size_t instance, uint64_t* rows) const; // Copy out VIDEO_HEIGHT packed rows
+        uint8_t ReadRegister(size_t instance, uint8_t x) const;
+        uint8_t ReadMemory(size_t instance, uint16_t address) const;
+        uint16_t ReadPC(size_t instance) const;
+        Stats const& GetStats() const { return stats; }
+
+    private:
+        typedef void (*GroupFunc)(LockstepGroup& group, Stats& stats);
+
+        static const uint64_t REGROUP_INTERVAL = 1024; // Instructions per instance between regroups, each one copies all of the state
+
+        size_t count;
+        bool loaded;
+        Isa isa{Isa::Scalar};
+        GroupFunc run_group{};
+        std::vector<LockstepGroup, AlignedAllocator<LockstepGroup>> groups; // Lane arrays on 64-byte boundaries, which new doesn't promise
+        std::vector<uint32_t> slot; // Instance -> group * LANES + lane
+        Stats stats;
+        uint64_t regrouped_at{}; // stats.lane_steps at the last regroup
+
+        LockstepGroup& GroupOf(size_t instance) { return groups[slot[instance] / LANES]; }
+        LockstepGroup const& GroupOf(size_t instance) const { return groups[slot[instance] / LANES]; }
+        unsigned int LaneOf(size_t instance) const { return slot[instance] % LANES; }
+};
@@ -0,0 +1,270 @@
+/**
+ * Lockstep engine body, shared by every ISA
+ * Included once per ISA namespace in lockstep.cpp, right after that namespace's Ops
+ * (and inside its target pragma), so the whole engine gets compiled for each ISA.
+ * Ops provides V8 (32 lanes of bytes), V16 (32 lanes of words) and the primitives
+ * below. Lane masks are plain uint32_t with bit n = lane n.
+ */
+
+static const uint16_t FONTSET_ADDRESS = 0x50;
+
+template<class Ops>
+static void Execute(LockstepGroup& g, uint16_t opcode, uint32_t mask) {
+    typedef typename Ops::V8 V8;
+
+    unsigned int x = (opcode >> 8u) & 0xFu;
+    unsigned int y = (opcode >> 4u) & 0xFu;
+    uint8_t kk = opcode & 0xFFu;
+    uint8_t n = opcode & 0xFu;
+    uint16_t nnn = opcode & 0xFFFu;
+    uint32_t skip = 0; // Lanes that skip the next instruction
+
+    #define EACH_LANE(lane) for(uint32_t m_ = mask, lane; m_ && (lane = __builtin_ctz(m_), true); m_ &= m_ - 1)
+
+    switch(opcode >> 12u) {
+        case 0x0:
+            if(n == 0x0) { // CLS
+                EACH_LANE(lane) {
+                    for(unsigned int row = 0; row < VIDEO_HEIGHT; row++) g.video[lane][row] = 0;
+                }
+            }
+            else if(n == 0xE) { // RET
+                EACH_LANE(lane) {
+                    g.sp[lane]--;
+                    g.pc[lane] = g.stack[g.sp[lane] & 0xFu][lane];
+                }
+            }
+            break;
+
+        case 0x1: // JP addr
+            Ops::Store16(g.pc, Ops::Set16(nnn), mask);
+            break;
+
+        case 0x2: // CALL addr
+            EACH_LANE(lane) {
+                g.stack[g.sp[lane] & 0xFu][lane] = g.pc[lane];
+                g.sp[lane]++;
+                g.pc[lane] = nnn;
+            }
+            break;
+
+        case 0x3: // SE Vx, byte
+            skip = Ops::Eq8(Ops::Load8(g.V[x]), Ops::Set8(kk));
+            break;
+
+        case 0x4: // SNE Vx, byte
+            skip = ~Ops::Eq8(Ops::Load8(g.V[x]), Ops::Set8(kk));
+            break;
+
+        case 0x5: // SE Vx, Vy
+            skip = Ops::Eq8(Ops::Load8(g.V[x]), Ops::Load8(g.V[y]));
+            break;
+
+        case 0x6: // LD Vx, byte
+            Ops::Store8(g.V[x], Ops::Set8(kk), mask);
+            break;
+
+        case 0x7: // ADD Vx, byte
+            Ops::Store8(g.V[x], Ops::Add8(Ops::Load8(g.V[x]), Ops::Set8(kk)), mask);
+            break;
+
+        case 0x8: {
+            // Same order as the Chip8 handlers: VF is written first and the result is
+            // computed from the registers after that, which matters when x or y is F
+            V8 vx = Ops::Load8(g.V[x]);
+            V8 vy = Ops::Load8(g.V[y]);
+
+            switch(n) {
+                case 0x0: Ops::Store8(g.V[x], vy, mask); break;
+                case 0x1: Ops::Store8(g.V[x], Ops::Or8(vx, vy), mask); break;
+                case 0x2: Ops::Store8(g.V[x], Ops::And8(vx, vy), mask); break;
+                case 0x3: Ops::Store8(g.V[x], Ops::Xor8(vx, vy), mask); break;
+                case 0x4: {
+                    V8 sum = Ops::Add8(vx, vy);
+                    Ops::Store8(g.V[0xF], Ops::Ones8(Ops::Gt8(vx, sum)), mask); // Carry out if the sum wrapped
+                    Ops::Store8(g.V[x], sum, mask);
+                } break;
+                case 0x5:
+                    Ops::Store8(g.V[0xF], Ops::Ones8(Ops::Gt8(vx, vy)), mask);
+                    Ops::Store8(g.V[x], Ops::Sub8(Ops::Load8(g.V[x]), Ops::Load8(g.V[y])), mask);
+                    break;
+                case 0x6:
+                    Ops::Store8(g.V[0xF], Ops::Bit0_8(vx), mask);
+                    Ops::Store8(g.V[x], Ops::Shr1_8(Ops::Load8(g.V[x])), mask);
+                    break;
+                case 0x7:
+                    Ops::Store8(g.V[0xF], Ops::Ones8(Ops::Gt8(vy, vx)), mask);
+                    Ops::Store8(g.V[x], Ops::Sub8(Ops::Load8(g.V[y]), Ops::Load8(g.V[x])), mask);
+                    break;
+                case 0xE:
+                    Ops::Store8(g.V[0xF], Ops::Bit7_8(vx), mask);
+                    Ops::Store8(g.V[x], Ops::Shl1_8(Ops::Load8(g.V[x])), mask);
+                    break;
+            }
+        } break;
+
+        case 0x9: // SNE Vx, Vy
+            skip = ~Ops::Eq8(Ops::Load8(g.V[x]), Ops::Load8(g.V[y]));
+            break;
+
+        case 0xA: // LD I, addr
+            Ops::Store16(g.I, Ops::Set16(nnn), mask);
+            break;
+
+        case 0xB: // JP V0, addr
+            Ops::Store16(g.pc, Ops::Add16(Ops::Widen8(Ops::Load8(g.V[0])), Ops::Set16(nnn)), mask);
+            break;
+
+        case 0xC: { // RND Vx, byte
+            std::uniform_int_distribution<uint8_t> randByte(0, 255U);
+            EACH_LANE(lane) {
+                g.V[x][lane] = randByte(g.rng[lane]) & kk;
+            }
+        } break;
+
+        case 0xD: // DRW Vx, Vy, nibble
+            EACH_LANE(lane) {
+                uint8_t x_pos = g.V[x][lane] % VIDEO_WIDTH;
+                uint8_t y_pos = g.V[y][lane] % VIDEO_HEIGHT;
+                unsigned int rows = n < VIDEO_HEIGHT - y_pos ? n : VIDEO_HEIGHT - y_pos;
+                uint64_t collision = 0;
+
+                for(unsigned int row = 0; row < rows; row++) {
+                    uint64_t sprite_row = (static_cast<uint64_t>(g.memory[lane][(g.I[lane] + row) & (MEMORY_SIZE - 1u)]) << 56u) >> x_pos;
+                    collision |= g.video[lane][y_pos + row] & sprite_row;
+                    g.video[lane][y_pos + row] ^= sprite_row;
+                }
+
+                g.V[0xF][lane] = collision != 0;
+            }
+            break;
+
+        case 0xE: // SKP Vx / SKNP Vx (keys past F count as up)
+            if(n == 0xE || n == 0x1) {
+                uint32_t pressed = 0;
+
+                EACH_LANE(lane) {
+                    uint8_t key = g.V[x][lane];
+                    if(key < KEY_COUNT && ((g.keys[lane] >> key) & 1u)) pressed |= 1u << lane;
+                }
+
+                skip = n == 0xE ? pressed : ~pressed;
+            }
+            break;
+
+        case 0xF:
+            switch(kk) {
+                case 0x07: Ops::Store8(g.V[x], Ops::Load8(g.dt), mask); break;
+                case 0x15: Ops::Store8(g.dt, Ops::Load8(g.V[x]), mask); break;
+                case 0x18: Ops::Store8(g.st, Ops::Load8(g.V[x]), mask); break;
+                case 0x1E: Ops::Store16(g.I, Ops::Add16(Ops::Load16(g.I), Ops::Widen8(Ops::Load8(g.V[x]))), mask); break;
+                case 0x29: Ops::Store16(g.I, Ops::Add16(Ops::Mul5_16(Ops::Widen8(Ops::Load8(g.V[x]))), Ops::Set16(FONTSET_ADDRESS)), mask); break;
+
+                case 0x0A: // LD Vx, K: lowest key held down, or wait here
+                    EACH_LANE(lane) {
+                        if(g.keys[lane]) g.V[x][lane] = __builtin_ctz(g.keys[lane]);
+                        else g.pc[lane] -= 2;
+                    }
+                    break;
+
+                case 0x33: // LD B, Vx
+                    EACH_LANE(lane) {
+                        uint8_t value = g.V[x][lane];
+                        for(unsigned int i = 3; i-- > 0;) {
+                            uint16_t address = (g.I[lane] + i) & (MEMORY_SIZE - 1u);
+                            g.memory[lane][address] = value % 10;
+                            g.written[address / 16] |= 1u << lane;
+                            value /= 10;
+                        }
+                    }
+                    break;
+
+                case 0x55: // LD [I], Vx
+                    EACH_LANE(lane) {
+                        for(unsigned int i = 0; i <= x; i++) {
+                            uint16_t address = (g.I[lane] + i) & (MEMORY_SIZE - 1u);
+                            g.memory[lane][address] = g.V[i][lane];
+                            g.written[address / 16] |= 1u << lane;
+                        }
+                    }
+                    break;
+
+                case 0x65: // LD Vx, [I]
+                    EACH_LANE(lane) {
+                        for(unsigned int i = 0; i <= x; i++) {
+                            g.V[i][lane] = g.memory[lane][(g.I[lane] + i) & (MEMORY_SIZE - 1u)];
+                        }
+                    }
+                    break;
+            }
+            break;
+    }
+
+    #undef EACH_LANE
+
+    skip &= mask;
+    if(skip) {
+        Ops::Store16(g.pc, Ops::Add16(Ops::Load16(g.pc), Ops::Set16(2)), skip);
+    }
+}
+
+// Run every lane of the group until it has used up its remaining instructions
+template<class Ops>
+static void RunGroup(LockstepGroup& g, Lockstep::Stats& stats) {
+    typedef typename Ops::V16 V16;
+
+    while(true) {
+        V16 remaining = Ops::Load16(g.remaining);
+        uint32_t active = ~Ops::Eq16(remaining, Ops::Set16(0)) & g.live & ~g.unsupported;
+
+        if(!active) {
+            break;
+        }
+
+        // Lowest PC first: lanes that fell behind catch up, and the rest wait for them to reconverge
+        V16 pcs = Ops::Select16(active, Ops::Load16(g.pc), Ops::Set16(0xFFFF));
+        uint16_t leader_pc = Ops::Min16(pcs);
+        uint32_t mask = Ops::Eq16(pcs, Ops::Set16(leader_pc)) & active;
+
+        unsigned int leader = __builtin_ctz(mask);
+        uint16_t address = leader_pc & (MEMORY_SIZE - 1u);
+        uint16_t next = (address + 1u) & (MEMORY_SIZE - 1u);
+        uint16_t opcode = (g.memory[leader][address] << 8u) | g.memory[leader][next];
+
+        // If any lane (the leader included) wrote over this code, opcodes here may differ between
+        // lanes: every lane has to be checked, and the ones that differ wait for a later step
+        uint32_t suspect = (mask & (g.written[address / 16] | g.written[next / 16])) ? mask : 0;
+        for(uint32_t m = suspect; m; m &= m - 1) {
+            unsigned int lane = __builtin_ctz(m);
+            if(((g.memory[lane][address] << 8u) | g.memory[lane][next]) != opcode) mask &= ~(1u << lane);
+        }
+
+        // Execute() only knows classic CHIP-8, so these lanes stop here rather than go wrong
+        if(IsExtendedOpcode(opcode)) {
+            g.unsupported |= mask;
+            continue;
+        }
+
+        Ops::Store16(g.pc, Ops::Add16(Ops::Load16(g.pc), Ops::Set16(2)), mask);
+        Ops::Store16(g.remaining, Ops::Sub16(remaining, Ops::Set16(1)), mask);
+
+        stats.steps++;
+        stats.lane_steps += __builtin_popcount(mask);
+
+        Execute<Ops>(g, opcode, mask);
+    }
+}
+
+template<class Ops>
+static void TickGroup(LockstepGroup& g) {
+    Ops::Store8(g.dt, Ops::SubSat8(Ops::Load8(g.dt), Ops::Set8(1)), g.live);
+    Ops::Store8(g.st, Ops::SubSat8(Ops::Load8(g.st), Ops::Set8(1)), g.live);
+}
+
+static void Run(LockstepGroup& g, Lockstep::Stats& stats) {
+    RunGroup<Ops>(g, stats);
+}
+
+static void Tick(LockstepGroup& g) {
+    TickGroup<Ops>(g);
+}
@@ -1,51 +1,333 @@
+#include <beeper.hpp>
 #include <chip_8.hpp>
+#include <frame_recorder.hpp>
+#include <movie.hpp>
 #include <platform.hpp>
+#include <renderer.hpp>
+#include <rewind.hpp>
+#include <scheduler.hpp>
+#include <spsc_ring.hpp>
+#include <triple_buffer.hpp>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
+
+// Input-to-photon latency distribution, from each key press to the present of the first frame drawn after it
+static void PrintLatency(std::vector<int64_t> latencies) {
+    if (latencies.empty()) {
+        std::cout << "latency: no key presses were followed by a drawn frame\n";
+        return;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[static_cast<size_t>(p * (latencies.size() - 1))] / 1000.0; };
+
+    std::cout << "latency_samples: " << latencies.size() << "\n"
+              << "latency_ms_min: " << percentile(0.0) << "\n"
+              << "latency_ms_p50: " << percentile(0.5) << "\n"
+              << "latency_ms_p90: " << percentile(0.9) << "\n"
+              << "latency_ms_p99: " << percentile(0.99) << "\n"
+              << "latency_ms_max: " << percentile(1.0) << "\n";
+}
 
 int main(int argc, char* argv[]) {
-    if(argc != 4) {
-        std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM>\n";
+    if(argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <Scale> <IPS> <ROM> [--record <movie>] [--play <movie> [--seek <frame>]] [--latency] [--record-video <file|->] [--software [--scale2x] [--scanlines <percent>]]\n";
         std::exit(EXIT_FAILURE);
     }
 
     // Sanity check our args
     std::cout << "Scale: " <<  argv[1] << std::endl;
-    std::cout << "Delay: " << argv[2] << std::endl;
+    std::cout << "IPS: " << argv[2] << std::endl;
     std::cout << "ROM: " << argv[3] << std::endl;
     
     // Parse the critical args!
     int video_scale = std::stoi(argv[1]);
-    int cycle_delay = std::stoi(argv[2]);
+    uint64_t instructions_per_second = std::stoull(argv[2]);
     const char* ROM_filename = argv[3];
 
+    // Then the optional ones
+    const char* record_filename = nullptr;
+    const char* play_filename = nullptr;
+    uint64_t seek_frame = 0;
+    bool measure_latency = false;
+    const char* video_filename = nullptr;
+    bool software = false;
+    SoftwareRenderer::Options render_options;
+
+    for(int i = 4; i < argc; i++) {
+        if(!std::strcmp(argv[i], "--record") && i + 1 < argc) {
+            record_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--play") && i + 1 < argc) {
+            play_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--seek") && i + 1 < argc) {
+            seek_frame = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--latency")) {
+            measure_latency = true;
+        }
+        else if(!std::strcmp(argv[i], "--record-video") && i + 1 < argc) {
+            video_filename = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--software")) {
+            software = true;
+        }
+        else if(!std::strcmp(argv[i], "--scale2x")) {
+            render_options.scale2x = true;
+        }
+        else if(!std::strcmp(argv[i], "--scanlines") && i + 1 < argc) {
+            render_options.scanline = std::stoul(argv[++i]);
+        }
+        else {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    if((record_filename && play_filename) || (seek_frame && !play_filename)) {
+        std::cerr << "--record and --play don't mix, and --seek needs --play\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Software mode draws at full size on the CPU, otherwise the CPU only draws the 128x64 texture (a lores pixel is 2x2 of it) and the GPU scales it
+    render_options.scale = software ? video_scale : 2;
+    SoftwareRenderer renderer(render_options);
+    if((!software && (render_options.scale2x || render_options.scanline != 100)) || !renderer.Valid()) {
+        std::cerr << "--scale2x and --scanlines need --software, a scale of 1-" << SoftwareRenderer::MAX_SCALE << " (even with --scale2x) and a percentage of 0-100\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    // A movie brings its own seed and instruction rate, otherwise pick a seed we can record
+    Movie movie;
+    if(play_filename && !movie.Load(play_filename)) {
+        std::cerr << "Could not load movie: " << play_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    unsigned int seed = play_filename ? movie.Seed() : std::chrono::system_clock::now().time_since_epoch().count();
+    if(play_filename) {
+        instructions_per_second = movie.InstructionsPerSecond();
+    }
+
     // Instantiate the SDL platform!
-    Platform platform("CHIP-8 Emulator", VIDEO_WIDTH * video_scale, VIDEO_HEIGHT * video_scale, VIDEO_WIDTH, VIDEO_HEIGHT);
+    std::unique_ptr<Platform> platform(software
+        ? new Platform("CHIP-8 Emulator", renderer)
+        : new Platform("CHIP-8 Emulator", VIDEO_WIDTH * video_scale, VIDEO_HEIGHT * video_scale, HIRES_WIDTH, HIRES_HEIGHT));
 
     // Instantiate the CHIP-8 and load up the ROM!
-    Chip8 chip8;
-    chip8.LoadROM(ROM_filename);
+    Chip8 chip8(seed);
+    if(!chip8.LoadROM(ROM_filename)) {
+        std::cerr << "Could not load ROM (missing, empty or bigger than " << XO_MAX_ROM_SIZE << " bytes): " << ROM_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    if(play_filename && (!movie.MatchesROM(chip8) || !movie.Seek(seek_frame, chip8))) {
+        std::cerr << "Could not play " << play_filename << " from frame " << seek_frame << " with this ROM\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if(record_filename) {
+        movie.Begin(chip8, seed, instructions_per_second);
+    }
+
+    // Everything that was on screen, one record per frame that changed
+    FrameRecorder video;
+    if(video_filename && !video.Open(video_filename)) {
+        std::cerr << "Could not open frame recording: " << video_filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
 
     // Load up some other important variables
-    int video_pitch = sizeof(chip8.video[0]) * VIDEO_WIDTH;
-    auto lastCycleTime = std::chrono::high_resolution_clock::now();
-	bool quit = false;
+    typedef KeyEvent::Clock Clock;
+    struct Frame {
+        Display video; // Copy of the display, drawn on this thread
+        bool has_input; // The first frame drawn since a key went down
+        Clock::time_point input_time; // When that key went down
+    };
+    uint32_t pixels[HIRES_WIDTH * HIRES_HEIGHT]; // The texture, when the GPU scales
+    int video_pitch = sizeof(uint32_t) * HIRES_WIDTH;
+    TripleBuffer<Frame> frames; // Finished frames, filled on the emulation thread and presented on this one
+
+    // Input, handed from this thread to the emulation thread
+    SpscRing<KeyEvent, 256> key_events; // Keypad changes in the order they happened, stamped with when they came in
+    std::atomic<bool> rewinding{false}; // Backspace is held
+    std::atomic<bool> quit{false};
+    std::mutex input_mutex; // Only taken to sleep on input_changed while the ROM waits for a key
+    std::condition_variable input_changed;
 
-    while (!quit) {
-		quit = platform.ProcessInput(chip8.keypad);
+    // Sound: synthesized on the emulation thread, played from SDL's audio callback
+    Beeper::Ring audio_ring;
+    Beeper beeper(audio_ring);
+    if (!platform->OpenAudio(audio_ring)) {
+        std::cerr << "No audio device, running without sound\n";
+    }
+
+    // Emulation runs on its own thread, paced by the scheduler alone, so a slow present (vsync, a busy compositor) never holds it up.
+    // One iteration per 60 Hz frame: input, a batch of instructions plus a timer tick, publish the frame, then sleep
+    std::thread emulation([&]() {
+		FrameScheduler scheduler(instructions_per_second);
+		RewindBuffer rewind; // A snapshot per frame, hold Backspace to play it backwards
+		std::deque<KeyEvent> pending; // Key events not applied yet
+		bool has_input = false; // A key went down and no frame showing it has gone out yet
+		uint64_t frame_number = 0; // Frames as the user saw them, rewinding included
+		Clock::time_point input_time;
+
+		scheduler.Seek(seek_frame);
+
+		while (!quit.load()) {
+			bool playing = play_filename && scheduler.Frames() < movie.Frames();
+
+			// Everything that came in before this frame starts is applied at its start. A key that changes twice
+			// within one frame has the second change held back a frame, so even a tap shorter than a frame gets seen
+			KeyEvent incoming[64];
+			size_t count;
+			while ((count = key_events.Pop(incoming, 64)) != 0) {
+				pending.insert(pending.end(), incoming, incoming + count);
+			}
+
+			uint16_t changed = 0;
+			while (!pending.empty() && !(changed & (1u << pending.front().key))) {
+				KeyEvent const& event = pending.front();
+				changed |= 1u << event.key;
+
+				if (!playing) { // While a movie drives the keypad, the keyboard only controls rewinding
+					chip8.SetKey(event.key, event.pressed);
+					if (event.pressed && !has_input) {
+						has_input = true;
+						input_time = event.time;
+					}
+				}
+				pending.pop_front();
+			}
+
+			if (rewinding.load()) {
+				// Step back one frame, but keep the keys that are held right now
+				uint16_t keys = chip8.Keys();
+				if (rewind.Rewind(1, chip8)) {
+					scheduler.Seek(seek_frame + rewind.End()); // Snapshot n was taken after frame seek_frame + n
+					if (record_filename) {
+						movie.Truncate(scheduler.Frames());
+					}
+				}
+				chip8.SetKeys(keys);
+			}
+			else {
+				if (playing) {
+					movie.ApplyInput(scheduler.Frames(), chip8);
+				}
+				if (record_filename) {
+					movie.RecordFrame(chip8);
+				}
+				scheduler.RunFrame(chip8);
+				rewind.Push(chip8);
+			}
+
+			if (chip8.XoAudio()) {
+				beeper.SetPattern(chip8.AudioPattern(), chip8.Pitch());
+			}
+			beeper.RunSlice(chip8.SoundActive());
+
+			if (video_filename) {
+				video.Record(frame_number++, chip8.video);
+			}
+
+			// Only hand over a frame when something was drawn
+			if (chip8.VideoDirty()) {
+				Frame& frame = frames.Back();
+				frame.video = chip8.video;
+				frame.has_input = has_input;
+				frame.input_time = input_time;
+				has_input = false;
+
+				if (!frames.Publish() && frames.Back().has_input) {
+					// The frame we replaced never got shown, so its key press is still waiting to be seen
+					has_input = true;
+					input_time = frames.Back().input_time;
+				}
+
+				chip8.PresentVideo();
+				Platform::Wake();
+			}
+
+			if (chip8.WaitingForKey() && pending.empty() && !playing && !rewinding.load()) {
+				// Parked on LD Vx, K: every frame until a key goes down is the same, so sleep until one comes in
+				std::unique_lock<std::mutex> lock(input_mutex);
+				input_changed.wait(lock, [&]() { return key_events.Size() || rewinding.load() || quit.load(); });
+			}
 
-		auto currentTime = std::chrono::high_resolution_clock::now();
-		float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
+			for (unsigned int slice = 1; slice < Beeper::SLICES; slice++) { // The rest of the frame's sound, a slice at a time so little is queued
+				scheduler.WaitForSlice(slice, Beeper::SLICES);
+				beeper.RunSlice(chip8.SoundActive());
+			}
+			scheduler.WaitForNextFrame();
+		}
+	});
+
+    // This thread owns SDL: it collects input and presents the newest finished frame, and sleeps in between
+    std::vector<KeyEvent> events;
+    std::vector<int64_t> latencies; // Key down to the first frame showing it on screen, in microseconds
+    while (!quit.load()) {
+		events.clear();
+		bool stop = platform->ProcessInput(events);
 
-		if (dt > cycle_delay) {
-			lastCycleTime = currentTime;
+		size_t sent = key_events.Push(events.data(), events.size()); // The emulation thread drains this every frame, it doesn't fill up
+		if (sent < events.size()) {
+			std::cerr << "Input queue full, dropped " << events.size() - sent << " key events\n";
+		}
 
-			chip8.Cycle();
+		if (stop || sent || platform->Rewinding() != rewinding.load()) {
+			rewinding.store(platform->Rewinding());
+			quit.store(stop);
+			{
+				std::lock_guard<std::mutex> lock(input_mutex); // So the emulation thread can't miss the notify between its check and its wait
+			}
+			input_changed.notify_one();
+		}
+
+		if (frames.Update()) {
+			if (software) {
+				platform->Present(frames.Front().video);
+			}
+			else {
+				renderer.Render(frames.Front().video, pixels, video_pitch);
+				platform->Update(pixels, video_pitch);
+			}
+
+			if (measure_latency && frames.Front().has_input) {
+				latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - frames.Front().input_time).count());
+			}
+		}
 
-			platform.Update(chip8.video, video_pitch);
+		if (!stop) {
+			platform->WaitForEvent(); // Until a key or a new frame
 		}
 	}
 
+    emulation.join();
+    platform->CloseAudio();
+
+    if (video_filename && !video.Close()) {
+        std::cerr << "Could not write frame recording: " << video_filename << "\n";
+    }
+
+    if (measure_latency) {
+        PrintLatency(latencies);
+    }
+
+    if (record_filename && !movie.Save(record_filename)) {
+        std::cerr << "Could not write movie: " << record_filename << "\n";
+        return EXIT_FAILURE;
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include <mapped_file.hpp>
+#include <fstream>
+#include <iterator>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CHIP8_MMAP_SUPPORTED 1
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const char* filename) {
+    Close();
+
+#ifdef CHIP8_MMAP_SUPPORTED
+    int fd = ::open(filename, O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    size = static_cast<size_t>(info.st_size);
+    if(size > 0) {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping == MAP_FAILED) {
+            ::close(fd);
+            size = 0;
+            return false;
+        }
+
+        data = static_cast<uint8_t const*>(mapping);
+        mapped = true;
+    }
+
+    ::close(fd); // The mapping keeps the file alive
+    open = true;
+    return true;
+#else
+    std::ifstream file(filename, std::ios::binary);
+    if(!file.is_open()) {
+        return false;
+    }
+
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = buffer.empty() ? nullptr : buffer.data();
+    size = buffer.size();
+    open = true;
+    return true;
+#endif
+}
+
+void MappedFile::Close() {
+#ifdef CHIP8_MMAP_SUPPORTED
+    if(mapped) {
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+#endif
+
+    buffer.clear();
+    data = nullptr;
+    size = 0;
+    open = false;
+    mapped = false;
+}
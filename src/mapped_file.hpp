@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * Read-only file mapping
+ * Maps a whole file with mmap, so reading it is just page faults into the page cache
+ * and many readers of the same file share one copy. Where mmap isn't available the
+ * file is read into a buffer instead, callers can't tell the difference.
+ */
+class MappedFile {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const char* filename) { Open(filename); }
+        ~MappedFile();
+        MappedFile(MappedFile const&) = delete;
+        MappedFile& operator=(MappedFile const&) = delete;
+
+        bool Open(const char* filename); // Map the file, false if it can't be opened
+        void Close();
+
+        bool IsOpen() const { return open; }
+        uint8_t const* Data() const { return data; } // nullptr for an empty file
+        size_t Size() const { return size; }
+
+    private:
+        uint8_t const* data{};
+        size_t size{};
+        bool open{};
+        bool mapped{}; // data came from mmap (otherwise it points into buffer)
+        std::vector<uint8_t> buffer; // Fallback copy
+};
@@ -0,0 +1,229 @@
+#include <movie.hpp>
+#include <rewind.hpp>
+#include <scheduler.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+static void Put(std::vector<uint8_t>& out, uint64_t value, unsigned int bytes) {
+    for(unsigned int i = 0; i < bytes; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+// Reads a little-endian field, fails (and stays failed) instead of running off the end
+struct Reader {
+    uint8_t const* in;
+    uint8_t const* end;
+    bool ok;
+
+    uint64_t Get(unsigned int bytes) {
+        if(!ok || static_cast<size_t>(end - in) < bytes) {
+            ok = false;
+            return 0;
+        }
+
+        uint64_t value = 0;
+        for(unsigned int i = 0; i < bytes; i++) value |= static_cast<uint64_t>(*in++) << (8 * i);
+        return value;
+    }
+};
+
+Movie::Movie(unsigned int keyframe_interval) : keyframe_interval(std::max(1u, keyframe_interval)) {
+}
+
+uint64_t Movie::RomHash(Chip8 const& chip8) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for(unsigned int address = PROGRAM_ADDRESS; address < chip8.MemorySize(); address++) { // All 64 KB for an XO-CHIP ROM, classic ROMs hash as they always did
+        hash = (hash ^ chip8.ReadMemory(address)) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+void Movie::Begin(Chip8 const& chip8, uint32_t seed, uint64_t ips) {
+    this->seed = seed;
+    this->ips = ips;
+    rom_hash = RomHash(chip8);
+    frames = 0;
+    events.clear();
+    keyframes.clear();
+    keys = 0;
+}
+
+void Movie::RecordFrame(Chip8 const& chip8) {
+    uint16_t changed = chip8.Keys() ^ keys;
+
+    for(unsigned int key = 0; key < KEY_COUNT; key++) {
+        if((changed >> key) & 1u) {
+            events.push_back({frames, chip8.InstructionCount(), static_cast<uint8_t>(key), static_cast<uint8_t>((chip8.Keys() >> key) & 1u)});
+        }
+    }
+    keys = chip8.Keys();
+
+    if(frames % keyframe_interval == 0) {
+        uint8_t state[STATE_SIZE];
+        size_t size = chip8.SaveState(state);
+
+        keyframes.emplace_back();
+        RewindBuffer::Encode(state, nullptr, keyframes.back(), size);
+    }
+
+    frames++;
+}
+
+void Movie::Truncate(uint64_t frame) {
+    if(frame >= frames) {
+        return;
+    }
+
+    auto first_dropped = std::lower_bound(events.begin(), events.end(), frame, [](MovieEvent const& event, uint64_t f) { return event.frame < f; });
+    events.erase(first_dropped, events.end());
+    keyframes.resize((frame + keyframe_interval - 1) / keyframe_interval); // Keep the keyframes before frame
+    frames = frame;
+
+    // The keypad as of the new last frame is whatever the remaining events left it at
+    keys = 0;
+    for(MovieEvent const& event : events) keys = event.pressed ? keys | (1u << event.key) : keys & ~(1u << event.key);
+}
+
+bool Movie::Save(const char* filename) const {
+    std::vector<uint8_t> out;
+
+    out.insert(out.end(), {'C', '8', 'M', 'V'});
+    Put(out, VERSION, 2);
+    Put(out, 0, 2);
+    Put(out, seed, 4);
+    Put(out, ips, 8);
+    Put(out, rom_hash, 8);
+    Put(out, frames, 8);
+    Put(out, keyframe_interval, 4);
+
+    Put(out, events.size(), 8);
+    for(MovieEvent const& event : events) {
+        Put(out, event.frame, 8);
+        Put(out, event.instruction, 8);
+        Put(out, event.key, 1);
+        Put(out, event.pressed, 1);
+    }
+
+    Put(out, keyframes.size(), 8);
+    for(std::vector<uint8_t> const& keyframe : keyframes) {
+        Put(out, keyframe.size(), 4);
+        out.insert(out.end(), keyframe.begin(), keyframe.end());
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    return static_cast<bool>(file.write(reinterpret_cast<char const*>(out.data()), out.size()));
+}
+
+bool Movie::Load(const char* filename) {
+    std::ifstream file(filename, std::ios::binary);
+
+    if(!file.is_open()) {
+        return false;
+    }
+
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    Reader reader{data.data(), data.data() + data.size(), true};
+
+    if(data.size() < 4 || memcmp(data.data(), "C8MV", 4)) {
+        return false;
+    }
+    reader.in += 4;
+    uint64_t version = reader.Get(2);
+    if(version < 1 || version > VERSION) { // Version 1 only differs in holding nothing but version 1 states
+        return false;
+    }
+    reader.Get(2);
+
+    uint32_t new_seed = reader.Get(4);
+    uint64_t new_ips = reader.Get(8);
+    uint64_t new_rom_hash = reader.Get(8);
+    uint64_t new_frames = reader.Get(8);
+    unsigned int new_interval = reader.Get(4);
+
+    std::vector<MovieEvent> new_events;
+    uint64_t event_count = reader.Get(8);
+    for(uint64_t i = 0; reader.ok && i < event_count; i++) {
+        MovieEvent event;
+        event.frame = reader.Get(8);
+        event.instruction = reader.Get(8);
+        event.key = reader.Get(1) & (KEY_COUNT - 1u);
+        event.pressed = reader.Get(1) ? 1 : 0;
+        new_events.push_back(event);
+    }
+
+    std::vector<std::vector<uint8_t>> new_keyframes;
+    uint64_t keyframe_count = reader.Get(8);
+    for(uint64_t i = 0; reader.ok && i < keyframe_count; i++) {
+        size_t size = reader.Get(4);
+        if(!reader.ok || static_cast<size_t>(reader.end - reader.in) < size) {
+            return false;
+        }
+
+        new_keyframes.emplace_back(reader.in, reader.in + size);
+        reader.in += size;
+    }
+
+    // Every recorded frame needs a keyframe to seek from
+    if(!reader.ok || new_interval == 0 || new_keyframes.empty() || (new_frames + new_interval - 1) / new_interval > new_keyframes.size()) {
+        return false;
+    }
+
+    seed = new_seed;
+    ips = new_ips;
+    rom_hash = new_rom_hash;
+    frames = new_frames;
+    keyframe_interval = new_interval;
+    events.swap(new_events);
+    keyframes.swap(new_keyframes);
+
+    keys = 0;
+    for(MovieEvent const& event : events) keys = event.pressed ? keys | (1u << event.key) : keys & ~(1u << event.key);
+
+    return true;
+}
+
+void Movie::ApplyInput(uint64_t frame, Chip8& chip8) const {
+    auto event = std::lower_bound(events.begin(), events.end(), frame, [](MovieEvent const& e, uint64_t f) { return e.frame < f; });
+
+    for(; event != events.end() && event->frame == frame; ++event) {
+        chip8.SetKey(event->key, event->pressed);
+    }
+}
+
+bool Movie::RunFrame(uint64_t frame, Chip8& chip8) const {
+    bool in_sync = true;
+
+    auto event = std::lower_bound(events.begin(), events.end(), frame, [](MovieEvent const& e, uint64_t f) { return e.frame < f; });
+    for(; event != events.end() && event->frame == frame; ++event) {
+        chip8.SetKey(event->key, event->pressed);
+        in_sync &= event->instruction == chip8.InstructionCount();
+    }
+
+    // The same batch FrameScheduler hands out for this frame
+    chip8.Run(FrameScheduler::InstructionsBefore(frame + 1, ips) - FrameScheduler::InstructionsBefore(frame, ips));
+    chip8.TickTimers();
+
+    return in_sync;
+}
+
+bool Movie::Seek(uint64_t frame, Chip8& chip8) const {
+    if(frame > frames || keyframes.empty()) {
+        return false;
+    }
+
+    size_t keyframe = std::min<size_t>(frame / keyframe_interval, keyframes.size() - 1);
+    uint8_t state[STATE_SIZE]{};
+    RewindBuffer::Apply(keyframes[keyframe].data(), keyframes[keyframe].data() + keyframes[keyframe].size(), state);
+
+    if(!chip8.LoadState(state, sizeof(state))) {
+        return false;
+    }
+
+    bool in_sync = true;
+    for(uint64_t f = static_cast<uint64_t>(keyframe) * keyframe_interval; f < frame; f++) {
+        in_sync &= RunFrame(f, chip8);
+    }
+
+    return in_sync;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * Input movies
+ * Everything a run depends on besides the ROM: the RNG seed, the instruction rate
+ * and every keypad change, stamped with the frame it was applied on and the
+ * instruction count at that point. Frame f runs the same batch FrameScheduler
+ * hands out for it, then one timer tick, so playing a movie back is bit-exact.
+ * Every keyframe_interval frames the movie also holds a save state (taken at the
+ * start of the frame), so seeking to frame N loads the keyframe at or before N
+ * and only simulates the frames in between.
+ *
+ * File layout (little-endian): "C8MV", u16 version, u16 reserved, u32 seed,
+ * u64 IPS, u64 ROM hash, u64 frames, u32 keyframe interval, u64 event count,
+ * events (u64 frame, u64 instruction, u8 key, u8 down), u64 keyframe count,
+ * keyframes (u32 size, then the state as a RewindBuffer delta against zeros).
+ * Version 2 keyframes may be version 2 save states (SUPER-CHIP/XO-CHIP), so older builds refuse the
+ * file up front instead of failing on a keyframe. Version 1 movies still load.
+ */
+
+// A keypad change, applied at the start of the given frame
+struct MovieEvent {
+    uint64_t frame; // Frame the change is applied on
+    uint64_t instruction; // Instructions executed before it (checked on playback)
+    uint8_t key; // Keypad key (0x0 - 0xF)
+    uint8_t pressed; // 1 = key down, 0 = key up
+};
+
+class Movie {
+    public:
+        static const uint16_t VERSION = 2;
+
+        explicit Movie(unsigned int keyframe_interval = 600);
+
+        // Recording
+        void Begin(Chip8 const& chip8, uint32_t seed, uint64_t ips); // Start a new movie from a freshly loaded ROM
+        void RecordFrame(Chip8 const& chip8); // Call at the start of every frame, once the keypad holds this frame's input
+        void Truncate(uint64_t frame); // Forget frame and everything after it (e.g. after rewinding), recording carries on from there
+        bool Save(const char* filename) const;
+
+        // Playback
+        bool Load(const char* filename); // Returns false if the file is missing, damaged or from a newer version
+        void ApplyInput(uint64_t frame, Chip8& chip8) const; // Apply the keypad changes recorded for a frame
+        bool RunFrame(uint64_t frame, Chip8& chip8) const; // Apply a frame's input, run it and tick the timers, false if the run has desynced
+        bool Seek(uint64_t frame, Chip8& chip8) const; // Put chip8 at the start of a frame in [0, Frames()]
+
+        uint32_t Seed() const { return seed; }
+        uint64_t InstructionsPerSecond() const { return ips; }
+        uint64_t Frames() const { return frames; }
+        bool MatchesROM(Chip8 const& chip8) const { return RomHash(chip8) == rom_hash; } // Was this movie recorded with the ROM chip8 has loaded?
+
+    private:
+        unsigned int keyframe_interval;
+        uint32_t seed{};
+        uint64_t ips{};
+        uint64_t rom_hash{};
+        uint64_t frames{}; // Frames recorded
+        std::vector<MovieEvent> events; // Sorted by frame
+        std::vector<std::vector<uint8_t>> keyframes; // Keyframe i is the state at the start of frame i * keyframe_interval
+        uint16_t keys{}; // Keypad as of the last recorded frame, bit k = key k
+
+        static uint64_t RomHash(Chip8 const& chip8); // FNV-1a over program memory, from PROGRAM_ADDRESS to the end of RAM
+};
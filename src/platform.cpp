@@ -1,8 +1,9 @@
 #include "platform.hpp"
+#include <chip_8.hpp>
 #include <SDL2/SDL.h>
 
 Platform::Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight) {
-    SDL_Init(SDL_INIT_VIDEO);
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
 
     window = SDL_CreateWindow(title, 0, 0, windowWidth, windowHeight, SDL_WINDOW_SHOWN);
 
@@ -12,7 +13,15 @@ Platform::Platform(char const* title, int windowWidth, int windowHeight, int tex
         renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, textureWidth, textureHeight);
 }
 
+Platform::Platform(char const* title, SoftwareRenderer const& renderer) : software(&renderer) {
+    SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
+
+    window = SDL_CreateWindow(title, 0, 0, renderer.Width(), renderer.Height(), SDL_WINDOW_SHOWN);
+}
+
 Platform::~Platform() {
+    CloseAudio();
+    SDL_FreeSurface(staging);
     SDL_DestroyTexture(texture);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
@@ -27,194 +36,113 @@ void Platform::Update(void const* buffer, int pitch)
 	SDL_RenderPresent(renderer);
 }
 
-bool Platform::ProcessInput(uint8_t* keys) {
+void Platform::Present(Display const& video)
+{
+	SDL_Surface* surface = SDL_GetWindowSurface(window); // Can change if the window was resized or moved between displays
+	if (!surface) {
+		return;
+	}
+
+	// Draw straight into the window when it's 32-bit and big enough, otherwise draw aside and let SDL convert
+	bool direct = surface->format->BytesPerPixel == 4 && surface->w >= static_cast<int>(software->Width()) && surface->h >= static_cast<int>(software->Height());
+	if (!direct && !staging) {
+		staging = SDL_CreateRGBSurfaceWithFormat(0, software->Width(), software->Height(), 32, SDL_PIXELFORMAT_ARGB8888);
+	}
+
+	SDL_Surface* target = direct ? surface : staging;
+	SDL_LockSurface(target);
+	software->Render(video, static_cast<uint32_t*>(target->pixels), target->pitch);
+	SDL_UnlockSurface(target);
+
+	if (!direct) {
+		SDL_BlitScaled(staging, nullptr, surface, nullptr);
+	}
+	SDL_UpdateWindowSurface(window);
+}
+
+bool Platform::OpenAudio(Beeper::Ring& ring) {
+	SDL_AudioSpec want{};
+	want.freq = Beeper::SAMPLE_RATE;
+	want.format = AUDIO_S16SYS;
+	want.channels = 1;
+	want.samples = Beeper::DEVICE_BUFFER;
+	want.callback = &Platform::AudioCallback;
+	want.userdata = &ring;
+
+	SDL_AudioSpec have;
+	audio_device = SDL_OpenAudioDevice(nullptr, 0, &want, &have, 0); // No changes allowed, SDL converts if the device differs
+	if (!audio_device) {
+		return false;
+	}
+
+	SDL_PauseAudioDevice(audio_device, 0);
+	return true;
+}
+
+void Platform::CloseAudio() {
+	if (audio_device) {
+		SDL_CloseAudioDevice(audio_device); // Waits for a callback in progress to finish
+		audio_device = 0;
+	}
+}
+
+void Platform::AudioCallback(void* ring, uint8_t* stream, int length) {
+	// Runs on SDL's audio thread, the ring's only consumer
+	Beeper::Drain(*static_cast<Beeper::Ring*>(ring), reinterpret_cast<int16_t*>(stream), length / sizeof(int16_t));
+}
+
+void Platform::WaitForEvent() {
+	SDL_WaitEvent(nullptr); // With no event to fill in, SDL leaves it queued
+}
+
+void Platform::Wake() {
+	SDL_Event event{};
+	event.type = SDL_USEREVENT; // ProcessInput() ignores it, it only needs to be in the queue
+	SDL_PushEvent(&event);
+}
+
+// The 1234/QWER/ASDF/ZXCV block of the keyboard is the keypad's 123C/456D/789E/A0BF
+static const SDL_Keycode keymap[KEY_COUNT] = {
+	SDLK_x, SDLK_1, SDLK_2, SDLK_3, SDLK_q, SDLK_w, SDLK_e, SDLK_a,
+	SDLK_s, SDLK_d, SDLK_z, SDLK_c, SDLK_4, SDLK_r, SDLK_f, SDLK_v
+};
+
+bool Platform::ProcessInput(std::vector<KeyEvent>& events) {
 	bool quit = false;
 
 	SDL_Event event;
 
 	while (SDL_PollEvent(&event)) {
+		KeyEvent::Clock::time_point now = KeyEvent::Clock::now(); // We sleep in WaitForEvent(), so this is right when the event came in
+
 		switch (event.type) {
 			case SDL_QUIT:
-            {
+			{
 				quit = true;
 			} break;
 
 			case SDL_KEYDOWN:
-			{
-				switch (event.key.keysym.sym) {
-					case SDLK_ESCAPE:
-					{
-						quit = true;
-					} break;
-
-					case SDLK_x:
-					{
-						keys[0] = 1;
-					} break;
-
-					case SDLK_1:
-					{
-						keys[1] = 1;
-					} break;
-
-					case SDLK_2:
-					{
-						keys[2] = 1;
-					} break;
-
-					case SDLK_3:
-					{
-						keys[3] = 1;
-					} break;
-
-					case SDLK_q:
-					{
-						keys[4] = 1;
-					} break;
-
-					case SDLK_w:
-					{
-						keys[5] = 1;
-					} break;
-
-					case SDLK_e:
-					{
-						keys[6] = 1;
-					} break;
-
-					case SDLK_a:
-					{
-						keys[7] = 1;
-					} break;
-
-					case SDLK_s:
-					{
-						keys[8] = 1;
-					} break;
-
-					case SDLK_d:
-					{
-						keys[9] = 1;
-					} break;
-
-					case SDLK_z:
-					{
-						keys[0xA] = 1;
-					} break;
-
-					case SDLK_c:
-					{
-						keys[0xB] = 1;
-					} break;
-
-					case SDLK_4:
-					{
-						keys[0xC] = 1;
-					} break;
-
-					case SDLK_r:
-					{
-						keys[0xD] = 1;
-					} break;
-
-					case SDLK_f:
-					{
-						keys[0xE] = 1;
-					} break;
-
-					case SDLK_v:
-					{
-						keys[0xF] = 1;
-					} break;
-				}
-			} break;
-
 			case SDL_KEYUP:
 			{
-				switch (event.key.keysym.sym) {
-					case SDLK_x:
-					{
-						keys[0] = 0;
-					} break;
-
-					case SDLK_1:
-					{
-						keys[1] = 0;
-					} break;
-
-					case SDLK_2:
-					{
-						keys[2] = 0;
-					} break;
-
-					case SDLK_3:
-					{
-						keys[3] = 0;
-					} break;
-
-					case SDLK_q:
-					{
-						keys[4] = 0;
-					} break;
-
-					case SDLK_w:
-					{
-						keys[5] = 0;
-					} break;
-
-					case SDLK_e:
-					{
-						keys[6] = 0;
-					} break;
-
-					case SDLK_a:
-					{
-						keys[7] = 0;
-					} break;
-
-					case SDLK_s:
-					{
-						keys[8] = 0;
-					} break;
-
-					case SDLK_d:
-					{
-						keys[9] = 0;
-					} break;
-
-					case SDLK_z:
-					{
-						keys[0xA] = 0;
-					} break;
-
-					case SDLK_c:
-					{
-						keys[0xB] = 0;
-					} break;
-
-					case SDLK_4:
-					{
-						keys[0xC] = 0;
-					} break;
-
-					case SDLK_r:
-					{
-						keys[0xD] = 0;
-					} break;
-
-					case SDLK_f:
-					{
-						keys[0xE] = 0;
-					} break;
-
-					case SDLK_v:
-					{
-						keys[0xF] = 0;
-					} break;
+				bool pressed = event.type == SDL_KEYDOWN;
+				SDL_Keycode sym = event.key.keysym.sym;
+
+				if (sym == SDLK_ESCAPE) {
+					quit |= pressed;
+				}
+				else if (sym == SDLK_BACKSPACE) {
+					rewinding = pressed;
+				}
+				else if (!event.key.repeat) {
+					for (unsigned int key = 0; key < KEY_COUNT; key++) {
+						if (keymap[key] == sym) {
+							events.push_back({now, static_cast<uint8_t>(key), pressed});
+						}
+					}
 				}
 			} break;
 		}
 	}
 
 	return quit;
-}
\ No newline at end of file
+}
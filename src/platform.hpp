@@ -1,22 +1,50 @@
 #pragma once
 
+#include <beeper.hpp>
+#include <renderer.hpp>
+#include <chrono>
 #include <cstdint>
+#include <vector>
 
 
 class SDL_Window;
 class SDL_Renderer;
 class SDL_Texture;
+class SDL_Surface;
+
+
+// A keypad change, stamped with the host time it came in
+struct KeyEvent {
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point time;
+	uint8_t key; // Keypad key (0x0 - 0xF)
+	bool pressed;
+};
 
 
 class Platform {
 public:
 	Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight);
+	Platform(char const* title, SoftwareRenderer const& renderer); // CPU drawing straight into the window surface, sized to the renderer's output: no GPU, works with SDL's offscreen and dummy drivers
 	~Platform();
-	void Update(void const* buffer, int pitch);
-	bool ProcessInput(uint8_t* keys);
+	void Update(void const* buffer, int pitch); // Texture mode: upload a textureWidth x textureHeight RGBA frame and let the GPU scale it
+	void Present(Display const& video); // Software mode: draw the display with the renderer and show it
+	bool ProcessInput(std::vector<KeyEvent>& events); // Append keypad changes in the order they happened, true once the user quits
+	void WaitForEvent(); // Block until there's input for ProcessInput() (it's left in the queue), or Wake() is called
+	static void Wake(); // Safe from any thread: end a WaitForEvent() on the SDL thread
+	bool OpenAudio(Beeper::Ring& ring); // Start playing whatever a Beeper pushes into ring, false if there's no audio device
+	void CloseAudio(); // Stop the callback, call it before the ring goes away
+	bool Rewinding() const { return rewinding; } // Backspace is held
 
 private:
 	SDL_Window* window{};
 	SDL_Renderer* renderer{};
 	SDL_Texture* texture{};
+	SoftwareRenderer const* software{}; // Set in software mode
+	SDL_Surface* staging{}; // Software mode, only if the window surface isn't 32-bit
+	bool rewinding{};
+	uint32_t audio_device{}; // SDL_AudioDeviceID, 0 until OpenAudio()
+
+	static void AudioCallback(void* ring, uint8_t* stream, int length);
 };
\ No newline at end of file
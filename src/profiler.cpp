@@ -0,0 +1,198 @@
+#include <profiler.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+static char const* const op_names[Profiler::OP_COUNT] = {
+    "NULL", "00E0", "00EE", "1nnn", "2nnn", "3xkk", "4xkk", "5xy0", "6xkk", "7xkk",
+    "8xy0", "8xy1", "8xy2", "8xy3", "8xy4", "8xy5", "8xy6", "8xy7", "8xyE", "9xy0",
+    "Annn", "Bnnn", "Cxkk", "Dxyn", "Ex9E", "ExA1", "Fx07", "Fx0A", "Fx15", "Fx18",
+    "Fx1E", "Fx29", "Fx33", "Fx55", "Fx65",
+    "00Cn", "00Dn", "00FB", "00FC", "00FD", "00FE", "00FF", "5xy2", "5xy3", "F000",
+    "Fn01", "F002", "Fx30", "Fx3A", "Fx75", "Fx85"
+};
+
+static std::string Hex(uint16_t value) {
+    char text[8];
+    std::snprintf(text, sizeof(text), "0x%03X", value);
+    return text;
+}
+
+Profiler::Profiler() : pcs(XO_MEMORY_SIZE) {
+    frames.push_back({0, PROGRAM_ADDRESS, 0});
+}
+
+char const* Profiler::Name(Op op) {
+    return op < OP_COUNT ? op_names[op] : "?";
+}
+
+Profiler::Op Profiler::Classify(uint16_t opcode) {
+    // Mirrors Chip8::Generic()
+    switch(opcode >> 12u) {
+        case 0x0: // The SUPER-CHIP ones, otherwise only the last nibble is decoded
+            if((opcode & 0xFFF0u) == 0x00C0u) return OP_00Cn;
+            if((opcode & 0xFFF0u) == 0x00D0u) return OP_00Dn;
+            switch(opcode) {
+                case 0x00FB: return OP_00FB;
+                case 0x00FC: return OP_00FC;
+                case 0x00FD: return OP_00FD;
+                case 0x00FE: return OP_00FE;
+                case 0x00FF: return OP_00FF;
+            }
+            switch(opcode & 0xFu) {
+                case 0x0: return OP_00E0;
+                case 0xE: return OP_00EE;
+                default: return OP_NULL;
+            }
+        case 0x1: return OP_1nnn;
+        case 0x2: return OP_2nnn;
+        case 0x3: return OP_3xkk;
+        case 0x4: return OP_4xkk;
+        case 0x5:
+            switch(opcode & 0xFu) {
+                case 0x2: return OP_5xy2;
+                case 0x3: return OP_5xy3;
+                default: return OP_5xy0;
+            }
+        case 0x6: return OP_6xkk;
+        case 0x7: return OP_7xkk;
+        case 0x8:
+            switch(opcode & 0xFu) {
+                case 0x0: return OP_8xy0;
+                case 0x1: return OP_8xy1;
+                case 0x2: return OP_8xy2;
+                case 0x3: return OP_8xy3;
+                case 0x4: return OP_8xy4;
+                case 0x5: return OP_8xy5;
+                case 0x6: return OP_8xy6;
+                case 0x7: return OP_8xy7;
+                case 0xE: return OP_8xyE;
+                default: return OP_NULL;
+            }
+        case 0x9: return OP_9xy0;
+        case 0xA: return OP_Annn;
+        case 0xB: return OP_Bnnn;
+        case 0xC: return OP_Cxkk;
+        case 0xD: return OP_Dxyn;
+        case 0xE:
+            switch(opcode & 0xFu) {
+                case 0x1: return OP_ExA1;
+                case 0xE: return OP_Ex9E;
+                default: return OP_NULL;
+            }
+        default:
+            switch(opcode & 0xFFu) {
+                case 0x00: return opcode == 0xF000u ? OP_F000 : OP_NULL;
+                case 0x01: return OP_Fn01;
+                case 0x02: return opcode == 0xF002u ? OP_F002 : OP_NULL;
+                case 0x07: return OP_Fx07;
+                case 0x0A: return OP_Fx0A;
+                case 0x15: return OP_Fx15;
+                case 0x18: return OP_Fx18;
+                case 0x1E: return OP_Fx1E;
+                case 0x29: return OP_Fx29;
+                case 0x30: return OP_Fx30;
+                case 0x33: return OP_Fx33;
+                case 0x3A: return OP_Fx3A;
+                case 0x55: return OP_Fx55;
+                case 0x65: return OP_Fx65;
+                case 0x75: return OP_Fx75;
+                case 0x85: return OP_Fx85;
+                default: return OP_NULL;
+            }
+    }
+}
+
+void Profiler::Instruction(uint16_t pc, uint16_t opcode) {
+    Op op = Classify(opcode);
+
+    instructions++;
+    opcodes[op]++;
+    pcs[pc]++;
+    frames[current].self++;
+
+    if(op == OP_1nnn && (opcode & 0x0FFFu) <= pc) { // Backward jump, the end of a loop
+        loops[std::make_pair(pc, static_cast<uint16_t>(opcode & 0x0FFFu))]++;
+    }
+    else if(op == OP_2nnn) {
+        uint16_t address = opcode & 0x0FFFu;
+        auto child = children.find(std::make_pair(current, address));
+
+        if(child == children.end()) {
+            frames.push_back({current, address, 0});
+            child = children.emplace(std::make_pair(current, address), static_cast<uint32_t>(frames.size() - 1)).first;
+        }
+        current = child->second;
+    }
+    else if(op == OP_00EE) {
+        current = frames[current].parent; // The root is its own parent, so a stray RET stays put
+    }
+}
+
+void Profiler::Draw(unsigned int pixels, bool collided) {
+    draws++;
+    draw_pixels += pixels;
+    collisions += collided;
+}
+
+void Profiler::WriteJson(std::ostream& out) const {
+    out << "{\n  \"instructions\": " << instructions << ",\n";
+
+    out << "  \"opcodes\": {";
+    bool first = true;
+    for(unsigned int op = 0; op < OP_COUNT; op++) {
+        if(opcodes[op]) {
+            out << (first ? "" : ",") << "\n    \"" << op_names[op] << "\": " << opcodes[op];
+            first = false;
+        }
+    }
+    out << "\n  },\n";
+
+    // Hottest PCs first
+    std::vector<uint16_t> hot;
+    for(unsigned int pc = 0; pc < XO_MEMORY_SIZE; pc++) {
+        if(pcs[pc]) hot.push_back(pc);
+    }
+    std::stable_sort(hot.begin(), hot.end(), [this](uint16_t a, uint16_t b) { return pcs[a] > pcs[b]; });
+
+    out << "  \"pcs\": [";
+    for(size_t i = 0; i < hot.size(); i++) {
+        out << (i ? "," : "") << "\n    {\"pc\": \"" << Hex(hot[i]) << "\", \"count\": " << pcs[hot[i]] << "}";
+    }
+    out << "\n  ],\n";
+
+    out << "  \"draws\": {\"count\": " << draws << ", \"pixels\": " << draw_pixels << ", \"collisions\": " << collisions
+        << ", \"collision_rate\": " << (draws ? static_cast<double>(collisions) / draws : 0.0) << "},\n";
+
+    std::vector<std::pair<std::pair<uint16_t, uint16_t>, uint64_t>> hot_loops(loops.begin(), loops.end());
+    std::stable_sort(hot_loops.begin(), hot_loops.end(), [](std::pair<std::pair<uint16_t, uint16_t>, uint64_t> const& a, std::pair<std::pair<uint16_t, uint16_t>, uint64_t> const& b) {
+        return a.second > b.second;
+    });
+
+    out << "  \"loops\": [";
+    for(size_t i = 0; i < hot_loops.size(); i++) {
+        out << (i ? "," : "") << "\n    {\"from\": \"" << Hex(hot_loops[i].first.first) << "\", \"to\": \"" << Hex(hot_loops[i].first.second)
+            << "\", \"count\": " << hot_loops[i].second << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void Profiler::WriteFolded(std::ostream& out) const {
+    for(uint32_t frame = 0; frame < frames.size(); frame++) {
+        if(!frames[frame].self) {
+            continue;
+        }
+
+        // Walk up to the root, then print root first
+        std::vector<uint16_t> path;
+        for(uint32_t f = frame; f != 0; f = frames[f].parent) {
+            path.push_back(frames[f].address);
+        }
+
+        out << "main";
+        for(auto address = path.rbegin(); address != path.rend(); ++address) {
+            out << ";sub_" << Hex(*address);
+        }
+        out << " " << frames[frame].self << "\n";
+    }
+}
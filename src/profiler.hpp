@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+
+/**
+ * Profiler
+ * Only wired into builds configured with -DCHIP8_PROFILE=ON, every other build
+ * compiles the hooks out entirely. While a Profiler is attached (Chip8::SetProfiler)
+ * the interpreter reports every instruction it runs, and gathers:
+ *   - executions per opcode (one bucket per OP_* handler) and per PC
+ *   - Dxyn draws: pixels drawn and how many draws collided
+ *   - hot loops: backward 1nnn jumps, counted per (from, to) pair
+ *   - a call tree built from 2nnn/00EE, with the instructions run in each frame
+ * The results dump to JSON, and the call tree to the folded-stack format that
+ * flamegraph.pl and speedscope read.
+ */
+class Profiler {
+    public:
+        enum Op {
+            OP_NULL, OP_00E0, OP_00EE, OP_1nnn, OP_2nnn, OP_3xkk, OP_4xkk, OP_5xy0, OP_6xkk, OP_7xkk,
+            OP_8xy0, OP_8xy1, OP_8xy2, OP_8xy3, OP_8xy4, OP_8xy5, OP_8xy6, OP_8xy7, OP_8xyE, OP_9xy0,
+            OP_Annn, OP_Bnnn, OP_Cxkk, OP_Dxyn, OP_Ex9E, OP_ExA1, OP_Fx07, OP_Fx0A, OP_Fx15, OP_Fx18,
+            OP_Fx1E, OP_Fx29, OP_Fx33, OP_Fx55, OP_Fx65,
+            OP_00Cn, OP_00Dn, OP_00FB, OP_00FC, OP_00FD, OP_00FE, OP_00FF, OP_5xy2, OP_5xy3, OP_F000,
+            OP_Fn01, OP_F002, OP_Fx30, OP_Fx3A, OP_Fx75, OP_Fx85,
+            OP_COUNT
+        };
+
+        Profiler();
+
+        void Instruction(uint16_t pc, uint16_t opcode); // Called before each instruction executes
+        void Draw(unsigned int pixels, bool collided); // Called by every Dxyn
+
+        uint64_t Instructions() const { return instructions; }
+        void WriteJson(std::ostream& out) const;
+        void WriteFolded(std::ostream& out) const; // One "frame;frame;frame count" line per call stack
+
+        static Op Classify(uint16_t opcode); // Which OP_* handler runs an opcode
+        static char const* Name(Op op);
+
+    private:
+        // Call tree node: a subroutine entry address, reached through its parent
+        struct Frame {
+            uint32_t parent;
+            uint16_t address; // Subroutine address (PROGRAM_ADDRESS for the root)
+            uint64_t self; // Instructions run in this frame itself
+        };
+
+        uint64_t instructions{};
+        uint64_t opcodes[OP_COUNT]{};
+        std::vector<uint64_t> pcs; // Executions per address, all XO_MEMORY_SIZE of them so XO-CHIP code past 4 KB counts where it ran
+        uint64_t draws{};
+        uint64_t draw_pixels{};
+        uint64_t collisions{};
+        std::map<std::pair<uint16_t, uint16_t>, uint64_t> loops; // (from, to) -> times taken
+
+        std::vector<Frame> frames; // frames[0] is the root
+        std::map<std::pair<uint32_t, uint16_t>, uint32_t> children; // (parent, address) -> frame
+        uint32_t current{}; // Frame we're in, 00EE goes back to its parent
+};
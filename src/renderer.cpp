@@ -0,0 +1,293 @@
+#include <renderer.hpp>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CHIP8_RENDERER_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * Expand kernels
+ * Bits to pixels: pixel i of a row is bit 63 - (i % 64) of word i / 64, on or off color.
+ */
+
+namespace scalar {
+    void Expand(uint64_t const* bits, unsigned int words, uint32_t on, uint32_t off, uint32_t* out) {
+        for(unsigned int w = 0; w < words; w++) {
+            for(int bit = 63; bit >= 0; bit--) {
+                *out++ = (bits[w] >> bit) & 1 ? on : off;
+            }
+        }
+    }
+}
+
+#ifdef CHIP8_RENDERER_X86
+
+// SSE2 is part of x86-64, no dispatch needed
+namespace sse2 {
+    void Expand(uint64_t const* bits, unsigned int words, uint32_t on, uint32_t off, uint32_t* out) {
+        __m128i const high = _mm_set_epi32(0x10, 0x20, 0x40, 0x80); // Lanes are stored low first, so the MSB goes in lane 0
+        __m128i const low = _mm_set_epi32(0x01, 0x02, 0x04, 0x08);
+        __m128i const on_v = _mm_set1_epi32(static_cast<int>(on));
+        __m128i const off_v = _mm_set1_epi32(static_cast<int>(off));
+
+        for(unsigned int w = 0; w < words; w++) {
+            for(int shift = 56; shift >= 0; shift -= 8) {
+                __m128i byte = _mm_set1_epi32(static_cast<int>((bits[w] >> shift) & 0xFF));
+                __m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(byte, high), high);
+                __m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(byte, low), low);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_or_si128(_mm_and_si128(m0, on_v), _mm_andnot_si128(m0, off_v)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_or_si128(_mm_and_si128(m1, on_v), _mm_andnot_si128(m1, off_v)));
+                out += 8;
+            }
+        }
+    }
+}
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+// AVX2: a whole byte's 8 pixels per store
+namespace avx2 {
+    void Expand(uint64_t const* bits, unsigned int words, uint32_t on, uint32_t off, uint32_t* out) {
+        __m256i const lanes = _mm256_set_epi32(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80);
+        __m256i const on_v = _mm256_set1_epi32(static_cast<int>(on));
+        __m256i const off_v = _mm256_set1_epi32(static_cast<int>(off));
+
+        for(unsigned int w = 0; w < words; w++) {
+            for(int shift = 56; shift >= 0; shift -= 8) {
+                __m256i byte = _mm256_set1_epi32(static_cast<int>((bits[w] >> shift) & 0xFF));
+                __m256i m = _mm256_cmpeq_epi32(_mm256_and_si256(byte, lanes), lanes);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_blendv_epi8(off_v, on_v, m));
+                out += 8;
+            }
+        }
+    }
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif // CHIP8_RENDERER_X86
+
+/**
+ * SoftwareRenderer
+ */
+
+SoftwareRenderer::SoftwareRenderer(Options const& options)
+: options(options), palette{options.off_color, options.on_color, options.plane1_color, options.both_color} {
+    for(unsigned int i = 0; i < 4; i++) {
+        dim_palette[i] = Dim(palette[i], options.scanline);
+    }
+    SetIsa(BestIsa());
+}
+
+bool SoftwareRenderer::Valid() const {
+    return options.scale >= 1 && options.scale <= MAX_SCALE && (!options.scale2x || options.scale % 2 == 0) && options.scanline <= 100;
+}
+
+SoftwareRenderer::Isa SoftwareRenderer::BestIsa() {
+#ifdef CHIP8_RENDERER_X86
+    if(__builtin_cpu_supports("avx2")) {
+        return Isa::Avx2;
+    }
+    return Isa::Sse2;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+bool SoftwareRenderer::SetIsa(Isa isa) {
+    if(isa > BestIsa()) {
+        return false;
+    }
+
+    this->isa = isa;
+
+    switch(isa) {
+#ifdef CHIP8_RENDERER_X86
+        case Isa::Avx2: expand = &avx2::Expand; break;
+        case Isa::Sse2: expand = &sse2::Expand; break;
+#endif
+        default: expand = &scalar::Expand; break;
+    }
+
+    return true;
+}
+
+void SoftwareRenderer::Render(Display const& video, uint32_t* out, size_t pitch) const {
+    uint64_t scratch[VIDEO_PLANES][VIDEO_WORDS]; // Scale2x or downsampled rows
+    uint64_t const* rows[VIDEO_PLANES] = {video.planes[0], video.planes[1]};
+    unsigned int row_count = VIDEO_HEIGHT;
+    unsigned int words = 1; // Per source row
+    unsigned int factor = options.scale; // Output rows (and columns) per source row
+
+    bool color = false; // Plane 1 has something on it, so pixels take one of four colors
+    for(unsigned int i = 0; i < video.Words() && !color; i++) {
+        color = video.planes[1][i] != 0;
+    }
+
+    if(video.hires && options.scale % 2 == 0) { // Half the scale, and the same output size
+        row_count = HIRES_HEIGHT;
+        words = 2;
+        factor /= 2;
+    }
+    else if(video.hires) { // An odd scale can't give a hires pixel half of a low resolution one
+        for(unsigned int plane = 0; plane < VIDEO_PLANES; plane++) {
+            Downsample(video.planes[plane], scratch[plane]);
+            rows[plane] = scratch[plane];
+        }
+    }
+    else if(options.scale2x && !color) {
+        Scale2x(video.planes[0], scratch[0]);
+        rows[0] = scratch[0];
+        row_count *= 2;
+        words = 2;
+        factor /= 2;
+    }
+
+    // The bottom third of each CHIP-8 pixel's rows (at least one) are scanline rows, unless it's one row high
+    unsigned int dim_rows = options.scanline < 100 && options.scale > 1 ? std::max(1u, options.scale / 3) : 0;
+    size_t row_bytes = sizeof(uint32_t) * Width();
+    uint64_t stretched[VIDEO_PLANES][MAX_SCALE]; // One row of bits per plane, Width() / 64 words
+
+    for(unsigned int r = 0; r < row_count; r++) {
+        Stretch(rows[0] + r * words, words, factor, stretched[0]);
+        if(color) {
+            Stretch(rows[1] + r * words, words, factor, stretched[1]);
+        }
+
+        uint8_t const* bright = nullptr; // This row's first output row in each color pair, the rest are copies
+        uint8_t const* dim = nullptr;
+
+        for(unsigned int y = r * factor; y < (r + 1) * factor; y++) {
+            uint8_t* line = reinterpret_cast<uint8_t*>(out) + y * pitch;
+            bool scanline = y % options.scale >= options.scale - dim_rows;
+            uint8_t const*& first = scanline ? dim : bright;
+
+            uint32_t const* colors = scanline ? dim_palette : palette;
+
+            if(first) {
+                memcpy(line, first, row_bytes);
+            }
+            else if(color) {
+                ExpandColors(stretched[0], stretched[1], words * factor, colors, reinterpret_cast<uint32_t*>(line));
+                first = line;
+            }
+            else {
+                expand(stretched[0], words * factor, colors[1], colors[0], reinterpret_cast<uint32_t*>(line));
+                first = line;
+            }
+        }
+    }
+}
+
+uint32_t SoftwareRenderer::Dim(uint32_t color, unsigned int percent) {
+    uint32_t dimmed = 0;
+    for(unsigned int shift = 0; shift < 32; shift += 8) {
+        dimmed |= (((color >> shift) & 0xFF) * percent / 100) << shift;
+    }
+    return dimmed;
+}
+
+void SoftwareRenderer::Scale2x(uint64_t const* video, uint64_t* doubled) {
+    // Spread the 32 bits of x out to the even bits of the result
+    auto spread = [](uint64_t x) {
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x << 2)) & 0x3333333333333333ull;
+        x = (x | (x << 1)) & 0x5555555555555555ull;
+        return x;
+    };
+
+    for(unsigned int y = 0; y < VIDEO_HEIGHT; y++) {
+        // EPX names: B above, D left, E the pixel, F right, H below, edges repeat. Every pixel of the row at once.
+        uint64_t e = video[y];
+        uint64_t b = video[y ? y - 1 : 0];
+        uint64_t h = video[y + 1 < VIDEO_HEIGHT ? y + 1 : y];
+        uint64_t d = (e >> 1) | (e & (1ull << 63)); // Pixel 0 is the MSB, so its left neighbour is one bit up
+        uint64_t f = (e << 1) | (e & 1);
+
+        // Each corner takes the neighbour's color where two neighbours agree and the other two don't
+        uint64_t c0 = ~(d ^ b) & (b ^ f) & (d ^ h); // Top left
+        uint64_t c1 = ~(b ^ f) & (b ^ d) & (f ^ h); // Top right
+        uint64_t c2 = ~(d ^ h) & (d ^ b) & (h ^ f); // Bottom left
+        uint64_t c3 = ~(h ^ f) & (d ^ h) & (b ^ f); // Bottom right
+        uint64_t e0 = (c0 & d) | (~c0 & e);
+        uint64_t e1 = (c1 & f) | (~c1 & e);
+        uint64_t e2 = (c2 & d) | (~c2 & e);
+        uint64_t e3 = (c3 & f) | (~c3 & e);
+
+        // Interleave: left corners land on even output pixels, which are the odd bits counting from the MSB
+        uint64_t* top = doubled + y * 4;
+        top[0] = spread(e0 >> 32) << 1 | spread(e1 >> 32);
+        top[1] = spread(e0 & 0xFFFFFFFF) << 1 | spread(e1 & 0xFFFFFFFF);
+        top[2] = spread(e2 >> 32) << 1 | spread(e3 >> 32);
+        top[3] = spread(e2 & 0xFFFFFFFF) << 1 | spread(e3 & 0xFFFFFFFF);
+    }
+}
+
+void SoftwareRenderer::Downsample(uint64_t const* hires, uint64_t* lores) {
+    // ORs each pair of pixels in a word, then gathers the 32 results into the top half, leftmost pixel first
+    auto squeeze = [](uint64_t x) {
+        x = ((x | (x << 1)) >> 1) & 0x5555555555555555ull; // Pair i lands on bit 2 * (31 - i)
+        x = (x | (x >> 1)) & 0x3333333333333333ull;
+        x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+        return x;
+    };
+
+    for(unsigned int y = 0; y < VIDEO_HEIGHT; y++) {
+        uint64_t left = hires[4 * y] | hires[4 * y + 2]; // Rows 2y and 2y + 1 together
+        uint64_t right = hires[4 * y + 1] | hires[4 * y + 3];
+        lores[y] = squeeze(left) << 32 | squeeze(right);
+    }
+}
+
+void SoftwareRenderer::ExpandColors(uint64_t const* plane0, uint64_t const* plane1, unsigned int words, uint32_t const* palette, uint32_t* out) {
+    for(unsigned int w = 0; w < words; w++) {
+        for(int bit = 63; bit >= 0; bit--) {
+            *out++ = palette[((plane1[w] >> bit) & 1) << 1 | ((plane0[w] >> bit) & 1)];
+        }
+    }
+}
+
+void SoftwareRenderer::Stretch(uint64_t const* bits, unsigned int words, unsigned int factor, uint64_t* out) {
+    if(factor == 1) {
+        std::copy(bits, bits + words, out);
+        return;
+    }
+
+    std::fill(out, out + words * factor, 0);
+
+    for(unsigned int w = 0; w < words; w++) {
+        for(uint64_t rest = bits[w]; rest; rest &= rest - 1) { // Only the lit pixels, lowest bit (rightmost pixel) first
+            unsigned int pixel = w * 64 + 63 - __builtin_ctzll(rest);
+            unsigned int start = pixel * factor;
+            unsigned int end = start + factor; // One past the last output bit, a run covers at most two words
+
+            unsigned int first = start / 64;
+            unsigned int last = (end - 1) / 64;
+            uint64_t head = ~0ull >> (start % 64);
+            uint64_t tail = ~0ull << (63 - (end - 1) % 64);
+            if(first == last) {
+                out[first] |= head & tail;
+            }
+            else {
+                out[first] |= head;
+                out[last] |= tail;
+            }
+        }
+    }
+}
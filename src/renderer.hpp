@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * Software renderer
+ * Draws the packed 1-bpp display (Chip8::video) straight into 32-bit pixels at an integer
+ * scale, with no GPU involved. Each source row is stretched horizontally as bits, then a
+ * SIMD kernel (SSE2 or AVX2, picked at runtime) turns every byte of bits into 8 pixels with
+ * a compare and a blend. The other rows of the scaled row are memcpy'd copies of the first.
+ * The output is always 64x32 CHIP-8 pixels at the scale. A 128x64 high resolution screen
+ * takes half a scale per pixel, or at an odd scale is ORed down 2x2 to 64x32. A screen with
+ * anything on XO-CHIP's second plane goes through a scalar four color kernel instead.
+ * Options:
+ *   - scale2x: EPX/Scale2x smoothing, done on whole 64-pixel rows with bitwise ops before scaling (needs an even scale, low resolution one plane screens only)
+ *   - scanline: brightness (percent) of the bottom third of every scaled row, a cheap CRT look (100 = off).
+ *     Those rows are drawn with dimmed colors, so the filter costs nothing per pixel.
+ * Colors are raw 32-bit values, so they mean whatever the output's pixel format says
+ * (white and black read the same in all of them).
+ */
+class SoftwareRenderer {
+    public:
+        enum class Isa {
+            Scalar, // Plain loop, works everywhere
+            Sse2, // 4 pixels per store
+            Avx2 // 8 pixels per store
+        };
+
+        struct Options {
+            unsigned int scale{1}; // Output pixels per CHIP-8 pixel, in each direction
+            bool scale2x{}; // Smooth diagonals with Scale2x first
+            unsigned int scanline{100}; // Brightness of the scanline rows, in percent
+            uint32_t on_color{0xFFFFFFFF};
+            uint32_t off_color{0x00000000};
+            uint32_t plane1_color{0xAAAAAAAA}; // XO-CHIP: on in plane 1 only
+            uint32_t both_color{0x55555555}; // XO-CHIP: on in both planes
+        };
+
+        explicit SoftwareRenderer(Options const& options); // Options are checked by Valid()
+
+        static const unsigned int MAX_SCALE = 64;
+
+        bool Valid() const; // Scale is 1-MAX_SCALE (and even with scale2x), scanline is 0-100
+        unsigned int Width() const { return VIDEO_WIDTH * options.scale; }
+        unsigned int Height() const { return VIDEO_HEIGHT * options.scale; }
+        void Render(Display const& video, uint32_t* out, size_t pitch) const; // pitch is in bytes, out holds Height() rows of Width() pixels
+
+        static Isa BestIsa();
+        bool SetIsa(Isa isa); // False if this host can't run it
+        Isa GetIsa() const { return isa; }
+
+    private:
+        typedef void (*ExpandFunc)(uint64_t const* bits, unsigned int words, uint32_t on, uint32_t off, uint32_t* out);
+
+        Options options;
+        uint32_t palette[4]; // By pixel value (plane 1 bit << 1 | plane 0 bit)
+        uint32_t dim_palette[4]; // Scanline colors
+        Isa isa;
+        ExpandFunc expand; // Bits to pixels, 64 per word, MSB first
+
+        static uint32_t Dim(uint32_t color, unsigned int percent);
+        static void Scale2x(uint64_t const* video, uint64_t* doubled); // 64x32 -> 128x64, two words per row
+        static void Downsample(uint64_t const* hires, uint64_t* lores); // 128x64 -> 64x32, a pixel is on if any of its 2x2 block is
+        static void ExpandColors(uint64_t const* plane0, uint64_t const* plane1, unsigned int words, uint32_t const* palette, uint32_t* out); // Two planes to pixels
+        static void Stretch(uint64_t const* bits, unsigned int words, unsigned int factor, uint64_t* out); // Repeat every bit factor times
+};
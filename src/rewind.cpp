@@ -0,0 +1,195 @@
+#include <rewind.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Encoding: a list of (zero run, literal run) pairs, both as LEB128 varints, each
+ * literal run followed by its XOR bytes. Zero gaps shorter than MIN_ZERO_RUN stay
+ * inside the literal, a new pair would cost more than the bytes it skips.
+ */
+
+static const size_t MIN_ZERO_RUN = 4;
+
+static void PutVarint(std::vector<uint8_t>& out, size_t value) {
+    while(value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static size_t GetVarint(uint8_t const*& in, uint8_t const* end) {
+    size_t value = 0;
+    unsigned int shift = 0;
+    uint8_t byte;
+
+    do {
+        if(in == end || shift > 28) {
+            return SIZE_MAX; // Truncated or far too long, no valid run is this big
+        }
+        byte = *in++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while(byte & 0x80);
+
+    return value;
+}
+
+RewindBuffer::RewindBuffer(size_t max_bytes, unsigned int keyframe_interval)
+: max_bytes(max_bytes), keyframe_interval(std::max(1u, keyframe_interval)) {
+}
+
+void RewindBuffer::Encode(uint8_t const* a, uint8_t const* b, std::vector<uint8_t>& out, size_t size) {
+    auto diff = [&](size_t i) -> uint8_t { return b ? a[i] ^ b[i] : a[i]; };
+    size_t i = 0;
+
+    while(i < size) {
+        size_t zeros = i;
+        while(zeros + 8 <= size && (b ? !memcmp(a + zeros, b + zeros, 8) : !(a[zeros] | a[zeros + 1] | a[zeros + 2] | a[zeros + 3] | a[zeros + 4] | a[zeros + 5] | a[zeros + 6] | a[zeros + 7]))) {
+            zeros += 8; // Skip identical stretches a word at a time
+        }
+        while(zeros < size && !diff(zeros)) {
+            zeros++;
+        }
+        if(zeros == size) {
+            break; // Nothing left to record
+        }
+
+        // The literal runs until the next zero run worth skipping (or the end)
+        size_t literal = zeros;
+        while(literal < size) {
+            if(diff(literal)) {
+                literal++;
+                continue;
+            }
+
+            size_t run = 0;
+            while(literal + run < size && run < MIN_ZERO_RUN && !diff(literal + run)) {
+                run++;
+            }
+            if(run == MIN_ZERO_RUN || literal + run == size) {
+                break;
+            }
+            literal += run; // Too short to skip, keep it in the literal
+        }
+
+        PutVarint(out, zeros - i);
+        PutVarint(out, literal - zeros);
+        for(size_t j = zeros; j < literal; j++) out.push_back(diff(j));
+
+        i = literal;
+    }
+}
+
+void RewindBuffer::Apply(uint8_t const* data, uint8_t const* data_end, uint8_t* state, size_t size) {
+    size_t i = 0;
+
+    while(data < data_end) {
+        size_t zeros = GetVarint(data, data_end);
+        size_t literal = GetVarint(data, data_end);
+
+        // A damaged delta (e.g. read back from disk) never writes past the state
+        if(zeros > size - i || literal > size - i - zeros || literal > static_cast<size_t>(data_end - data)) {
+            return;
+        }
+        i += zeros;
+
+        for(size_t j = 0; j < literal; j++) state[i + j] ^= data[j];
+        data += literal;
+        i += literal;
+    }
+}
+
+void RewindBuffer::Push(Chip8 const& chip8) {
+    size_t size = chip8.SaveState(current);
+    size_t span = std::max(size, previous_size); // States change size when a ROM leaves classic CHIP-8 (or a load goes back)
+    memset(current + size, 0, span - size);
+
+    if(segments.empty() || segments.back().offsets.size() >= keyframe_interval) {
+        segments.emplace_back();
+        segments.back().first = end;
+        segments.back().offsets.push_back(0);
+        Encode(current, nullptr, segments.back().data, size); // Keyframe
+    }
+    else {
+        Segment& segment = segments.back();
+        size_t before = segment.data.size();
+        segment.offsets.push_back(before);
+        Encode(current, previous, segment.data, span);
+    }
+
+    bytes += segments.back().data.size() - segments.back().offsets.back();
+    memcpy(previous, current, span);
+    previous_size = size;
+    end++;
+
+    // Over budget: drop the oldest segments, but never the one we're writing to
+    while(bytes > max_bytes && segments.size() > 1) {
+        bytes -= segments.front().data.size();
+        segments.pop_front();
+    }
+}
+
+uint64_t RewindBuffer::First() const {
+    return segments.empty() ? end : segments.front().first;
+}
+
+void RewindBuffer::Decode(uint64_t snapshot, uint8_t* state) const {
+    // Last segment whose keyframe is at or before the snapshot
+    auto segment = std::upper_bound(segments.begin(), segments.end(), snapshot, [](uint64_t s, Segment const& seg) { return s < seg.first; }) - 1;
+    size_t last = snapshot - segment->first;
+
+    memset(state, 0, STATE_SIZE);
+    for(size_t i = 0; i <= last; i++) {
+        size_t stop = i + 1 < segment->offsets.size() ? segment->offsets[i + 1] : segment->data.size();
+        Apply(segment->data.data() + segment->offsets[i], segment->data.data() + stop, state);
+    }
+}
+
+bool RewindBuffer::Restore(uint64_t snapshot, Chip8& chip8) const {
+    if(snapshot < First() || snapshot >= end) {
+        return false;
+    }
+
+    uint8_t state[STATE_SIZE];
+    Decode(snapshot, state);
+
+    return chip8.LoadState(state, STATE_SIZE);
+}
+
+bool RewindBuffer::Rewind(uint64_t frames, Chip8& chip8) {
+    if(frames >= end - First()) {
+        return false;
+    }
+
+    uint64_t snapshot = end - 1 - frames;
+    Decode(snapshot, previous);
+    previous_size = STATE_SIZE; // Zeros past the state itself, so the next delta just covers them once
+    if(!chip8.LoadState(previous, STATE_SIZE)) {
+        return false;
+    }
+
+    // Forget everything newer, the next Push() deltas against the snapshot we went back to
+    while(segments.back().first > snapshot) {
+        bytes -= segments.back().data.size();
+        segments.pop_back();
+    }
+
+    Segment& segment = segments.back();
+    size_t keep = snapshot - segment.first + 1;
+    if(keep < segment.offsets.size()) {
+        bytes -= segment.data.size() - segment.offsets[keep];
+        segment.data.resize(segment.offsets[keep]);
+        segment.offsets.resize(keep);
+    }
+
+    end = snapshot + 1;
+    return true;
+}
+
+void RewindBuffer::Clear() {
+    segments.clear();
+    end = 0;
+    bytes = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+
+/**
+ * Rewind buffer
+ * Keeps a save state for every frame. Snapshots are stored as the XOR against the
+ * snapshot before them, run-length encoded (runs of zero bytes are skipped), so a
+ * frame where a few registers and rows changed costs tens of bytes. Every
+ * KEYFRAME_INTERVAL snapshots a full one (RLE only) starts a new segment, which
+ * bounds how many deltas a restore has to apply and lets the oldest history be
+ * dropped a segment at a time once the byte budget is used up.
+ */
+class RewindBuffer {
+    public:
+        explicit RewindBuffer(size_t max_bytes = 8u << 20, unsigned int keyframe_interval = 256);
+
+        void Push(Chip8 const& chip8); // Record a snapshot, once per frame
+        uint64_t First() const; // Oldest snapshot still held (snapshots are numbered from 0 as they're pushed)
+        uint64_t End() const { return end; } // One past the newest snapshot
+        size_t Bytes() const { return bytes; } // Encoded size of everything held
+
+        bool Restore(uint64_t snapshot, Chip8& chip8) const; // Load a snapshot in [First(), End()) into chip8
+        bool Rewind(uint64_t frames, Chip8& chip8); // Go back to `frames` before the newest snapshot and forget everything after it
+        void Clear();
+
+        static void Encode(uint8_t const* a, uint8_t const* b, std::vector<uint8_t>& out, size_t size = STATE_SIZE); // Append RLE(a XOR b), b = nullptr means zeros
+        static void Apply(uint8_t const* data, uint8_t const* data_end, uint8_t* state, size_t size = STATE_SIZE); // XOR an encoded delta into state
+
+    private:
+        struct Segment {
+            uint64_t first; // Snapshot number of the keyframe
+            std::vector<uint8_t> data; // Keyframe, then one delta per snapshot
+            std::vector<uint32_t> offsets; // Where each snapshot starts in data
+        };
+
+        size_t max_bytes;
+        unsigned int keyframe_interval;
+        std::deque<Segment> segments;
+        uint64_t end{};
+        size_t bytes{};
+        uint8_t previous[STATE_SIZE]{}; // Newest snapshot, decoded, zeros past previous_size
+        size_t previous_size{}; // Bytes SaveState() wrote for it
+        uint8_t current[STATE_SIZE]; // Scratch for the snapshot being pushed
+
+        void Decode(uint64_t snapshot, uint8_t* state) const;
+};
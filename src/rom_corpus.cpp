@@ -0,0 +1,161 @@
+#include <rom_corpus.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+const size_t HEADER_SIZE = 16;
+const size_t ENTRY_SIZE = 32;
+const size_t IMAGE_ALIGNMENT = 64;
+
+static void Put(uint8_t* out, uint64_t value, unsigned int bytes) {
+    for(unsigned int i = 0; i < bytes; i++) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+static uint64_t Get(uint8_t const* in, unsigned int bytes) {
+    uint64_t value = 0;
+    for(unsigned int i = 0; i < bytes; i++) value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    return value;
+}
+
+uint64_t RomCorpus::Hash(uint8_t const* rom, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for(size_t i = 0; i < size; i++) {
+        hash = (hash ^ rom[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool RomCorpus::Open(const char* filename) {
+    entries.clear();
+
+    if(!file.Open(filename) || file.Size() < HEADER_SIZE || memcmp(file.Data(), "C8RC", 4) || Get(file.Data() + 4, 2) != VERSION) {
+        file.Close();
+        return false;
+    }
+
+    uint8_t const* data = file.Data();
+    size_t size = file.Size();
+    uint64_t count = Get(data + 8, 4);
+
+    if(count > (size - HEADER_SIZE) / ENTRY_SIZE) {
+        file.Close();
+        return false;
+    }
+
+    // Only the index is read up front, names and images stay in the mapping
+    entries.reserve(count);
+    for(uint64_t i = 0; i < count; i++) {
+        uint8_t const* in = data + HEADER_SIZE + i * ENTRY_SIZE;
+        uint64_t image_offset = Get(in + 8, 4);
+        uint64_t name_offset = Get(in + 20, 4);
+
+        Entry entry;
+        entry.hash = Get(in, 8);
+        entry.size = Get(in + 12, 2);
+        entry.quirks = Get(in + 14, 2);
+        entry.ips = Get(in + 16, 4);
+        entry.name_length = Get(in + 24, 2);
+
+        if(image_offset > size || size - image_offset < MAX_ROM_SIZE || name_offset > size || size - name_offset < entry.name_length || entry.size > MAX_ROM_SIZE) {
+            entries.clear();
+            file.Close();
+            return false;
+        }
+
+        entry.image = data + image_offset;
+        entry.name = reinterpret_cast<char const*>(data + name_offset);
+        entries.push_back(entry);
+    }
+
+    if(!std::is_sorted(entries.begin(), entries.end(), [](Entry const& a, Entry const& b) { return a.hash < b.hash; })) {
+        entries.clear();
+        file.Close();
+        return false;
+    }
+
+    return true;
+}
+
+RomCorpus::Entry const* RomCorpus::Find(uint64_t hash) const {
+    auto entry = std::lower_bound(entries.begin(), entries.end(), hash, [](Entry const& e, uint64_t h) { return e.hash < h; });
+    return entry != entries.end() && entry->hash == hash ? &*entry : nullptr;
+}
+
+RomCorpus::Entry const* RomCorpus::Find(std::string const& name_or_hash) const {
+    for(Entry const& entry : entries) {
+        if(entry.name_length == name_or_hash.size() && !memcmp(entry.name, name_or_hash.data(), entry.name_length)) {
+            return &entry;
+        }
+    }
+
+    // Not a name, try it as a hash
+    char* end = nullptr;
+    uint64_t hash = std::strtoull(name_or_hash.c_str(), &end, 16);
+    if(name_or_hash.empty() || *end != '\0') {
+        return nullptr;
+    }
+
+    return Find(hash);
+}
+
+bool RomCorpus::Build(const char* filename, std::vector<CorpusRom> const& roms) {
+    // Hash everything, drop duplicates and sort by hash
+    std::vector<std::pair<uint64_t, CorpusRom const*>> sorted;
+    for(CorpusRom const& rom : roms) {
+        if(rom.data.size() > MAX_ROM_SIZE || rom.name.size() > 0xFFFF) {
+            return false;
+        }
+        sorted.emplace_back(Hash(rom.data.data(), rom.data.size()), &rom);
+    }
+
+    std::stable_sort(sorted.begin(), sorted.end(), [](std::pair<uint64_t, CorpusRom const*> const& a, std::pair<uint64_t, CorpusRom const*> const& b) {
+        return a.first < b.first;
+    });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), [](std::pair<uint64_t, CorpusRom const*> const& a, std::pair<uint64_t, CorpusRom const*> const& b) {
+        return a.first == b.first;
+    }), sorted.end());
+
+    // Lay out the file: header, index, names, then the images
+    size_t names_offset = HEADER_SIZE + sorted.size() * ENTRY_SIZE;
+    size_t names_size = 0;
+    for(auto const& rom : sorted) names_size += rom.second->name.size();
+
+    size_t images_offset = (names_offset + names_size + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+    size_t image_stride = (MAX_ROM_SIZE + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+
+    if(images_offset + sorted.size() * image_stride > 0xFFFFFFFFu) { // Offsets are 32-bit
+        return false;
+    }
+
+    std::vector<uint8_t> out(images_offset + sorted.size() * image_stride);
+
+    memcpy(out.data(), "C8RC", 4);
+    Put(out.data() + 4, VERSION, 2);
+    Put(out.data() + 8, sorted.size(), 4);
+
+    size_t name_offset = names_offset;
+    for(size_t i = 0; i < sorted.size(); i++) {
+        CorpusRom const& rom = *sorted[i].second;
+        uint8_t* entry = out.data() + HEADER_SIZE + i * ENTRY_SIZE;
+        size_t image_offset = images_offset + i * image_stride;
+
+        Put(entry, sorted[i].first, 8);
+        Put(entry + 8, image_offset, 4);
+        Put(entry + 12, rom.data.size(), 2);
+        Put(entry + 14, rom.quirks, 2);
+        Put(entry + 16, rom.ips, 4);
+        Put(entry + 20, name_offset, 4);
+        Put(entry + 24, rom.name.size(), 2);
+
+        memcpy(out.data() + name_offset, rom.name.data(), rom.name.size());
+        name_offset += rom.name.size();
+
+        if(!rom.data.empty()) {
+            memcpy(out.data() + image_offset, rom.data.data(), rom.data.size()); // The rest of the image stays zero
+        }
+    }
+
+    std::ofstream archive(filename, std::ios::binary);
+    return static_cast<bool>(archive.write(reinterpret_cast<char const*>(out.data()), out.size()));
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <mapped_file.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+ * ROM corpus
+ * One file holding any number of ROMs, mapped once and shared by every instance.
+ * Each ROM is stored as a full zero-padded program image (MAX_ROM_SIZE bytes), so
+ * spinning up an instance is a single Chip8::LoadProgram() memcpy out of the mapping.
+ * That limits it to ROMs that fit classic 4 KB RAM: Build() refuses anything bigger, load
+ * XO-CHIP ROMs over MAX_ROM_SIZE with Chip8::LoadROM() instead.
+ * The index is sorted by a content hash of the ROM, so a lookup is a binary search,
+ * and each entry carries metadata: a name, the recommended IPS and quirk flags.
+ *
+ * File layout (little-endian):
+ *   header  "C8RC", u16 version, u16 reserved, u32 entry count, u32 reserved
+ *   index   per entry: u64 hash, u32 image offset, u16 ROM size, u16 quirks,
+ *           u32 IPS (0 = no recommendation), u32 name offset, u16 name length, u16 reserved, u32 reserved
+ *   names   the entries' names back to back
+ *   images  one MAX_ROM_SIZE image per entry, each starting on a 64-byte boundary
+ */
+
+// Behaviors that differ between CHIP-8 interpreters, recorded per ROM (the interpreter doesn't act on them yet)
+enum RomQuirk : uint16_t {
+    QUIRK_SHIFT_VY = 1u << 0, // 8xy6/8xyE shift Vy into Vx (COSMAC VIP)
+    QUIRK_LOAD_STORE_I = 1u << 1, // Fx55/Fx65 leave I past the last register
+    QUIRK_JUMP_VX = 1u << 2, // Bnnn jumps to nnn + Vx (SUPER-CHIP)
+    QUIRK_VF_RESET = 1u << 3, // 8xy1/8xy2/8xy3 clear VF
+    QUIRK_DISPLAY_WAIT = 1u << 4, // Dxyn waits for the next 60 Hz frame
+    QUIRK_WRAP_SPRITES = 1u << 5 // Sprites wrap around the screen edges instead of being clipped
+};
+
+// A ROM to put in a corpus
+struct CorpusRom {
+    std::string name;
+    std::vector<uint8_t> data;
+    uint32_t ips{}; // Recommended instructions per second (0 = none)
+    uint16_t quirks{}; // RomQuirk flags
+};
+
+class RomCorpus {
+    public:
+        static const uint16_t VERSION = 1;
+
+        struct Entry {
+            uint64_t hash; // RomCorpus::Hash() of the ROM
+            uint8_t const* image; // MAX_ROM_SIZE bytes inside the mapping
+            uint16_t size; // ROM size before padding
+            uint16_t quirks; // RomQuirk flags
+            uint32_t ips; // Recommended instructions per second (0 = none)
+            char const* name; // Not NUL terminated, see Name()
+            uint16_t name_length;
+
+            std::string Name() const { return std::string(name, name_length); }
+        };
+
+        bool Open(const char* filename); // Map an archive, false if it's missing or damaged
+        size_t Count() const { return entries.size(); }
+        Entry const& operator[](size_t i) const { return entries[i]; } // Sorted by hash
+        Entry const* Find(uint64_t hash) const; // nullptr if there's no such ROM
+        Entry const* Find(std::string const& name_or_hash) const; // By name, or by hash written in hex
+        static void Load(Entry const& entry, Chip8& chip8) { chip8.LoadProgram(entry.image); } // Spin an instance up on a ROM
+
+        static uint64_t Hash(uint8_t const* rom, size_t size); // FNV-1a over the ROM bytes
+        static bool Build(const char* filename, std::vector<CorpusRom> const& roms); // Write an archive, duplicates (same hash) are stored once
+
+    private:
+        MappedFile file;
+        std::vector<Entry> entries;
+};
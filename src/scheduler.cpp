@@ -0,0 +1,65 @@
+#include <scheduler.hpp>
+#include <thread>
+
+constexpr std::chrono::microseconds FrameScheduler::SPIN_MARGIN;
+
+FrameScheduler::FrameScheduler(uint64_t instructions_per_second) : ips(instructions_per_second), start(Clock::now()) {
+}
+
+FrameScheduler::Clock::time_point FrameScheduler::Deadline(uint64_t frame_number) const {
+    return start + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(frame_number * 1000000000ull / FRAME_RATE));
+}
+
+uint64_t FrameScheduler::RunFrame(Chip8& chip8) {
+    // Hand out instructions so the total after n frames is exactly ips * n / 60,
+    // e.g. 500 IPS runs frames of 8 and 9 instead of rounding every frame down
+    uint64_t target = InstructionsBefore(frame + 1, ips);
+    uint64_t executed = chip8.Run(target - instructions);
+
+    instructions = target;
+    frame++;
+
+    chip8.TickTimers();
+
+    return executed;
+}
+
+void FrameScheduler::WaitForNextFrame() {
+    Clock::time_point deadline = Deadline(frame);
+    Clock::time_point now = Clock::now();
+
+    if(now - deadline > Deadline(MAX_FRAMES_BEHIND) - Deadline(0)) { // Way behind (host stalled, or the IPS is too high), this frame is due now
+        start += now - deadline;
+        return;
+    }
+
+    WaitUntil(deadline);
+}
+
+void FrameScheduler::WaitForSlice(unsigned int slice, unsigned int slices) {
+    if(frame == 0) {
+        return;
+    }
+
+    Clock::time_point previous = Deadline(frame - 1);
+    WaitUntil(previous + (Deadline(frame) - previous) * slice / slices); // Already past it when behind, then this returns right away
+}
+
+void FrameScheduler::WaitUntil(Clock::time_point deadline) {
+    Clock::time_point now = Clock::now();
+
+    if(deadline - now > SPIN_MARGIN) { // Sleep through most of the wait
+        std::this_thread::sleep_for(deadline - now - SPIN_MARGIN);
+    }
+
+    while(Clock::now() < deadline) { // Spin the rest for accuracy
+        std::this_thread::yield();
+    }
+}
+
+void FrameScheduler::Seek(uint64_t frame_number) {
+    // Shift the start so the frame we carry on from is due when the current one would have been
+    start += Deadline(frame) - Deadline(frame_number);
+    frame = frame_number;
+    instructions = InstructionsBefore(frame, ips);
+}
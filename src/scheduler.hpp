@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <chrono>
+#include <cstdint>
+
+
+/**
+ * Frame-paced scheduler
+ * Splits a target instruction rate into 60 Hz frames: each frame runs a batch of
+ * instructions and ticks the timers once, so game speed no longer depends on the
+ * instruction rate. Between frames the host thread sleeps, and only spins for the
+ * last stretch before the deadline to hit it with sub-millisecond accuracy.
+ */
+class FrameScheduler {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        static const unsigned int FRAME_RATE = 60; // Timer and display rate in Hz
+
+        explicit FrameScheduler(uint64_t instructions_per_second);
+
+        uint64_t RunFrame(Chip8& chip8); // Run one frame worth of instructions and tick the timers, returns instructions executed
+        void WaitForNextFrame(); // Sleep (then spin) until the next frame is due
+        void WaitForSlice(unsigned int slice, unsigned int slices); // Sleep (then spin) until slice/slices of the way from the frame just run to the next one
+        void Seek(uint64_t frame_number); // Carry on from the given frame (after a rewind or a movie seek), the next one is due on time
+        uint64_t Frames() const { return frame; } // Frames run so far
+        static uint64_t InstructionsBefore(uint64_t frame_number, uint64_t ips) { return frame_number * ips / FRAME_RATE; } // Instructions handed out before a frame
+
+    private:
+        static constexpr std::chrono::microseconds SPIN_MARGIN{1500}; // Wake up this early and spin the rest, sleep overshoots on busy hosts
+        static const unsigned int MAX_FRAMES_BEHIND = 6; // Give up on catching up past this, rather than running a burst of frames
+
+        uint64_t ips; // Target instructions per second
+        uint64_t frame{}; // Frames run since the start
+        uint64_t instructions{}; // Instructions handed out since the start
+        Clock::time_point start; // When frame 0 was due (moved forward when we resync, so the batch sizes only depend on the frame number)
+
+        Clock::time_point Deadline(uint64_t frame_number) const; // When the given frame is due, computed from the start so errors don't pile up
+        static void WaitUntil(Clock::time_point deadline); // Sleep through most of the wait, spin the rest
+};
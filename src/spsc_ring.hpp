@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+
+/**
+ * Single-producer/single-consumer ring buffer
+ * One thread Push()es, one other thread Pop()s, with no locks: each side owns one index
+ * and only reads the other's. Each side also keeps a cached copy of the other index, so it
+ * only touches the other side's cache line when the ring looks full (or empty).
+ * CAPACITY must be a power of two. The indices run freely and wrap through the mask.
+ */
+template<typename T, size_t CAPACITY>
+class SpscRing {
+    static_assert(CAPACITY && !(CAPACITY & (CAPACITY - 1)), "SpscRing capacity must be a power of two");
+
+    public:
+        static const size_t MASK = CAPACITY - 1;
+
+        size_t Push(T const* items, size_t count) { // Producer only: append up to count items, returns how many fit
+            size_t write = head.load(std::memory_order_relaxed);
+
+            if(CAPACITY - (write - producer_tail) < count) { // Looks full, see how far the consumer has got
+                producer_tail = tail.load(std::memory_order_acquire);
+            }
+
+            size_t room = CAPACITY - (write - producer_tail);
+            if(count > room) {
+                count = room;
+            }
+
+            for(size_t i = 0; i < count; i++) {
+                buffer[(write + i) & MASK] = items[i];
+            }
+            head.store(write + count, std::memory_order_release);
+            return count;
+        }
+
+        size_t Pop(T* items, size_t count) { // Consumer only: take up to count items, returns how many there were
+            size_t read = tail.load(std::memory_order_relaxed);
+
+            if(consumer_head - read < count) { // Looks empty, see how far the producer has got
+                consumer_head = head.load(std::memory_order_acquire);
+            }
+
+            size_t available = consumer_head - read;
+            if(count > available) {
+                count = available;
+            }
+
+            for(size_t i = 0; i < count; i++) {
+                items[i] = buffer[(read + i) & MASK];
+            }
+            tail.store(read + count, std::memory_order_release);
+            return count;
+        }
+
+        size_t Size() const { // Items queued, exact from either side's point of view at the moment it's read
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+    private:
+        alignas(64) std::atomic<size_t> head{0}; // Next slot the producer writes
+        size_t producer_tail{0}; // Producer's last look at tail
+        alignas(64) std::atomic<size_t> tail{0}; // Next slot the consumer reads
+        size_t consumer_head{0}; // Consumer's last look at head
+        alignas(64) T buffer[CAPACITY]{};
+};
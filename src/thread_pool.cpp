@@ -0,0 +1,157 @@
+#include <thread_pool.hpp>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static uint64_t Pack(size_t first, size_t last) {
+    return (static_cast<uint64_t>(first) << 32) | static_cast<uint32_t>(last);
+}
+
+static size_t First(uint64_t bounds) {
+    return static_cast<size_t>(bounds >> 32);
+}
+
+static size_t Last(uint64_t bounds) {
+    return static_cast<size_t>(bounds & 0xFFFFFFFFu);
+}
+
+ThreadPool::ThreadPool(unsigned int threads)
+: worker_count(threads ? threads : std::max(1u, std::thread::hardware_concurrency())), ranges(worker_count) {
+
+    // Worker 0 is whoever calls ParallelFor(), we only start the rest
+    for(unsigned int id = 1; id < worker_count; id++) {
+        this->threads.emplace_back(&ThreadPool::Worker, this, id);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for(std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grain, Task const& task) {
+    if(count == 0) {
+        return;
+    }
+
+    if(worker_count == 1 || count <= grain) { // Not worth waking anyone up
+        task(0, count);
+        return;
+    }
+
+    this->task = &task;
+    this->grain = std::max<size_t>(grain, 1);
+
+    // Start with an even split, stealing evens out whatever the split gets wrong
+    for(unsigned int id = 0; id < worker_count; id++) {
+        ranges[id].bounds.store(Pack(count * id / worker_count, count * (id + 1) / worker_count), std::memory_order_relaxed);
+    }
+
+    busy.store(worker_count - 1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    wake.notify_all();
+
+    Work(0);
+
+    while(busy.load(std::memory_order_acquire) != 0) { // Everything is taken, wait for the last chunks to finish
+        std::this_thread::yield();
+    }
+
+    this->task = nullptr;
+}
+
+void ThreadPool::Worker(unsigned int id) {
+    Pin(id);
+
+    uint64_t seen = 0;
+
+    while(true) {
+        // Spin a little first, steps usually come back to back
+        for(unsigned int spin = 0; spin < SPIN_ITERATIONS && generation.load(std::memory_order_acquire) == seen; spin++) {
+        }
+
+        if(generation.load(std::memory_order_acquire) == seen) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation.load(std::memory_order_acquire) != seen; });
+
+            if(stopping) {
+                return;
+            }
+        }
+
+        seen = generation.load(std::memory_order_acquire);
+
+        Work(id);
+
+        busy.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void ThreadPool::Work(unsigned int id) {
+    size_t first, last;
+
+    do {
+        while(TakeFront(id, first, last)) {
+            (*task)(first, last);
+        }
+    } while(Steal(id));
+}
+
+bool ThreadPool::TakeFront(unsigned int id, size_t& first, size_t& last) {
+    uint64_t bounds = ranges[id].bounds.load(std::memory_order_acquire);
+
+    while(First(bounds) < Last(bounds)) {
+        first = First(bounds);
+        last = std::min(Last(bounds), first + grain);
+
+        if(ranges[id].bounds.compare_exchange_weak(bounds, Pack(last, Last(bounds)), std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ThreadPool::Steal(unsigned int id) {
+    for(unsigned int offset = 1; offset < worker_count; offset++) {
+        Range& victim = ranges[(id + offset) % worker_count];
+        uint64_t bounds = victim.bounds.load(std::memory_order_acquire);
+
+        while(First(bounds) < Last(bounds)) {
+            size_t middle = First(bounds) + (Last(bounds) - First(bounds)) / 2; // Leave the victim the front half
+
+            if(victim.bounds.compare_exchange_weak(bounds, Pack(First(bounds), middle), std::memory_order_acq_rel)) {
+                // Nobody steals from an empty range, so ours can't change under us here
+                ranges[id].bounds.store(Pack(middle, Last(bounds)), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::Pin(unsigned int core) {
+#ifdef __linux__
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % cores, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set); // Best effort, an unpinned worker still works
+#else
+    (void)core;
+#endif
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <aligned_allocator.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Work-stealing thread pool
+ * ParallelFor() splits [0, count) evenly across the workers (the calling thread is
+ * worker 0). Each worker takes grain-sized chunks off the front of its own range, and
+ * when it runs dry steals the back half of the busiest-looking other range, so uneven
+ * work (one instance drawing a lot, another idling) still keeps every core busy.
+ * Ranges are packed into one atomic word and split with compare-and-swap, no locks.
+ * Workers are pinned to cores (Linux only) and spin briefly before blocking, so
+ * back-to-back ParallelFor() calls don't pay for a wake-up every time.
+ */
+class ThreadPool {
+    public:
+        typedef std::function<void(size_t first, size_t last)> Task; // Runs the items [first, last)
+
+        explicit ThreadPool(unsigned int threads = 0); // 0 = one per hardware thread
+        ~ThreadPool();
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator=(ThreadPool const&) = delete;
+
+        unsigned int Size() const { return worker_count; } // Workers, including the calling thread
+        void ParallelFor(size_t count, size_t grain, Task const& task); // Run task over [0, count), returns when every item is done
+
+    private:
+        static const unsigned int SPIN_ITERATIONS = 20000; // Polls of the generation counter before a worker goes to sleep
+
+        struct alignas(64) Range { // One per worker, on its own cache line
+            std::atomic<uint64_t> bounds{0}; // first in the high 32 bits, last in the low 32 bits
+        };
+
+        unsigned int worker_count;
+        std::vector<std::thread> threads;
+        std::vector<Range, AlignedAllocator<Range>> ranges; // new[] wouldn't keep them on their own cache lines
+
+        Task const* task{}; // Job of the current ParallelFor()
+        size_t grain{1};
+        std::atomic<uint64_t> generation{0}; // Bumped once per ParallelFor(), workers wait for it to change
+        std::atomic<unsigned int> busy{0}; // Workers still working on the current generation
+        bool stopping{false};
+        std::mutex mutex;
+        std::condition_variable wake;
+
+        void Worker(unsigned int id);
+        void Work(unsigned int id); // Drain our own range, then steal until everything is taken
+        bool TakeFront(unsigned int id, size_t& first, size_t& last); // Pop a chunk off the front of our range
+        bool Steal(unsigned int id); // Move half of someone else's range into ours
+        static void Pin(unsigned int core); // Pin the calling thread to a core
+};
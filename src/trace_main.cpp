@@ -0,0 +1,143 @@
+#include <tracer.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static void Usage(const char* program) {
+    std::cerr << "Usage: " << program << " dump <trace> [--from N] [--count N]\n"
+              << "       " << program << " diff <trace> <trace> [--context N]\n";
+    std::exit(EXIT_FAILURE);
+}
+
+static void Open(TraceReader& trace, const char* filename) {
+    if(!trace.Open(filename)) {
+        std::cerr << "Could not open trace (missing, or not a trace from this version on this kind of host): " << filename << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// One line per record: number, PC, opcode, I, SP, the register it changed and the RAM it wrote
+static void Print(char const* prefix, uint64_t number, TraceRecord const& record) {
+    char reg[8] = "-";
+    if(record.reg != 0xFF) {
+        std::snprintf(reg, sizeof(reg), "V%X=%02X", record.reg & 0xFu, record.value);
+    }
+    char write[24] = "-";
+    if(record.write_length) {
+        std::snprintf(write, sizeof(write), "[%03X+%u]=%08X", record.write_address, record.write_length, record.write_hash);
+    }
+
+    std::printf("%s%12llu  %03X  %04X  I=%03X  SP=%X  %-6s  %s\n", prefix, static_cast<unsigned long long>(number), record.pc, record.opcode,
+                record.index, record.sp, reg, write);
+}
+
+// Which fields of two records differ, e.g. "opcode, V register"
+static std::string Differences(TraceRecord const& a, TraceRecord const& b) {
+    std::string fields;
+    auto add = [&fields](bool differs, char const* name) {
+        if(differs) {
+            fields += fields.empty() ? name : std::string(", ") + name;
+        }
+    };
+
+    add(a.pc != b.pc, "PC");
+    add(a.opcode != b.opcode, "opcode");
+    add(a.index != b.index, "I");
+    add(a.sp != b.sp, "SP");
+    add(a.reg != b.reg || a.value != b.value, "V register");
+    add(a.write_address != b.write_address || a.write_length != b.write_length || a.write_hash != b.write_hash, "RAM write");
+    return fields;
+}
+
+static int Dump(const char* filename, uint64_t from, uint64_t count) {
+    TraceReader trace;
+    Open(trace, filename);
+
+    uint64_t end = from + count < from || from + count > trace.Count() ? trace.Count() : from + count;
+    for(uint64_t i = from; i < end; i++) {
+        Print("", i, trace.Records()[i]);
+    }
+    return EXIT_SUCCESS;
+}
+
+// Exits like cmp: 0 if the traces are the same, 1 if they differ
+static int Diff(const char* filename_a, const char* filename_b, uint64_t context) {
+    TraceReader a, b;
+    Open(a, filename_a);
+    Open(b, filename_b);
+
+    uint64_t common = a.Count() < b.Count() ? a.Count() : b.Count();
+    uint64_t first = 0;
+
+    // Whole blocks compare with memcmp, only the block that differs gets looked at record by record
+    const uint64_t BLOCK = 4096;
+    while(first < common) {
+        uint64_t length = common - first < BLOCK ? common - first : BLOCK;
+        if(memcmp(a.Records() + first, b.Records() + first, length * sizeof(TraceRecord))) {
+            while(!memcmp(a.Records() + first, b.Records() + first, sizeof(TraceRecord))) {
+                first++;
+            }
+            break;
+        }
+        first += length;
+    }
+
+    if(first == common && a.Count() == b.Count()) {
+        std::printf("Traces match: %llu records\n", static_cast<unsigned long long>(common));
+        return EXIT_SUCCESS;
+    }
+
+    if(first == common) {
+        bool a_shorter = a.Count() < b.Count();
+        std::printf("Traces match for %llu records, then %s ends\n", static_cast<unsigned long long>(common), a_shorter ? filename_a : filename_b);
+    } else {
+        std::printf("First divergence at record %llu: %s\n", static_cast<unsigned long long>(first),
+                    Differences(a.Records()[first], b.Records()[first]).c_str());
+    }
+
+    for(uint64_t i = first > context ? first - context : 0; i < first; i++) { // The run up to it, the same in both
+        Print("  ", i, a.Records()[i]);
+    }
+    if(first < a.Count()) {
+        Print("< ", first, a.Records()[first]);
+    }
+    if(first < b.Count()) {
+        Print("> ", first, b.Records()[first]);
+    }
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc >= 3 && !std::strcmp(argv[1], "dump")) {
+        uint64_t from = 0;
+        uint64_t count = UINT64_MAX;
+
+        for(int i = 3; i < argc; i++) {
+            if(!std::strcmp(argv[i], "--from") && i + 1 < argc) {
+                from = std::stoull(argv[++i]);
+            } else if(!std::strcmp(argv[i], "--count") && i + 1 < argc) {
+                count = std::stoull(argv[++i]);
+            } else {
+                Usage(argv[0]);
+            }
+        }
+        return Dump(argv[2], from, count);
+    }
+
+    if(argc >= 4 && !std::strcmp(argv[1], "diff")) {
+        uint64_t context = 8;
+
+        for(int i = 4; i < argc; i++) {
+            if(!std::strcmp(argv[i], "--context") && i + 1 < argc) {
+                context = std::stoull(argv[++i]);
+            } else {
+                Usage(argv[0]);
+            }
+        }
+        return Diff(argv[2], argv[3], context);
+    }
+
+    Usage(argv[0]);
+}
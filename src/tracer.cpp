@@ -0,0 +1,185 @@
+#include <tracer.hpp>
+#include <cstdio>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define CHIP8_MMAP_SUPPORTED 1
+#endif
+
+Tracer::Tracer() : storage(TRACE_BUFFERS * BUFFER_RECORDS) {
+}
+
+Tracer::~Tracer() {
+    Close();
+}
+
+bool Tracer::Open(const char* filename) {
+    Close();
+
+#ifdef CHIP8_MMAP_SUPPORTED
+    fd = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+#else
+    file = std::fopen(filename, "wb");
+    fd = file ? 0 : -1;
+#endif
+    if(fd < 0) {
+        return false;
+    }
+
+    spare.clear();
+    for(unsigned int i = 1; i < TRACE_BUFFERS; i++) {
+        spare.push_back(&storage[i * BUFFER_RECORDS]);
+    }
+    current = &storage[0];
+    fill = 0;
+    submitted = 0;
+    stopping = false;
+    failed = false;
+    written = 0;
+
+    TraceHeader header{};
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.byte_order = TRACE_BYTE_ORDER;
+    Append(&header, sizeof(header));
+
+    writer = std::thread(&Tracer::WriterLoop, this);
+    return true;
+}
+
+bool Tracer::Close() {
+    if(fd < 0) {
+        return true;
+    }
+
+    if(fill) { // The partly filled buffer goes out like a full one
+        Submit();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    writer.join();
+
+#ifdef CHIP8_MMAP_SUPPORTED
+    if(window) {
+        munmap(window, WINDOW_SIZE);
+        window = nullptr;
+    }
+    if(ftruncate(fd, static_cast<off_t>(written)) != 0) { // Drop the unused tail of the last window
+        failed = true;
+    }
+    ::close(fd);
+#else
+    if(std::fclose(file) != 0) {
+        failed = true;
+    }
+    file = nullptr;
+#endif
+    fd = -1;
+    current = nullptr;
+    return !failed;
+}
+
+void Tracer::Submit() {
+    std::unique_lock<std::mutex> lock(mutex);
+    pending.push_back(Batch{current, fill});
+    submitted += fill;
+    wake.notify_all();
+
+    wake.wait(lock, [this] { return !spare.empty(); }); // Only blocks if the writer is a whole TRACE_BUFFERS behind
+    current = spare.back();
+    spare.pop_back();
+    fill = 0;
+}
+
+void Tracer::WriterLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for(;;) {
+        wake.wait(lock, [this] { return !pending.empty() || stopping; });
+        if(pending.empty()) { // Stopping, and everything's written
+            return;
+        }
+
+        Batch batch = pending.front();
+        pending.pop_front();
+
+        lock.unlock(); // The recorder keeps filling the other buffers while this one's copied out
+        Append(batch.records, batch.count * sizeof(TraceRecord));
+        lock.lock();
+
+        spare.push_back(batch.records);
+        wake.notify_all();
+    }
+}
+
+bool Tracer::Append(void const* data, size_t size) {
+    if(failed) {
+        return false;
+    }
+
+#ifdef CHIP8_MMAP_SUPPORTED
+    uint8_t const* bytes = static_cast<uint8_t const*>(data);
+
+    while(size) {
+        if(!window || written == window_offset + WINDOW_SIZE) { // Grow the file by a window and map that
+            if(window) {
+                munmap(window, WINDOW_SIZE);
+                window = nullptr;
+            }
+            window_offset = written;
+
+            void* mapping = MAP_FAILED;
+            if(ftruncate(fd, static_cast<off_t>(window_offset + WINDOW_SIZE)) == 0) {
+                mapping = mmap(nullptr, WINDOW_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(window_offset));
+            }
+            if(mapping == MAP_FAILED) {
+                failed = true;
+                return false;
+            }
+            window = static_cast<uint8_t*>(mapping);
+        }
+
+        size_t room = static_cast<size_t>(window_offset + WINDOW_SIZE - written);
+        size_t chunk = size < room ? size : room;
+        memcpy(window + (written - window_offset), bytes, chunk);
+        written += chunk;
+        bytes += chunk;
+        size -= chunk;
+    }
+    return true;
+#else
+    if(std::fwrite(data, 1, size, file) != size) {
+        failed = true;
+        return false;
+    }
+    written += size;
+    return true;
+#endif
+}
+
+bool TraceReader::Open(const char* filename) {
+    records = nullptr;
+    count = 0;
+
+    if(!file.Open(filename) || file.Size() < sizeof(TraceHeader)) {
+        return false;
+    }
+
+    TraceHeader header;
+    memcpy(&header, file.Data(), sizeof(header));
+    if(header.magic != TRACE_MAGIC || header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord)
+            || header.byte_order != TRACE_BYTE_ORDER) {
+        return false;
+    }
+
+    records = reinterpret_cast<TraceRecord const*>(file.Data() + sizeof(TraceHeader)); // 16-byte aligned: the mapping starts on a page
+    count = (file.Size() - sizeof(TraceHeader)) / sizeof(TraceRecord);
+    return true;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mapped_file.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Execution tracer
+ * Only wired into builds configured with -DCHIP8_TRACE=ON, like the profiler. While a Tracer
+ * is attached (Chip8::SetTracer) the interpreter appends one fixed-size TraceRecord per
+ * instruction. That's a 16-byte store into the tracer's current buffer. Full buffers go to a
+ * writer thread, which copies them into the trace file through a growing memory mapping, so the
+ * emulation thread never waits on I/O unless it gets a whole TRACE_BUFFERS buffers ahead.
+ * A Tracer belongs to one machine on one thread. Trace several instances with one Tracer each.
+ *
+ * Trace file: a TraceHeader, then the records back to back in host byte order. The header's
+ * byte order mark lets a reader refuse a trace written on a host with the other byte order.
+ */
+const uint32_t TRACE_MAGIC = 0x52543843; // "C8TR" in memory on little-endian hosts
+const uint16_t TRACE_VERSION = 1;
+const uint32_t TRACE_BYTE_ORDER = 0x01020304;
+
+struct TraceHeader {
+    uint32_t magic; // TRACE_MAGIC
+    uint16_t version; // TRACE_VERSION
+    uint16_t record_size; // sizeof(TraceRecord)
+    uint32_t byte_order; // TRACE_BYTE_ORDER
+    uint32_t reserved;
+};
+
+struct TraceRecord {
+    uint16_t pc; // Where the instruction was
+    uint16_t opcode; // As fetched, before it ran
+    uint16_t index; // I after the instruction
+    uint16_t write_address; // First byte of RAM it wrote (Fx33, Fx55, 5xy2)
+    uint8_t reg; // Lowest V register it changed, 0xFF if none
+    uint8_t value; // New value of that register
+    uint8_t sp; // Stack pointer after the instruction
+    uint8_t write_length; // Bytes of RAM it wrote, 0 if none
+    uint32_t write_hash; // FNV-1a of the bytes written
+};
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader is written as is");
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord is written as is");
+
+class Tracer {
+    public:
+        static const size_t BUFFER_RECORDS = 1u << 16; // 1 MB per buffer
+        static const unsigned int TRACE_BUFFERS = 4;
+        static const size_t WINDOW_SIZE = 64u << 20; // The file grows and gets mapped this much at a time
+
+        Tracer();
+        ~Tracer();
+        Tracer(Tracer const&) = delete;
+        Tracer& operator=(Tracer const&) = delete;
+
+        bool Open(const char* filename); // Create the trace file and start the writer, false if it can't be created
+        bool Close(); // Write out everything recorded, stop the writer and trim the file, false if anything failed to write
+
+        void Record(TraceRecord const& record) { // One instruction, called by the interpreter
+            current[fill] = record;
+            if(++fill == BUFFER_RECORDS) {
+                Submit();
+            }
+        }
+
+        uint64_t Records() const { return submitted + fill; }
+
+    private:
+        struct Batch {
+            TraceRecord* records;
+            size_t count;
+        };
+
+        std::vector<TraceRecord> storage; // TRACE_BUFFERS buffers of BUFFER_RECORDS
+        TraceRecord* current{}; // Buffer being filled
+        size_t fill{}; // Records in it
+        uint64_t submitted{}; // Records handed to the writer
+
+        std::mutex mutex;
+        std::condition_variable wake; // Writer: a batch is waiting or it's time to stop. Recorder: a buffer came back
+        std::deque<Batch> pending; // Full buffers, oldest first
+        std::vector<TraceRecord*> spare; // Empty buffers
+        bool stopping{};
+        std::thread writer;
+
+        // Writer thread only, until Close() joins it
+        int fd{-1}; // -1 while closed
+        std::FILE* file{}; // Written through instead of the mapping where mmap isn't available
+        uint8_t* window{}; // Mapping of [window_offset, window_offset + WINDOW_SIZE)
+        uint64_t window_offset{};
+        uint64_t written{}; // Bytes of the file holding data
+        bool failed{};
+
+        void Submit(); // Hand the current buffer to the writer and take a spare one
+        void WriterLoop();
+        bool Append(void const* data, size_t size); // Copy into the mapping, moving it along as the file grows
+};
+
+// A trace file, mapped read-only
+class TraceReader {
+    public:
+        bool Open(const char* filename); // False if it's missing or not a trace this build can read
+
+        uint64_t Count() const { return count; }
+        TraceRecord const* Records() const { return records; }
+
+    private:
+        MappedFile file;
+        TraceRecord const* records{};
+        uint64_t count{};
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+
+/**
+ * Lock-free triple buffer
+ * Hands whole values (e.g. finished frames) from one writer thread to one reader thread.
+ * The writer fills Back() and Publish()es it. The reader calls Update() and then reads Front(),
+ * always the newest published value. Neither side ever waits on the other: the writer swaps its
+ * buffer with the middle one, the reader swaps the middle one with its own, each with a single
+ * atomic exchange. If the reader falls behind, older frames are overwritten, never queued.
+ */
+template<typename T>
+class TripleBuffer {
+    public:
+        T& Back() { return buffers[back]; } // Writer only: the buffer being filled
+        T const& Front() const { return buffers[front]; } // Reader only: the newest value as of the last Update()
+
+        bool Publish() { // Writer only: hand Back() over and carry on in a different buffer, false if it replaced a value the reader never saw
+            uint8_t replaced = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+            back = replaced & INDEX;
+            return !(replaced & FRESH);
+        }
+
+        bool Update() { // Reader only: pick up the newest published value, false if there's nothing new
+            if(!(middle.load(std::memory_order_relaxed) & FRESH)) {
+                return false;
+            }
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+
+    private:
+        static const uint8_t INDEX = 0x3; // Buffer index in the middle word
+        static const uint8_t FRESH = 0x4; // Set when the middle buffer holds a value the reader hasn't seen
+
+        T buffers[3]{};
+        uint8_t back{0}; // Writer's buffer
+        alignas(64) std::atomic<uint8_t> middle{1}; // The one in between, plus the FRESH flag
+        alignas(64) uint8_t front{2}; // Reader's buffer
+};
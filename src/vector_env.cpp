@@ -0,0 +1,88 @@
+#include <vector_env.hpp>
+#include <cstring>
+
+VectorEnv::VectorEnv(std::vector<uint8_t> const& rom, VectorEnvConfig const& config)
+    : VectorEnv(rom, config, VectorEnvBuffers()) {
+}
+
+VectorEnv::VectorEnv(std::vector<uint8_t> const& rom, VectorEnvConfig const& config, VectorEnvBuffers const& buffers)
+    : rom(rom), config(config), pool(config.threads),
+      episode(config.count), steps(config.count),
+      observations(buffers.observations), rewards(buffers.rewards), dones(buffers.dones) {
+    if(!observations) {
+        observation_storage.resize(config.count * VIDEO_HEIGHT);
+        observations = observation_storage.data();
+    }
+    if(!rewards) {
+        reward_storage.resize(config.count);
+        rewards = reward_storage.data();
+    }
+    if(!dones) {
+        done_storage.resize(config.count);
+        dones = done_storage.data();
+    }
+
+    instances.reserve(config.count);
+
+    for(size_t i = 0; i < config.count; i++) {
+        instances.emplace_back(config.seed + i);
+    }
+
+    Reset();
+}
+
+void VectorEnv::Reset() {
+    classic = true;
+    pool.ParallelFor(Count(), config.grain, [this](size_t first, size_t last) {
+        for(size_t i = first; i < last; i++) {
+            episode[i] = 0;
+            ResetInstance(i);
+            memcpy(&observations[i * VIDEO_HEIGHT], instances[i].video.planes[0], VIDEO_HEIGHT * sizeof(uint64_t));
+            rewards[i] = 0.0f;
+            dones[i] = 0;
+        }
+    });
+}
+
+void VectorEnv::Step(uint16_t const* actions) {
+    pool.ParallelFor(Count(), config.grain, [this, actions](size_t first, size_t last) {
+        for(size_t i = first; i < last; i++) {
+            StepInstance(i, actions[i]);
+        }
+    });
+}
+
+void VectorEnv::ResetInstance(size_t i) {
+    // Resetting in place keeps the decoded (and translated) ROM code, only bytes the game wrote are redone
+    instances[i].Reset(config.seed + i + episode[i] * Count());
+    instances[i].LoadROM(rom.data(), rom.size());
+    instances[i].SetEngine(config.engine); // Falls back to the interpreter if the JIT isn't available
+    if(!instances[i].Classic()) { // A ROM over MAX_ROM_SIZE
+        classic = false;
+    }
+    episode[i]++;
+    steps[i] = 0;
+}
+
+void VectorEnv::StepInstance(size_t i, uint16_t action) {
+    Chip8& chip8 = instances[i];
+
+    chip8.SetKeys(action);
+
+    chip8.Run(config.instructions_per_step);
+    chip8.TickTimers();
+    steps[i]++;
+
+    memcpy(&observations[i * VIDEO_HEIGHT], chip8.video.planes[0], VIDEO_HEIGHT * sizeof(uint64_t)); // The first 32 words of plane 0, the whole screen of a classic ROM
+    if(!chip8.Classic()) {
+        classic = false;
+    }
+    rewards[i] = config.reward ? config.reward(chip8) : 0.0f;
+
+    bool done = (config.done && config.done(chip8)) || (config.max_episode_steps && steps[i] >= config.max_episode_steps);
+    dones[i] = done;
+
+    if(done) {
+        ResetInstance(i);
+    }
+}
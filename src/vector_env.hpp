@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chip_8.hpp>
+#include <thread_pool.hpp>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+/**
+ * Batched environments
+ * Owns N Chip8 instances running the same ROM and steps all of them at once on a
+ * work-stealing thread pool. A step applies each instance's keypad action, runs one
+ * 60 Hz frame of instructions and writes the observation into buffers that are
+ * allocated once up front:
+ *   observations: N packed framebuffers back to back (VIDEO_HEIGHT uint64_t rows each, the low resolution plane 0 screen)
+ *   rewards:      N floats
+ *   dones:        N bytes, 1 when the instance finished an episode this step
+ * An instance that finishes is reset right away (fresh machine, same ROM, next seed),
+ * so its next step starts a new episode. Its observation for this step is the final frame.
+ * Observations only cover classic CHIP-8 screens. Once an instance leaves it (a ROM over
+ * MAX_ROM_SIZE, hires, XO-CHIP planes, ...) Classic() turns false until the next Reset(), and
+ * that instance's observations no longer show what it drew.
+ */
+struct VectorEnvConfig {
+    size_t count{1}; // Number of instances
+    unsigned int threads{0}; // Worker threads, 0 = one per hardware thread
+    unsigned int instructions_per_step{10}; // Instructions per step (one step is one 60 Hz frame)
+    uint64_t max_episode_steps{0}; // End the episode after this many steps (0 = only when done() says so)
+    unsigned int seed{0}; // Instance i of episode e is seeded with seed + i + e * count
+    Engine engine{Engine::Interpreter};
+    size_t grain{16}; // Instances per chunk of work handed to a thread
+
+    std::function<float(Chip8 const&)> reward; // Reward for the step just run (unset = 0)
+    std::function<bool(Chip8 const&)> done; // True if the episode is over (unset = never)
+};
+
+// Caller-owned memory for the step results (e.g. shared with another process), sized for config.count instances
+struct VectorEnvBuffers {
+    uint64_t* observations{}; // count * VIDEO_HEIGHT rows
+    float* rewards{}; // count
+    uint8_t* dones{}; // count
+};
+
+class VectorEnv {
+    public:
+        VectorEnv(std::vector<uint8_t> const& rom, VectorEnvConfig const& config);
+        VectorEnv(std::vector<uint8_t> const& rom, VectorEnvConfig const& config, VectorEnvBuffers const& buffers); // Results go straight into buffers, nothing is copied out
+
+        size_t Count() const { return instances.size(); }
+        void Reset(); // Restart every instance and fill in its first observation
+        void Step(uint16_t const* actions); // One keypad mask per instance (bit k = key k held down)
+
+        uint64_t const* Observations() const { return observations; } // Instance i's frame starts at i * VIDEO_HEIGHT
+        float const* Rewards() const { return rewards; }
+        uint8_t const* Dones() const { return dones; }
+        bool Classic() const { return classic; } // False if an instance left classic CHIP-8 since Reset(), observations can't be trusted
+        Chip8 const& Instance(size_t i) const { return instances[i]; }
+
+    private:
+        std::vector<uint8_t> rom;
+        VectorEnvConfig config;
+        ThreadPool pool;
+
+        std::vector<Chip8> instances;
+        std::vector<uint64_t> episode; // Episodes each instance has started
+        std::vector<uint64_t> steps; // Steps into the current episode
+        std::atomic<bool> classic{true}; // Every instance has stayed classic CHIP-8 since Reset()
+
+        std::vector<uint64_t> observation_storage; // Only used when the caller doesn't bring buffers
+        std::vector<float> reward_storage;
+        std::vector<uint8_t> done_storage;
+        uint64_t* observations;
+        float* rewards;
+        uint8_t* dones;
+
+        void ResetInstance(size_t i);
+        void StepInstance(size_t i, uint16_t action);
+};
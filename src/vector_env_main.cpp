@@ -0,0 +1,193 @@
+#include <lockstep.hpp>
+#include <mapped_file.hpp>
+#include <rom_corpus.hpp>
+#include <vector_env.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+static void Usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--envs N] [--threads N] [--steps N] [--ipf N] [--episode N] [--seed N] [--engine interpreter|jit] [--lockstep scalar|avx2|avx512|best] [--corpus <archive>] <ROM>\n";
+    std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[]) {
+    VectorEnvConfig config;
+    config.count = 1024;
+    uint64_t step_count = 1000;
+    const char* ROM_filename = nullptr;
+    const char* lockstep = nullptr;
+    const char* corpus_filename = nullptr;
+
+    // Parse the args, everything but the ROM is optional
+    for(int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+
+        if(!std::strcmp(argv[i], "--envs") && has_value) {
+            config.count = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--threads") && has_value) {
+            config.threads = std::stoul(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--steps") && has_value) {
+            step_count = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--ipf") && has_value) {
+            config.instructions_per_step = std::stoul(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--episode") && has_value) {
+            config.max_episode_steps = std::stoull(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--seed") && has_value) {
+            config.seed = std::stoul(argv[++i]);
+        }
+        else if(!std::strcmp(argv[i], "--engine") && has_value) {
+            std::string name = argv[++i];
+            if(name == "jit") config.engine = Engine::Jit;
+            else if(name != "interpreter") Usage(argv[0]);
+        }
+        else if(!std::strcmp(argv[i], "--lockstep") && has_value) {
+            lockstep = argv[++i];
+        }
+        else if(!std::strcmp(argv[i], "--corpus") && has_value) {
+            corpus_filename = argv[++i];
+        }
+        else if(argv[i][0] != '-' && !ROM_filename) {
+            ROM_filename = argv[i];
+        }
+        else {
+            Usage(argv[0]);
+        }
+    }
+
+    if(!ROM_filename || config.count == 0 || (lockstep && config.max_episode_steps)) { // Lockstep instances don't reset
+        Usage(argv[0]);
+    }
+
+    Lockstep::Isa isa = Lockstep::BestIsa();
+    if(lockstep) {
+        std::string name = lockstep;
+        if(name == "scalar") isa = Lockstep::Isa::Scalar;
+        else if(name == "avx2") isa = Lockstep::Isa::Avx2;
+        else if(name == "avx512") isa = Lockstep::Isa::Avx512;
+        else if(name != "best") Usage(argv[0]);
+    }
+
+    // The ROM comes straight out of a mapped file, or a mapped corpus
+    std::vector<uint8_t> rom;
+    if(corpus_filename) {
+        RomCorpus corpus;
+        RomCorpus::Entry const* entry = corpus.Open(corpus_filename) ? corpus.Find(ROM_filename) : nullptr;
+        if(!entry) {
+            std::cerr << "No ROM named " << ROM_filename << " in corpus: " << corpus_filename << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+        rom.assign(entry->image, entry->image + entry->size);
+    }
+    else {
+        MappedFile file;
+        if(!file.Open(ROM_filename) || file.Size() == 0 || file.Size() > MAX_ROM_SIZE) {
+            std::cerr << "Could not load ROM (missing, empty or bigger than " << MAX_ROM_SIZE << " bytes): " << ROM_filename << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+        rom.assign(file.Data(), file.Data() + file.Size());
+    }
+
+    // Random keypad masks, regenerated every step with a cheap xorshift so the
+    // action generation doesn't show up in the timing
+    std::vector<uint16_t> actions(config.count);
+    uint64_t state = 0x9E3779B97F4A7C15ull + config.seed;
+    auto randomize = [&]() {
+        for(uint16_t& action : actions) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            action = static_cast<uint16_t>(1u << (state % 17)); // One key held down, or none
+        }
+    };
+
+    std::vector<uint64_t> observations(config.count * VIDEO_HEIGHT);
+    uint64_t episodes = 0;
+    double seconds = 0.0;
+
+    if(lockstep) { // Same instances, seeds and actions, so the observation hash matches the VectorEnv run
+        Lockstep batch(rom.data(), rom.size(), config.count, config.seed);
+        if(!batch.SetIsa(isa)) {
+            std::cerr << "ISA not supported on this host, using the best one available\n";
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        for(uint64_t step = 0; step < step_count; step++) {
+            randomize();
+            for(size_t i = 0; i < batch.Count(); i++) {
+                batch.SetKeys(i, actions[i]);
+            }
+
+            batch.Run(config.instructions_per_step);
+            batch.TickTimers();
+        }
+
+        if(!batch.Supported()) {
+            std::cerr << "The ROM ran SUPER-CHIP/XO-CHIP instructions, which --lockstep can't run: " << ROM_filename << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for(size_t i = 0; i < batch.Count(); i++) {
+            batch.ReadVideo(i, &observations[i * VIDEO_HEIGHT]);
+        }
+
+        Lockstep::Stats const& stats = batch.GetStats();
+        std::printf("lanes_per_step: %.2f\n", stats.steps ? static_cast<double>(stats.lane_steps) / stats.steps : 0.0);
+        std::printf("regroups: %llu\n", static_cast<unsigned long long>(stats.regroups));
+    }
+    else {
+        VectorEnv env(rom, config);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for(uint64_t step = 0; step < step_count; step++) {
+            randomize();
+            env.Step(actions.data());
+
+            for(size_t i = 0; i < env.Count(); i++) {
+                episodes += env.Dones()[i];
+            }
+        }
+
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if(!env.Classic()) {
+            std::cerr << "The ROM left classic CHIP-8, observations only hold its 64x32 plane 0: " << ROM_filename << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+        std::copy(env.Observations(), env.Observations() + observations.size(), observations.begin());
+    }
+
+    if(seconds <= 0.0) seconds = 1e-9;
+
+    // FNV-1a over the last observations, to catch behavior changes
+    uint64_t hash = 0xCBF29CE484222325ull;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(observations.data());
+    for(size_t i = 0; i < observations.size() * sizeof(uint64_t); i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+
+    uint64_t env_steps = step_count * config.count;
+    std::printf("envs: %llu\n", static_cast<unsigned long long>(config.count));
+    std::printf("env_steps: %llu\n", static_cast<unsigned long long>(env_steps));
+    std::printf("episodes_done: %llu\n", static_cast<unsigned long long>(episodes));
+    std::printf("wall_time_s: %.6f\n", seconds);
+    std::printf("env_steps_per_s: %.0f\n", env_steps / seconds);
+    std::printf("instructions_per_s: %.0f\n", env_steps * config.instructions_per_step / seconds);
+    std::printf("observation_hash: %016llx\n", static_cast<unsigned long long>(hash));
+
+    return EXIT_SUCCESS;
+}